@@ -6,16 +6,21 @@
 #include "crc32.h"
 #include "flash.h"
 #include "mem.h"
+#include "metrics.h"
 #include "str.h"
 
 //---------------------------------------------------------------------------
 
-const uint32_t ASSET_DIRECTORY_MAGIC = 0x4A414431; // "JAD1"
+const uint32_t LEGACY_ASSET_DIRECTORY_MAGIC = 0x4A414431; // "JAD1"
+const uint32_t ASSET_DIRECTORY_MAGIC = 0x4A414432;        // "JAD2"
 const size_t MINIMUM_ASSET_DIRECTORY_SIZE = 2 * Flash::BLOCK_SIZE;
 
 const intptr_t EMPTY_HASH = -1;
 const intptr_t DELETED_HASH = 0;
 
+const size_t LEGACY_HASH_TABLE_OFFSET = 8;
+const size_t HASH_TABLE_OFFSET = AlignUp(12, sizeof(intptr_t));
+
 //---------------------------------------------------------------------------
 
 AssetManager AssetManager::instance;
@@ -30,13 +35,31 @@ const void *AssetEntry::GetData() const {
 
 //---------------------------------------------------------------------------
 
-bool AssetDirectory::IsValid() const { return magic == ASSET_DIRECTORY_MAGIC; }
+bool AssetDirectory::IsValid() const {
+  return magic == ASSET_DIRECTORY_MAGIC || IsLegacy();
+}
+
+bool AssetDirectory::IsLegacy() const {
+  return magic == LEGACY_ASSET_DIRECTORY_MAGIC;
+}
+
+const intptr_t *AssetDirectory::GetHashTable() const {
+  const size_t offset =
+      IsLegacy() ? LEGACY_HASH_TABLE_OFFSET : HASH_TABLE_OFFSET;
+  return (const intptr_t *)((const uint8_t *)this + offset);
+}
+
+size_t AssetDirectory::GetHeaderSize(size_t hashTableSize) {
+  return HASH_TABLE_OFFSET + hashTableSize * sizeof(intptr_t);
+}
 
 size_t AssetDirectory::GetAssetCount() const {
   size_t count = 0;
   if (IsValid()) {
-    for (intptr_t value : hashTable) {
-      if (value != DELETED_HASH && value != EMPTY_HASH) {
+    const intptr_t *hashTable = GetHashTable();
+    const size_t hashTableSize = GetHashTableSize();
+    for (size_t i = 0; i < hashTableSize; ++i) {
+      if (hashTable[i] != DELETED_HASH && hashTable[i] != EMPTY_HASH) {
         ++count;
       }
     }
@@ -47,9 +70,11 @@ size_t AssetDirectory::GetAssetCount() const {
 const AssetEntry *AssetDirectory::GetAsset(const char *id) const {
   const size_t idLength = Str::Length(id);
   const uint32_t hash = Crc32::Hash(id, idLength);
+  const intptr_t *hashTable = GetHashTable();
+  const size_t mask = GetHashTableSize() - 1;
   uint32_t index = hash;
   for (;;) {
-    const intptr_t value = hashTable[index & HASH_TABLE_MASK];
+    const intptr_t value = hashTable[index & mask];
     if (value == EMPTY_HASH) {
       return nullptr;
     }
@@ -68,7 +93,10 @@ const AssetEntry *AssetDirectory::GetAsset(const char *id) const {
 void AssetDirectory::ListAssets() const {
   Console::Printf("[");
   bool isFirst = true;
-  for (const intptr_t value : hashTable) {
+  const intptr_t *hashTable = GetHashTable();
+  const size_t hashTableSize = GetHashTableSize();
+  for (size_t i = 0; i < hashTableSize; ++i) {
+    const intptr_t value = hashTable[i];
     if (value == DELETED_HASH || value == EMPTY_HASH) {
       continue;
     }
@@ -81,6 +109,42 @@ void AssetDirectory::ListAssets() const {
   Console::Printf("]\n\n");
 }
 
+AssetDirectory::Statistics AssetDirectory::GetStatistics() const {
+  const intptr_t *hashTable = GetHashTable();
+  const size_t hashTableSize = GetHashTableSize();
+  const size_t mask = hashTableSize - 1;
+
+  Statistics statistics = {
+      .count = 0,
+      .capacity = hashTableSize,
+      .maxProbeLength = 0,
+      .totalProbeLength = 0,
+  };
+  for (size_t i = 0; i < hashTableSize; ++i) {
+    const intptr_t value = hashTable[i];
+    if (value == DELETED_HASH || value == EMPTY_HASH) {
+      continue;
+    }
+
+    const AssetEntry *entry = (const AssetEntry *)value;
+    const size_t probeLength = ((i - entry->idHash) & mask) + 1;
+    ++statistics.count;
+    statistics.totalProbeLength += probeLength;
+    if (probeLength > statistics.maxProbeLength) {
+      statistics.maxProbeLength = probeLength;
+    }
+  }
+  return statistics;
+}
+
+void AssetDirectory::PrintStatistics() const {
+  const Statistics statistics = GetStatistics();
+  Console::Printf("{\"count\":%zu,\"capacity\":%zu,\"maxProbeLength\":%zu,"
+                  "\"totalProbeLength\":%zu}\n\n",
+                  statistics.count, statistics.capacity,
+                  statistics.maxProbeLength, statistics.totalProbeLength);
+}
+
 //---------------------------------------------------------------------------
 
 void AssetManager::Initialize(intptr_t directoryAddress, intptr_t directorySize,
@@ -115,7 +179,10 @@ const void *AssetManager::GetAssetData(const char *id) {
 intptr_t AssetManager::GetEndEmptyDataRegion() const {
   intptr_t endEmptyRegion = intptr_t(directory) + directorySize;
   if (IsValid()) {
-    for (intptr_t value : directory->hashTable) {
+    const intptr_t *hashTable = directory->GetHashTable();
+    const size_t hashTableSize = directory->GetHashTableSize();
+    for (size_t i = 0; i < hashTableSize; ++i) {
+      const intptr_t value = hashTable[i];
       if (value != DELETED_HASH && value != EMPTY_HASH) {
         if (value < endEmptyRegion) {
           endEmptyRegion = value;
@@ -126,6 +193,13 @@ intptr_t AssetManager::GetEndEmptyDataRegion() const {
   return endEmptyRegion;
 }
 
+AssetDirectory::Statistics AssetManager::GetStatistics() const {
+  if (!IsValid()) {
+    return {};
+  }
+  return directory->GetStatistics();
+}
+
 size_t AssetManager::GetFreeSize() const {
   if (directory == nullptr || directorySize < MINIMUM_ASSET_DIRECTORY_SIZE) {
     return 0;
@@ -142,10 +216,6 @@ const char *AssetManager::AddAsset(const char *id, size_t size) {
     ResetHeader();
   }
 
-  if (directory->GetAssetCount() >= AssetDirectory::MAX_ASSET_COUNT) {
-    return "Too many assets";
-  }
-
   const size_t idLength = Str::Length(id);
   if (idLength > 248) {
     return "Asset name too long";
@@ -156,6 +226,13 @@ const char *AssetManager::AddAsset(const char *id, size_t size) {
   const size_t paddedDataSize = AlignUp(size, 4);
 
   const AssetEntry *existingEntry = directory->GetAsset(id);
+  if (existingEntry == nullptr) {
+    const char *errorMessage = ReserveHashTableEntry();
+    if (errorMessage) {
+      return errorMessage;
+    }
+  }
+
   if (existingEntry != nullptr && size <= existingEntry->size) {
     Flash::instance.BeginWrite((uint8_t *)existingEntry);
   } else {
@@ -182,6 +259,65 @@ const char *AssetManager::AddAsset(const char *id, size_t size) {
   return nullptr;
 }
 
+// Keeps the load factor at or below 50%, doubling the table when there is
+// free space for it. Otherwise the table is filled until one empty slot
+// remains, which GetAsset() requires to terminate.
+const char *AssetManager::ReserveHashTableEntry() {
+  const size_t assetCount = directory->GetAssetCount();
+  const size_t hashTableSize = directory->GetHashTableSize();
+  if (2 * (assetCount + 1) <= hashTableSize) {
+    return nullptr;
+  }
+
+  const size_t newHashTableSize = 2 * hashTableSize;
+  const intptr_t newHeaderEnd =
+      intptr_t(directory) + AssetDirectory::GetHeaderSize(newHashTableSize);
+  if (newHeaderEnd <= GetEndEmptyDataRegion()) {
+    WriteDirectory(newHashTableSize, true);
+    return nullptr;
+  }
+
+  if (assetCount + 1 < hashTableSize) {
+    return nullptr;
+  }
+  return "Too many assets";
+}
+
+void AssetManager::WriteDirectory(size_t hashTableSize, bool preserveAssets) {
+  const size_t headerSize = AssetDirectory::GetHeaderSize(hashTableSize);
+  uint8_t *buffer = new uint8_t[headerSize];
+  AssetDirectory *newDirectory = (AssetDirectory *)buffer;
+  newDirectory->magic = ASSET_DIRECTORY_MAGIC;
+  newDirectory->timestamp = timestamp;
+  newDirectory->hashTableSize = hashTableSize;
+
+  intptr_t *newHashTable = newDirectory->GetHashTable();
+  Mem::Fill(newHashTable, hashTableSize * sizeof(intptr_t));
+
+  if (preserveAssets) {
+    const intptr_t *hashTable = directory->GetHashTable();
+    const size_t mask = hashTableSize - 1;
+    for (size_t i = 0; i < directory->GetHashTableSize(); ++i) {
+      const intptr_t value = hashTable[i];
+      if (value == DELETED_HASH || value == EMPTY_HASH) {
+        continue;
+      }
+
+      uint32_t index = ((const AssetEntry *)value)->idHash;
+      while (newHashTable[index & mask] != EMPTY_HASH) {
+        ++index;
+      }
+      newHashTable[index & mask] = value;
+    }
+  }
+
+  Flash::Write(directory, buffer, headerSize,
+               preserveAssets ? FlashWriteMode::PRESERVE
+                              : FlashWriteMode::RESET);
+
+  delete[] buffer;
+}
+
 void AssetManager::BeginWrite(const uint8_t *address) {
   Flash::instance.target = address;
   Flash::instance.writeStart = address;
@@ -193,44 +329,38 @@ void AssetManager::BeginWrite(const uint8_t *address) {
   const uint8_t *baseAddress =
       AlignDown(address, Flash::WRITE_DATA_BUFFER_SIZE);
 
-  if (IsValid() &&
-      (uint8_t *)directory + sizeof(AssetDirectory) > baseAddress) {
-    const size_t copyBytes =
-        (uint8_t *)directory + sizeof(AssetDirectory) - baseAddress;
+  const uint8_t *headerEnd =
+      IsValid() ? (uint8_t *)directory->GetStartDataRegion() : nullptr;
+  if (headerEnd > baseAddress) {
+    const size_t copyBytes = headerEnd - baseAddress;
     Mem::Copy(Flash::instance.buffer, baseAddress,
               copyBytes & (Flash::WRITE_DATA_BUFFER_SIZE - 1));
   }
 }
 
 void AssetManager::ResetHeader() {
-  AssetDirectory *newDirectory = new AssetDirectory;
-  newDirectory->magic = ASSET_DIRECTORY_MAGIC;
-  newDirectory->timestamp = timestamp;
-  Mem::Fill(newDirectory->hashTable);
-
-  Flash::Write(directory, newDirectory, sizeof(AssetDirectory),
-               FlashWriteMode::RESET);
-
-  delete newDirectory;
+  WriteDirectory(AssetDirectory::INITIAL_HASH_TABLE_SIZE, false);
 }
 
 void AssetManager::WriteHeader() {
   const AssetEntry *newEntry = (AssetEntry *)Flash::instance.writeStart;
   const uint32_t hash = newEntry->idHash;
 
+  const intptr_t *hashTable = directory->GetHashTable();
+  const size_t mask = directory->GetHashTableSize() - 1;
   uint32_t index = hash;
   for (;;) {
-    index &= AssetDirectory::HASH_TABLE_MASK;
-    const intptr_t value = directory->hashTable[index];
+    index &= mask;
+    const intptr_t value = hashTable[index];
     if (value == DELETED_HASH || value == EMPTY_HASH) {
-      Flash::Write(&directory->hashTable[index], &newEntry,
+      Flash::Write(&hashTable[index], &newEntry,
                    sizeof(AssetEntry *), FlashWriteMode::PRESERVE);
       return;
     }
 
     const AssetEntry *entry = (const AssetEntry *)value;
     if (entry->idHash == hash && Str::Eq(entry->id, newEntry->id)) {
-      Flash::Write(&directory->hashTable[index], &newEntry,
+      Flash::Write(&hashTable[index], &newEntry,
                    sizeof(AssetEntry *), FlashWriteMode::PRESERVE);
       return;
     }
@@ -299,8 +429,8 @@ void AssetManager::AssetData_Binding(void *context, const char *commandLine) {
     return;
   }
 
-  uint8_t decodeBuffer[256];
-  const size_t byteCount = Base64::Decode(decodeBuffer, (const uint8_t *)p);
+  const size_t byteCount =
+      Base64::Decode(Console::decodeBuffer, (const uint8_t *)p);
 
   if (byteCount == 0) {
     Console::Printf("ERR No data\n\n");
@@ -314,7 +444,7 @@ void AssetManager::AssetData_Binding(void *context, const char *commandLine) {
     return;
   }
 
-  if (!instance->Write(decodeBuffer, byteCount)) {
+  if (!instance->Write(Console::decodeBuffer, byteCount)) {
     Console::SendOk();
   } else {
     Console::Printf("OK Completed\n\n");
@@ -337,6 +467,88 @@ void AssetManager::GetAsset_Binding(void *context, const char *commandLine) {
   Console::Printf("%D\n\n", entry->GetData(), entry->size);
 }
 
+// read_asset <offset> <length> <assetId>
+//
+// Returns up to MAX_READ_SIZE bytes, base64 encoded. Reads past the end of
+// the asset are truncated, so an empty response marks the end.
+void AssetManager::ReadAsset_Binding(void *context, const char *commandLine) {
+  const char *p = strchr(commandLine, ' ');
+  if (!p) {
+    Console::Printf("ERR No offset specified\n\n");
+    return;
+  }
+  ++p;
+  int offset;
+  p = Str::ParseInteger(&offset, p);
+  if (!p || offset < 0) {
+    Console::Printf("ERR Unable to parse offset\n\n");
+    return;
+  }
+  if (*p != ' ') {
+    Console::Printf("ERR No length specified\n\n");
+    return;
+  }
+  ++p;
+  int length;
+  p = Str::ParseInteger(&length, p);
+  if (!p || length < 0) {
+    Console::Printf("ERR Unable to parse length\n\n");
+    return;
+  }
+  if (*p != ' ') {
+    Console::Printf("ERR No assetId specified\n\n");
+    return;
+  }
+  ++p;
+
+  const AssetManager *instance = (AssetManager *)context;
+  const AssetEntry *entry = instance->GetAsset(p);
+  if (entry == nullptr) {
+    Console::Printf("ERR assetId not found\n\n");
+    return;
+  }
+
+  size_t byteCount = 0;
+  if ((size_t)offset < entry->size) {
+    byteCount = entry->size - offset;
+    if (byteCount > (size_t)length) {
+      byteCount = length;
+    }
+    if (byteCount > MAX_READ_SIZE) {
+      byteCount = MAX_READ_SIZE;
+    }
+  }
+  const uint8_t *data = (const uint8_t *)entry->GetData();
+  Console::Printf("%D\n\n", data + offset, byteCount);
+}
+
+void AssetManager::GetAssetCrc_Binding(void *context, const char *commandLine) {
+  const char *p = strchr(commandLine, ' ');
+  if (!p) {
+    Console::Printf("ERR No assetId specified\n\n");
+    return;
+  }
+  ++p;
+  const AssetManager *instance = (AssetManager *)context;
+  const AssetEntry *entry = instance->GetAsset(p);
+  if (entry == nullptr) {
+    Console::Printf("ERR assetId not found\n\n");
+    return;
+  }
+  Console::Printf("%u\n\n", Crc32::Hash(entry->GetData(), entry->size));
+}
+
+void AssetManager::GetAssetStatistics_Binding(void *context,
+                                              const char *commandLine) {
+  const AssetManager *instance = (AssetManager *)context;
+  if (!instance->IsValid()) {
+    Console::Printf("ERR No assets\n\n");
+    return;
+  }
+
+  instance->directory->PrintStatistics();
+}
+
 void AssetManager::ListAssets_Binding(void *context, const char *commandLine) {
   const AssetManager *instance = (AssetManager *)context;
   if (!instance->IsValid()) {
@@ -362,6 +574,15 @@ void AssetManager::AddConsoleCommands(Console &console) {
                           &ListAssets_Binding, &instance);
   console.RegisterCommand("get_asset", "Gets asset with specified id",
                           &GetAsset_Binding, &instance);
+  console.RegisterCommand("read_asset",
+                          "Reads a range of bytes from the specified asset",
+                          &ReadAsset_Binding, &instance);
+  console.RegisterCommand("get_asset_crc",
+                          "Gets the CRC32 of the specified asset's data",
+                          &GetAssetCrc_Binding, &instance);
+  console.RegisterCommand("get_asset_stats",
+                          "Gets asset directory hash table statistics",
+                          &GetAssetStatistics_Binding, &instance);
   console.RegisterCommand("add_asset", "Adds an asset to the device",
                           &AddAsset_Binding, &instance);
   console.RegisterCommand(
@@ -369,6 +590,32 @@ void AssetManager::AddConsoleCommands(Console &console) {
       &AssetData_Binding, &instance);
   console.RegisterCommand("reset_assets", "Removes all assets on the device",
                           &ResetAssets_Binding, &instance);
+
+  Metrics::Register(
+      "assets", "count", MetricType::GAUGE,
+      [](const void *context) -> size_t {
+        return ((const AssetManager *)context)->GetStatistics().count;
+      },
+      &instance);
+  Metrics::Register(
+      "assets", "capacity", MetricType::GAUGE,
+      [](const void *context) -> size_t {
+        return ((const AssetManager *)context)->GetStatistics().capacity;
+      },
+      &instance);
+  Metrics::Register(
+      "assets", "maxProbeLength", MetricType::GAUGE,
+      [](const void *context) -> size_t {
+        const AssetManager *assetManager = (const AssetManager *)context;
+        return assetManager->GetStatistics().maxProbeLength;
+      },
+      &instance);
+  Metrics::Register(
+      "assets", "freeBytes", MetricType::GAUGE,
+      [](const void *context) -> size_t {
+        return ((const AssetManager *)context)->GetFreeSize();
+      },
+      &instance);
 }
 
 //---------------------------------------------------------------------------
@@ -381,9 +628,18 @@ void AssetManager::AddConsoleCommands(Console &console) {
 class AssetManagerTest {
 public:
   static void TestAddition();
+  static void TestGrowth();
+  static void TestLegacyDirectory();
+  static void TestLegacyDirectoryGrowth();
+  static void TestRead();
+
+private:
+  static void AddAsset(const char *id, const uint8_t *data, size_t size);
+  static void RunCommand(void (*handler)(void *, const char *),
+                         const char *line, const char *expected);
 };
 
-[[gnu::aligned(4096)]] static char assetData[16 * 1024];
+[[gnu::aligned(4096)]] static char assetData[64 * 1024];
 
 void AssetManagerTest::TestAddition() {
   char *buffer = assetData;
@@ -415,9 +671,152 @@ void AssetManagerTest::TestAddition() {
   assert(memcmp(entry->GetData(), data, 64) == 0);
 }
 
+void AssetManagerTest::AddAsset(const char *id, const uint8_t *data,
+                                size_t size) {
+  assert(AssetManager::instance.AddAsset(id, size) == nullptr);
+  assert(AssetManager::instance.Write(data, size));
+}
+
+void AssetManagerTest::RunCommand(void (*handler)(void *, const char *),
+                                  const char *line, const char *expected) {
+  handler(&AssetManager::instance, line);
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(), expected));
+  Console::history.clear();
+}
+
+void AssetManagerTest::TestGrowth() {
+  memset(assetData, 0, sizeof(assetData));
+  AssetManager::Initialize(intptr_t(assetData), sizeof(assetData), 0);
+
+  const size_t ASSET_COUNT = 200;
+  char id[16];
+  for (size_t i = 0; i < ASSET_COUNT; ++i) {
+    snprintf(id, sizeof(id), "asset_%zu", i);
+    const uint8_t data[4] = {uint8_t(i), 1, 2, 3};
+    AddAsset(id, data, sizeof(data));
+  }
+
+  const AssetDirectory *directory = AssetManager::instance.directory;
+  assert(directory->GetAssetCount() == ASSET_COUNT);
+  assert(directory->GetHashTableSize() == 512);
+  for (size_t i = 0; i < ASSET_COUNT; ++i) {
+    snprintf(id, sizeof(id), "asset_%zu", i);
+    const AssetEntry *entry = AssetManager::GetAsset(id);
+    assert(entry != nullptr);
+    assert(*(const uint8_t *)entry->GetData() == uint8_t(i));
+  }
+  assert(AssetManager::GetAsset("asset_200") == nullptr);
+
+  AssetManager::GetAssetStatistics_Binding(&AssetManager::instance,
+                                           "get_asset_stats");
+  Console::history.push_back(0);
+  size_t count, capacity, maxProbeLength, totalProbeLength;
+  assert(sscanf(&Console::history.front(),
+                "{\"count\":%zu,\"capacity\":%zu,\"maxProbeLength\":%zu,"
+                "\"totalProbeLength\":%zu}",
+                &count, &capacity, &maxProbeLength,
+                &totalProbeLength) == 4);
+  Console::history.clear();
+  assert(count == ASSET_COUNT);
+  assert(capacity == 512);
+  assert(1 <= maxProbeLength && maxProbeLength < 16);
+  assert(count <= totalProbeLength && totalProbeLength < 2 * count);
+}
+
+void AssetManagerTest::TestLegacyDirectory() {
+  memset(assetData, 0xff, sizeof(assetData));
+  AssetManager::Initialize(intptr_t(assetData), sizeof(assetData), 0);
+  const uint32_t header[2] = {0x4A414431, 0};
+  memcpy(assetData, header, sizeof(header));
+
+  const AssetDirectory *directory = AssetManager::instance.directory;
+  assert(AssetManager::instance.IsValid());
+  assert(directory->IsLegacy());
+  assert(directory->GetHashTableSize() == 1024);
+
+  const uint8_t data[4] = {1, 2, 3, 4};
+  AddAsset("legacy", data, sizeof(data));
+  assert(directory->IsLegacy());
+  const void *legacyData = AssetManager::GetAssetData("legacy");
+  assert(memcmp(legacyData, data, sizeof(data)) == 0);
+}
+
+void AssetManagerTest::TestLegacyDirectoryGrowth() {
+  memset(assetData, 0xff, sizeof(assetData));
+  AssetManager::Initialize(intptr_t(assetData), sizeof(assetData), 0);
+  const uint32_t header[2] = {0x4A414431, 0};
+  memcpy(assetData, header, sizeof(header));
+
+  // The legacy table holds 512 assets at a 50% load factor, so the 513th
+  // rewrites the directory in the current format.
+  const size_t ASSET_COUNT = 600;
+  char id[16];
+  for (size_t i = 0; i < ASSET_COUNT; ++i) {
+    snprintf(id, sizeof(id), "asset_%zu", i);
+    const uint8_t data[4] = {uint8_t(i), uint8_t(i >> 8), 2, 3};
+    AddAsset(id, data, sizeof(data));
+    assert(AssetManager::instance.directory->IsLegacy() == (i < 512));
+  }
+
+  const AssetDirectory *directory = AssetManager::instance.directory;
+  assert(AssetManager::instance.IsValid());
+  assert(directory->GetHashTableSize() == 2048);
+  assert(directory->GetAssetCount() == ASSET_COUNT);
+  for (size_t i = 0; i < ASSET_COUNT; ++i) {
+    snprintf(id, sizeof(id), "asset_%zu", i);
+    const uint8_t *data = (const uint8_t *)AssetManager::GetAssetData(id);
+    assert(data != nullptr);
+    assert(data[0] == uint8_t(i) && data[1] == uint8_t(i >> 8));
+  }
+}
+
+void AssetManagerTest::TestRead() {
+  memset(assetData, 0, sizeof(assetData));
+  AssetManager::Initialize(intptr_t(assetData), sizeof(assetData), 0);
+
+  const uint8_t data[] = "Hello World";
+  AddAsset("hello", data, 11);
+
+  RunCommand(&AssetManager::ReadAsset_Binding, "read_asset 0 5 hello",
+             "SGVsbG8=\n\n");
+  RunCommand(&AssetManager::ReadAsset_Binding, "read_asset 6 100 hello",
+             "V29ybGQ=\n\n");
+  RunCommand(&AssetManager::ReadAsset_Binding, "read_asset 11 5 hello",
+             "\n\n");
+  RunCommand(&AssetManager::ReadAsset_Binding, "read_asset 0 5 missing",
+             "ERR assetId not found\n\n");
+
+  char expected[16];
+  snprintf(expected, sizeof(expected), "%u\n\n",
+           (unsigned)Crc32::Hash(data, 11));
+  RunCommand(&AssetManager::GetAssetCrc_Binding, "get_asset_crc hello",
+             expected);
+}
+
 TEST_BEGIN("AssetManager: Test addition of asset") {
   AssetManagerTest::TestAddition();
 }
 TEST_END
 
+TEST_BEGIN("AssetManager: Hash table grows with asset count") {
+  AssetManagerTest::TestGrowth();
+}
+TEST_END
+
+TEST_BEGIN("AssetManager: Legacy directories are readable") {
+  AssetManagerTest::TestLegacyDirectory();
+}
+TEST_END
+
+TEST_BEGIN("AssetManager: Legacy directories are rewritten on growth") {
+  AssetManagerTest::TestLegacyDirectoryGrowth();
+}
+TEST_END
+
+TEST_BEGIN("AssetManager: Read asset ranges and CRC") {
+  AssetManagerTest::TestRead();
+}
+TEST_END
+
 //---------------------------------------------------------------------------
@@ -1,7 +1,6 @@
 //---------------------------------------------------------------------------
 
 #pragma once
-#include "malloc_allocate.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -20,22 +19,55 @@ struct AssetEntry {
 };
 static_assert(sizeof(AssetEntry) == 12);
 
-struct AssetDirectory : public JavelinMallocAllocate {
-  static const size_t HASH_TABLE_SIZE = 1024;
-  static const size_t HASH_TABLE_MASK = HASH_TABLE_SIZE - 1;
-  static const size_t MAX_ASSET_COUNT = 512;
+// The hash table starts small and is doubled in place as assets are added,
+// using free space between the table and the lowest asset.
+//
+// Version 1 directories have a fixed LEGACY_HASH_TABLE_SIZE table in place
+// of hashTableSize. They are still read, and are rewritten as version 2
+// when the table needs to grow.
+struct AssetDirectory {
+  static const size_t LEGACY_HASH_TABLE_SIZE = 1024;
+  static const size_t INITIAL_HASH_TABLE_SIZE = 64;
 
   uint32_t magic;
   uint32_t timestamp;
-  intptr_t hashTable[HASH_TABLE_SIZE];
+  uint32_t hashTableSize;
 
   bool IsValid() const;
+  bool IsLegacy() const;
+
+  size_t GetHashTableSize() const {
+    return IsLegacy() ? LEGACY_HASH_TABLE_SIZE : hashTableSize;
+  }
+  const intptr_t *GetHashTable() const;
+  intptr_t *GetHashTable() {
+    return (intptr_t *)((const AssetDirectory *)this)->GetHashTable();
+  }
+
   size_t GetAssetCount() const;
   const AssetEntry *GetAsset(const char *id) const;
 
+  // Probe lengths count the slots visited by a successful GetAsset(), so a
+  // directory with no collisions has maxProbeLength 1.
+  struct Statistics {
+    size_t count;
+    size_t capacity;
+    size_t maxProbeLength;
+    size_t totalProbeLength;
+  };
+  Statistics GetStatistics() const;
+
   void ListAssets() const;
+  void PrintStatistics() const;
+
+  size_t GetHeaderSize() const {
+    return (const uint8_t *)GetStartDataRegion() - (const uint8_t *)this;
+  }
+  const void *GetStartDataRegion() const {
+    return GetHashTable() + GetHashTableSize();
+  }
 
-  const void *GetStartDataRegion() const { return hashTable + HASH_TABLE_SIZE; }
+  static size_t GetHeaderSize(size_t hashTableSize);
 };
 
 //---------------------------------------------------------------------------
@@ -48,6 +80,9 @@ public:
   static const AssetEntry *GetAsset(const char *id);
   static const void *GetAssetData(const char *id);
 
+  // Chunk size for read_asset.
+  static const size_t MAX_READ_SIZE = 1536;
+
   static void AddConsoleCommands(Console &console);
 
   size_t GetFreeSize() const;
@@ -63,10 +98,16 @@ private:
   uint32_t assetDataBytesRemaining;
 
   intptr_t GetEndEmptyDataRegion() const;
+  AssetDirectory::Statistics GetStatistics() const;
 
   // Returns error message, or nullptr if successful.
   const char *AddAsset(const char *id, size_t size);
 
+  // Ensures there is space in the hash table for another asset.
+  // Returns error message, or nullptr if successful.
+  const char *ReserveHashTableEntry();
+  void WriteDirectory(size_t hashTableSize, bool preserveAssets);
+
   void BeginWrite(const uint8_t *address);
   bool Write(const uint8_t *data, size_t byteCount);
   void ResetHeader();
@@ -75,6 +116,10 @@ private:
   static void AddAsset_Binding(void *context, const char *commandLine);
   static void AssetData_Binding(void *context, const char *commandLine);
   static void GetAsset_Binding(void *context, const char *commandLine);
+  static void GetAssetCrc_Binding(void *context, const char *commandLine);
+  static void GetAssetStatistics_Binding(void *context,
+                                         const char *commandLine);
+  static void ReadAsset_Binding(void *context, const char *commandLine);
   static void ListAssets_Binding(void *context, const char *commandLine);
   static void ResetAssets_Binding(void *context, const char *commandLine);
 
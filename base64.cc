@@ -38,40 +38,128 @@ bool Base64::IsValid(const char *p) {
 size_t Base64::Decode(uint8_t *destination, const uint8_t *source) {
   uint8_t *const startDestination = destination;
 
-  int value = 0;
-  int bytes = 0;
-  int dummyBytes = 0;
-
-  while (*source) {
-    const int d = BASE64_DECODE_TABLE[*source++];
-    if (d == -2) {
-      continue;
-    }
+  for (;;) {
+    // Fast path: decode whole quads while they contain no whitespace,
+    // padding or terminator. Each character is checked before the next is
+    // read so that reads never pass the terminator.
+    for (;;) {
+      const int a = BASE64_DECODE_TABLE[source[0]];
+      if (a < 0) {
+        break;
+      }
+      const int b = BASE64_DECODE_TABLE[source[1]];
+      if (b < 0) {
+        break;
+      }
+      const int c = BASE64_DECODE_TABLE[source[2]];
+      if (c < 0) {
+        break;
+      }
+      const int d = BASE64_DECODE_TABLE[source[3]];
+      if (d < 0) {
+        break;
+      }
 
-    value <<= 6;
-    if (d >= 0) {
-      value += d;
-    } else {
-      dummyBytes++;
+      const uint32_t value = (a << 18) | (b << 12) | (c << 6) | d;
+      destination[0] = value >> 16;
+      destination[1] = value >> 8;
+      destination[2] = value;
+      destination += 3;
+      source += 4;
     }
 
-    if (++bytes == 4) {
-      *destination++ = value >> 16;
-      if (dummyBytes > 1) {
+    // Slow path: decode a single quad, skipping invalid characters.
+    int value = 0;
+    int bytes = 0;
+    int dummyBytes = 0;
+    while (bytes < 4) {
+      if (*source == 0) {
         goto exit;
       }
-      *destination++ = value >> 8;
-      if (dummyBytes == 1) {
-        goto exit;
+      const int d = BASE64_DECODE_TABLE[*source++];
+      if (d == -2) {
+        continue;
+      }
+
+      value <<= 6;
+      if (d >= 0) {
+        value += d;
+      } else {
+        dummyBytes++;
       }
-      *destination++ = value;
-      bytes = 0;
-      value = 0;
+      ++bytes;
     }
+
+    *destination++ = value >> 16;
+    if (dummyBytes > 1) {
+      goto exit;
+    }
+    *destination++ = value >> 8;
+    if (dummyBytes == 1) {
+      goto exit;
+    }
+    *destination++ = value;
   }
 
 exit:
   return destination - startDestination;
 }
 
-//---------------------------------------------------------------------------
\ No newline at end of file
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "unit_test.h"
+#include "writer.h"
+#include <string.h>
+
+#define DO_PROFILE_TEST 0
+
+//---------------------------------------------------------------------------
+
+TEST_BEGIN("Base64: Decodes padding and whitespace") {
+  uint8_t buffer[16];
+  assert(Base64::Decode(buffer, (const uint8_t *)"SGVsbG8=") == 5);
+  assert(memcmp(buffer, "Hello", 5) == 0);
+
+  assert(Base64::Decode(buffer, (const uint8_t *)"SGVs bG8h\nSGk=") == 8);
+  assert(memcmp(buffer, "Hello!Hi", 8) == 0);
+
+  assert(Base64::Decode(buffer, (const uint8_t *)"SA==") == 1);
+  assert(buffer[0] == 'H');
+
+  assert(Base64::Decode(buffer, (const uint8_t *)"") == 0);
+}
+TEST_END
+
+TEST_BEGIN("Base64: Decodes full console payloads") {
+#if DO_PROFILE_TEST
+  constexpr size_t ITERATION_COUNT = 100'000;
+#else
+  constexpr size_t ITERATION_COUNT = 10;
+#endif
+  constexpr size_t DATA_SIZE = 1536;
+
+  uint8_t data[DATA_SIZE];
+  for (size_t i = 0; i < DATA_SIZE; ++i) {
+    data[i] = i * 37 + (i >> 3);
+  }
+
+  BufferWriter writer;
+  writer.WriteBase64(data, DATA_SIZE);
+  writer.WriteByte('\0');
+  const uint8_t *encoded = (const uint8_t *)writer.GetBuffer();
+  assert(writer.GetCount() == DATA_SIZE * 4 / 3 + 1);
+
+  uint8_t decoded[DATA_SIZE];
+  const ProfileTimer timer;
+  for (size_t i = 0; i < ITERATION_COUNT; ++i) {
+    assert(Base64::Decode(decoded, encoded) == DATA_SIZE);
+  }
+#if DO_PROFILE_TEST
+  timer.PrintRate("Base64 decode", ITERATION_COUNT * DATA_SIZE, "bytes");
+#endif
+  assert(memcmp(decoded, data, DATA_SIZE) == 0);
+}
+TEST_END
+
+//---------------------------------------------------------------------------
@@ -12,6 +12,7 @@
 #include "engine.h"
 #include "flash.h"
 #include "font/monochrome/font.h"
+#include "font/monochrome/glyph_run_cache.h"
 #include "hal/ble.h"
 #include "hal/connection.h"
 #include "hal/display.h"
@@ -27,6 +28,7 @@
 #include "key.h"
 #include "keyboard_led_status.h"
 #include "malloc_allocate.h"
+#include "metrics.h"
 #include "random.h"
 #include "split/split_power_override.h"
 #include "split/split_usb_status.h"
@@ -92,10 +94,6 @@ private:
 
 //---------------------------------------------------------------------------
 
-ButtonScript::ButtonScript(const uint8_t *byteCode)
-    : Script(byteCode, (void (*const *)(
-                           Script &, const ScriptByteCode *))FUNCTION_TABLE) {}
-
 void ButtonScript::Reset() {
   ReleaseAll();
   isScriptRgbEnabled = true;
@@ -261,6 +259,12 @@ void ButtonScript::PrintInfo() const {
   Console::Printf("]\n");
 }
 
+void ButtonScript::RegisterMetrics() const {
+  Metrics::Register("script", "pressCount", MetricType::COUNTER, &pressCount);
+  Metrics::Register("script", "releaseCount", MetricType::COUNTER,
+                    &releaseCount);
+}
+
 //---------------------------------------------------------------------------
 
 class ButtonScript::NullTimerContext final : public TimerHandler,
@@ -502,7 +506,11 @@ public:
     const int r = script.Pop() & 0xff;
     const int id = (int)script.Pop();
     if (script.isScriptRgbEnabled || !script.IsInbuiltByteCode(byteCode)) {
-      Rgb::SetRgb(id, r, g, b);
+      if (Rgb::IsInFrame()) {
+        Rgb::SetFrameRgb(id, r << 16 | g << 8 | b);
+      } else {
+        Rgb::SetRgb(id, r, g, b);
+      }
     }
   }
 
@@ -635,10 +643,53 @@ public:
     const int h = (int)script.Pop();
     const int id = (int)script.Pop();
     if (script.isScriptRgbEnabled || !script.IsInbuiltByteCode(byteCode)) {
-      Rgb::SetHsv(id, h, s, v);
+      if (Rgb::IsInFrame()) {
+        int r, g, b;
+        Rgb::ConvertHsvToRgb(r, g, b, h, s, v);
+        Rgb::SetFrameRgb(id, r << 16 | g << 8 | b);
+      } else {
+        Rgb::SetHsv(id, h, s, v);
+      }
     }
   }
 
+  static void BeginRgbFrame(ButtonScript &script,
+                            const ScriptByteCode *byteCode) {
+    Rgb::BeginFrame(script.scriptTime);
+  }
+
+  static void CommitRgbFrame(ButtonScript &script,
+                             const ScriptByteCode *byteCode) {
+    Rgb::CommitFrame();
+  }
+
+  static void SetRgbFrame(ButtonScript &script,
+                          const ScriptByteCode *byteCode) {
+    const intptr_t dataOffset = script.Pop();
+    const size_t count = script.Pop();
+    const size_t startId = script.Pop();
+    if (script.isScriptRgbEnabled || !script.IsInbuiltByteCode(byteCode)) {
+      Rgb::SetFrameRgb(startId, byteCode->GetScriptData<Uint32>(dataOffset),
+                       count);
+    }
+  }
+
+  static void SetHsvFrame(ButtonScript &script,
+                          const ScriptByteCode *byteCode) {
+    const intptr_t dataOffset = script.Pop();
+    const size_t count = script.Pop();
+    const size_t startId = script.Pop();
+    if (script.isScriptRgbEnabled || !script.IsInbuiltByteCode(byteCode)) {
+      Rgb::SetFrameHsv(startId, byteCode->GetScriptData<Uint32>(dataOffset),
+                       count);
+    }
+  }
+
+  static void SetRgbGammaCorrection(ButtonScript &script,
+                                    const ScriptByteCode *byteCode) {
+    Rgb::SetGammaCorrection(script.Pop() != 0);
+  }
+
   static void Rand(ButtonScript &script, const ScriptByteCode *byteCode) {
     script.Push(Random::GenerateUint32());
   }
@@ -1284,7 +1335,8 @@ public:
     }
 
     const char *text = byteCode->GetScriptData<char>(textOffset);
-    script.Push(font->GetStringWidth(text));
+    const GlyphRunCache::Run *run = GlyphRunCache::Lookup(fontId, text);
+    script.Push(run ? run->width : font->GetStringWidth(text));
   }
 
   static void EnableScriptRgb(ButtonScript &script,
@@ -1625,8 +1677,167 @@ constexpr void (*ButtonScript::FUNCTION_TABLE[])(ButtonScript &,
     &Function::PointerInput,
     &Function::FormatDateTime,
     &Function::IsDateTimeValid,
+    &Function::BeginRgbFrame,
+    &Function::CommitRgbFrame,
+    &Function::SetRgbFrame,
+    &Function::SetHsvFrame,
+    &Function::SetRgbGammaCorrection,
+};
+
+// {parameterCount, returnCount} for each entry in FUNCTION_TABLE, which
+// ScriptVerifier uses to track the stack across internal calls.
+constexpr ScriptFunctionSignature ButtonScript::FUNCTION_SIGNATURES[] = {
+    {1, 0}, // PressScanCode
+    {1, 0}, // ReleaseScanCode
+    {1, 0}, // TapScanCode
+    {1, 1}, // IsScanCodePressed
+    {1, 0}, // PressStenoKey
+    {1, 0}, // ReleaseStenoKey
+    {1, 1}, // IsStenoKeyPressed
+    {0, 0}, // ReleaseAll
+    {1, 1}, // IsButtonPressed
+    {0, 0}, // PressAll
+    {1, 0}, // SendText
+    {1, 1}, // Console
+    {1, 1}, // CheckButtonState
+    {0, 1}, // IsInPressAll
+    {4, 0}, // SetRgb
+    {0, 1}, // GetTime
+    {1, 1}, // GetLedStatus
+    {2, 0}, // SetGpioPin
+    {1, 0}, // ClearDisplay
+    {2, 0}, // SetAutoDraw
+    {2, 0}, // SetScreenOn
+    {2, 0}, // SetScreenContrast
+    {3, 0}, // DrawPixel
+    {5, 0}, // DrawLine
+    {4, 0}, // DrawImage
+    {6, 0}, // DrawText
+    {2, 0}, // SetDrawColor
+    {5, 0}, // DrawRect
+    {4, 0}, // SetHsv
+    {0, 1}, // Rand
+    {0, 1}, // IsUsbMounted
+    {0, 1}, // IsUsbSuspended
+    {1, 1}, // GetParameter
+    {1, 1}, // IsConnected
+    {0, 1}, // GetActiveConnection
+    {3, 0}, // SetPreferredConnection
+    {1, 1}, // IsPairConnected
+    {0, 0}, // StartBlePairing
+    {0, 1}, // GetBleProfile
+    {1, 0}, // SetBleProfile
+    {0, 1}, // IsHostSleeping
+    {0, 1}, // IsMainPowered
+    {0, 1}, // IsCharging
+    {0, 1}, // GetBatteryPercentage
+    {0, 1}, // GetActivePairConnection
+    {1, 0}, // SetBoardPower
+    {1, 0}, // SendEvent
+    {0, 1}, // IsPairPowered
+    {1, 0}, // SetInputHint
+    {2, 0}, // SetScript
+    {0, 1}, // IsBoardPowered
+    {4, 0}, // StartTimer
+    {1, 0}, // StopTimer
+    {1, 1}, // IsTimerActive
+    {1, 1}, // IsBleProfileConnected
+    {0, 0}, // DisconnectBle
+    {0, 0}, // UnpairBle
+    {1, 1}, // IsBleProfilePaired
+    {1, 1}, // IsBleProfileSleeping
+    {0, 1}, // IsBleAdvertising
+    {0, 1}, // IsBleScanning
+    {0, 1}, // IsWaitingForUserPresence
+    {1, 0}, // ReplyUserPresence
+    {2, 0}, // SetGpioInputPin
+    {1, 1}, // ReadGpioPin
+    {6, 0}, // DrawLuminanceRange
+    {2, 0}, // SetGpioPinDutyCycle
+    {0, 0}, // CancelAllStenoKeys
+    {1, 0}, // CancelStenoKey
+    {0, 0}, // StopSound
+    {1, 0}, // PlayFrequency
+    {1, 0}, // PlaySequence
+    {1, 0}, // PlayWaveform
+    {0, 0}, // CallAllReleaseScripts
+    {0, 1}, // IsInReleaseAll
+    {0, 1}, // GetPressCount
+    {0, 1}, // GetReleaseCount
+    {0, 1}, // IsStenoJoinNext
+    {1, 0}, // PressButton
+    {1, 0}, // ReleaseButton
+    {1, 0}, // PressMouseButton
+    {1, 0}, // ReleaseMouseButton
+    {1, 0}, // TapMouseButton
+    {1, 1}, // IsMouseButtonPressed
+    {2, 0}, // MoveMouse
+    {1, 0}, // VWheelMouse
+    {1, 0}, // SetEnableButtonStates
+    {2, 0}, // PrintValue
+    {1, 1}, // GetWpm
+    {1, 0}, // SetPairBoardPower
+    {1, 0}, // HWheelMouse
+    {0, 0}, // EnableConsole
+    {0, 0}, // DisableConsole
+    {0, 1}, // IsConsoleEnabled
+    {0, 0}, // EnableFlashWrite
+    {0, 0}, // DisableFlashWrite
+    {0, 1}, // IsFlashWriteEnabled
+    {0, 1}, // IsInReinit
+    {4, 0}, // SetDrawColorRgb
+    {4, 0}, // SetDrawColorHsv
+    {3, 0}, // DrawEffect
+    {1, 1}, // Sin
+    {1, 1}, // Cos
+    {1, 1}, // Tan
+    {1, 1}, // Asin
+    {1, 1}, // Acos
+    {1, 1}, // Atan
+    {2, 1}, // Atan2
+    {2, 1}, // FormatString
+    {1, 1}, // GetAsset
+    {5, 0}, // AddCombo
+    {0, 0}, // ResetCombos
+    {4, 0}, // SendInfraredMessage
+    {3, 0}, // SendInfraredData
+    {0, 0}, // StopInfrared
+    {3, 0}, // PrintData
+    {2, 1}, // MeasureTextWidth
+    {0, 0}, // EnableScriptRgb
+    {0, 0}, // DisableScriptRgb
+    {3, 0}, // SendInfraredSignal
+    {1, 1}, // CreateBuffer
+    {3, 0}, // SendMidi
+    {1, 1}, // GetAssetSize
+    {0, 1}, // GetRelyingPartyId
+    {0, 1}, // GetSignatureAlgorithm
+    {1, 0}, // SetSignatureAlgorithms
+    {0, 1}, // IsLocationAdvertising
+    {1, 0}, // SetBleSplitRate
+    {3, 0}, // AnalogInput
+    {2, 0}, // EncoderInput
+    {4, 0}, // PointerInput
+    {1, 1}, // FormatDateTime
+    {0, 1}, // IsDateTimeValid
+    {0, 0}, // BeginRgbFrame
+    {0, 0}, // CommitRgbFrame
+    {3, 0}, // SetRgbFrame
+    {3, 0}, // SetHsvFrame
+    {1, 0}, // SetRgbGammaCorrection
 };
 
+const size_t ButtonScript::FUNCTION_COUNT =
+    sizeof(FUNCTION_TABLE) / sizeof(*FUNCTION_TABLE);
+
+ButtonScript::ButtonScript(const uint8_t *byteCode)
+    : Script(byteCode,
+             (void (*const *)(Script &, const ScriptByteCode *))FUNCTION_TABLE,
+             FUNCTION_COUNT, FUNCTION_SIGNATURES) {
+  static_assert(sizeof(FUNCTION_SIGNATURES) / sizeof(*FUNCTION_SIGNATURES) ==
+                sizeof(FUNCTION_TABLE) / sizeof(*FUNCTION_TABLE));
+}
+
 void ButtonScript::PrintEventHistory() {
   Console::Printf("[");
   bool isFirst = true;
@@ -84,6 +84,7 @@ public:
   }
 
   void PrintInfo() const;
+  void RegisterMetrics() const;
 
   bool IsTickScriptEmpty() const { return IsScriptIndexEmpty(1); }
 
@@ -144,6 +145,8 @@ private:
 
   static constexpr size_t EVENT_HISTORY_COUNT = 4;
   static void (*const FUNCTION_TABLE[])(ButtonScript &, const ScriptByteCode *);
+  static const ScriptFunctionSignature FUNCTION_SIGNATURES[];
+  static const size_t FUNCTION_COUNT;
 
   struct ScriptCallback {
     const ScriptByteCode *byteCode;
@@ -5,6 +5,8 @@
 #include "clock.h"
 #include "console.h"
 #include "flash.h"
+#include "hal/rgb.h"
+#include "latency_histogram.h"
 #include "str.h"
 #include "timer_manager.h"
 #include "unicode.h"
@@ -90,6 +92,7 @@ ButtonScriptManager::ButtonScriptManager(const uint8_t *scriptByteCode)
   isScriptValid = script.IsValid();
   hasTickScript = isScriptValid && HasTickScript();
   if (isScriptValid) {
+    script.PrepareSuperInstructions();
     script.ExecuteInitScript(Clock::GetMilliseconds());
   }
 }
@@ -104,6 +107,7 @@ void ButtonScriptManager::Update(const ButtonState &newButtonState,
     return;
   }
 
+  const LatencySentry latencySentry(LatencyStage::BUTTON_UPDATE);
   const ButtonState pressedButtons = newButtonState & ~buttonState;
   const ButtonState releasedButtons = buttonState & ~newButtonState;
 
@@ -217,8 +221,9 @@ void ButtonScriptManager::ReleaseButton(size_t buttonIndex,
   }
   activeComboButtonState.Clear(buttonIndex);
 
-  for (Combo &combo : combos) {
-    if (combo.isPressed && combo.buttonState.IsSet(buttonIndex)) {
+  for (const size_t comboIndex : GetCombosWithButton(buttonIndex)) {
+    Combo &combo = combos[comboIndex];
+    if (combo.isPressed) {
       if (!combo.isReleased) {
         combo.isReleased = true;
         script.ExecuteScriptCallback(combo.byteCode, combo.releaseScriptOffset,
@@ -274,9 +279,14 @@ void ButtonScriptManager::TriggerRelease(size_t index, uint32_t scriptTime) {
 }
 
 ComboMatches ButtonScriptManager::Match(size_t buttonCount) {
-  const ButtonState state = pendingComboButtons.CreateButtonState(buttonCount);
   ComboMatches matches;
-  for (Combo &combo : combos) {
+  if (buttonCount == 0) {
+    return matches;
+  }
+
+  const ButtonState state = pendingComboButtons.CreateButtonState(buttonCount);
+  for (const size_t comboIndex : GetCandidateCombos(buttonCount)) {
+    Combo &combo = combos[comboIndex];
     switch (combo.Match(pendingComboButtons, buttonCount, state)) {
     case ComboMatch::NO_MATCH:
       break;
@@ -340,6 +350,7 @@ void ButtonScriptManager::AddCombo(bool isOrdered, int comboTimeOut,
           "AddCombo warning - replacing previously registered combo\n\n");
       combo.Set(isOrdered, comboTimeOut, buttonList, byteCode,
                 pressScriptOffset, releaseScriptOffset);
+      RebuildComboIndex();
       return;
     }
   }
@@ -347,6 +358,7 @@ void ButtonScriptManager::AddCombo(bool isOrdered, int comboTimeOut,
   Combo &combo = combos.Add();
   combo.Set(isOrdered, comboTimeOut, buttonList, byteCode, pressScriptOffset,
             releaseScriptOffset);
+  AddComboToIndex(combos.GetCount() - 1);
 }
 
 void ButtonScriptManager::ResetCombos() {
@@ -363,11 +375,74 @@ void ButtonScriptManager::ResetComboData() {
   pendingComboButtons.Reset();
   activeComboButtonState.ClearAll();
   combos.Reset();
+  RebuildComboIndex();
+}
+
+#if USE_COMBO_BUTTON_INDEX
+
+ButtonScriptManager::ComboSet
+ButtonScriptManager::GetCombosWithButton(size_t buttonIndex) const {
+  return buttonCombos[buttonIndex];
+}
+
+// Only combos that include every pending button can match.
+ButtonScriptManager::ComboSet
+ButtonScriptManager::GetCandidateCombos(size_t buttonCount) const {
+  ComboSet candidates = buttonCombos[pendingComboButtons[0].buttonIndex];
+  for (size_t i = 1; i < buttonCount; ++i) {
+    candidates &= buttonCombos[pendingComboButtons[i].buttonIndex];
+  }
+  return candidates;
 }
 
+void ButtonScriptManager::AddComboToIndex(size_t comboIndex) {
+  for (const size_t buttonIndex : combos[comboIndex].buttonState) {
+    buttonCombos[buttonIndex].Set(comboIndex);
+  }
+}
+
+void ButtonScriptManager::RebuildComboIndex() {
+  for (ComboSet &comboSet : buttonCombos) {
+    comboSet.ClearAll();
+  }
+  for (size_t i = 0; i < combos.GetCount(); ++i) {
+    AddComboToIndex(i);
+  }
+}
+
+#else
+
+ButtonScriptManager::ComboSet
+ButtonScriptManager::GetCombosWithButton(size_t buttonIndex) const {
+  ComboSet result;
+  result.ClearAll();
+  for (size_t i = 0; i < combos.GetCount(); ++i) {
+    if (combos[i].buttonState.IsSet(buttonIndex)) {
+      result.Set(i);
+    }
+  }
+  return result;
+}
+
+ButtonScriptManager::ComboSet
+ButtonScriptManager::GetCandidateCombos(size_t buttonCount) const {
+  ComboSet result;
+  result.ClearAll();
+  for (size_t i = 0; i < combos.GetCount(); ++i) {
+    result.Set(i);
+  }
+  return result;
+}
+
+void ButtonScriptManager::AddComboToIndex(size_t comboIndex) {}
+void ButtonScriptManager::RebuildComboIndex() {}
+
+#endif
+
 void ButtonScriptManager::CancelAllCombosForByteCode(
     const Interval<const uint8_t *> &byteCodeRange) {
-  for (size_t i = combos.GetCount(); i != 0;) {
+  const size_t comboCount = combos.GetCount();
+  for (size_t i = comboCount; i != 0;) {
     --i;
     const Combo &combo = combos[i];
     if (byteCodeRange.Contains(
@@ -378,6 +453,9 @@ void ButtonScriptManager::CancelAllCombosForByteCode(
       Console::Printf("Removed stale combo\n\n");
     }
   }
+  if (combos.GetCount() != comboCount) {
+    RebuildComboIndex();
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -385,9 +463,46 @@ void ButtonScriptManager::CancelAllCombosForByteCode(
 void ButtonScriptManager::Tick(uint32_t scriptTime) {
   script.SetScriptTime(scriptTime);
   if (hasTickScript) [[unlikely]] {
-    script.ExecuteTickScript(scriptTime);
+    if (JAVELIN_TICK_SCRIPT_INTERVAL <= 1 ||
+        int(scriptTime - lastTickScriptTime) >= JAVELIN_TICK_SCRIPT_INTERVAL) {
+      lastTickScriptTime = scriptTime;
+      script.ExecuteTickScript(scriptTime);
+    }
   }
   TimerManager::instance.ProcessTimers(scriptTime);
+  Rgb::CommitExpiredFrame(scriptTime);
+}
+
+int ButtonScriptManager::GetNextTickDelay(uint32_t scriptTime) const {
+  int delay = 0;
+  if (hasTickScript) {
+    delay = lastTickScriptTime + JAVELIN_TICK_SCRIPT_INTERVAL - scriptTime;
+    if (delay < 1) {
+      delay = 1;
+    }
+  }
+
+  const TimerManager &timerManager = TimerManager::instance;
+  if (timerManager.HasTimers()) {
+    int timerDelay = timerManager.GetNextTimerTriggerDelay(scriptTime);
+    if (timerDelay < 1) {
+      timerDelay = 1;
+    }
+    if (delay == 0 || timerDelay < delay) {
+      delay = timerDelay;
+    }
+  }
+
+  if (Rgb::IsInFrame()) {
+    int frameDelay = Rgb::GetFrameTimeoutDelay(scriptTime);
+    if (frameDelay < 1) {
+      frameDelay = 1;
+    }
+    if (delay == 0 || frameDelay < delay) {
+      delay = frameDelay;
+    }
+  }
+  return delay;
 }
 
 //---------------------------------------------------------------------------
@@ -395,6 +510,7 @@ void ButtonScriptManager::Tick(uint32_t scriptTime) {
 void ButtonScriptManager::Reset() {
   ResetComboData();
   script.Reset();
+  script.PrepareSuperInstructions();
   ButtonScript::RemoveScriptTimers();
 
   isScriptValid = script.IsValid();
@@ -494,6 +610,8 @@ void ButtonScriptManager::AddConsoleCommands(Console &console) {
                           PrintScriptGlobals_Binding, this);
   console.RegisterCommand("run_script", "Runs script bytecode",
                           RunScript_Binding, this);
+
+  script.RegisterMetrics();
 }
 
 //---------------------------------------------------------------------------
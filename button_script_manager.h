@@ -9,6 +9,25 @@
 
 //---------------------------------------------------------------------------
 
+// The combo index uses 8 bytes of RAM for each button state bit, so devices
+// only build it when the board config opts in.
+#if defined(JAVELIN_USE_COMBO_BUTTON_INDEX)
+#define USE_COMBO_BUTTON_INDEX JAVELIN_USE_COMBO_BUTTON_INDEX
+#elif JAVELIN_PLATFORM_PICO_SDK || JAVELIN_PLATFORM_NRF5_SDK
+#define USE_COMBO_BUTTON_INDEX 0
+#else
+#define USE_COMBO_BUTTON_INDEX 1
+#endif
+
+// The tick script runs at most once per interval in milliseconds. Boards
+// with tickless main loops can raise this so that a tick script does not
+// force a wakeup every millisecond.
+#if !defined(JAVELIN_TICK_SCRIPT_INTERVAL)
+#define JAVELIN_TICK_SCRIPT_INTERVAL 1
+#endif
+
+//---------------------------------------------------------------------------
+
 class Console;
 struct Combo;
 
@@ -77,6 +96,11 @@ public:
   bool HasTickScript() const { return !script.IsTickScriptEmpty(); }
   void Update(const ButtonState &newButtonState, uint32_t scriptTime);
   void Tick(uint32_t scriptTime);
+
+  // Returns the delay in milliseconds until Tick() next needs to be called,
+  // or 0 if there is no scheduled work. Platforms that sleep between ticks
+  // combine this with their own transport deadlines.
+  int GetNextTickDelay(uint32_t scriptTime) const;
   void PrintInfo() const { script.PrintInfo(); }
 
   void SetAllowButtonStateUpdates(bool value);
@@ -127,15 +151,26 @@ private:
 
   bool isScriptValid;
   bool hasTickScript;
+  uint32_t lastTickScriptTime = 0;
 
   // Controlled by scripts.
   bool allowButtonStateUpdates;
   ButtonState buttonState;
   ButtonScript script;
 
+  static constexpr size_t MAX_COMBO_COUNT = 64;
+  using ComboSet = BitField<MAX_COMBO_COUNT>;
+
   PendingComboButtons pendingComboButtons;
   ButtonState activeComboButtonState;
-  StaticList<Combo, 64> combos;
+  StaticList<Combo, MAX_COMBO_COUNT> combos;
+
+  // For each button, the combos that include it. Only combos that include
+  // every pending button can match, so matching intersects these sets
+  // instead of testing every combo.
+#if USE_COMBO_BUTTON_INDEX
+  ComboSet buttonCombos[BUTTON_STATE_BIT_SIZE];
+#endif
 
   // From TimerHandler
   virtual void Run(intptr_t id) final;
@@ -157,6 +192,10 @@ private:
 
   ComboMatches Match(size_t buttonCount);
   void ResetComboData();
+  ComboSet GetCombosWithButton(size_t buttonIndex) const;
+  ComboSet GetCandidateCombos(size_t buttonCount) const;
+  void AddComboToIndex(size_t comboIndex);
+  void RebuildComboIndex();
 
   static JavelinStaticAllocate<ButtonScriptManager> container;
 };
@@ -6,10 +6,11 @@
 //---------------------------------------------------------------------------
 
 #if defined(JAVELIN_BUTTON_STATE_BIT_SIZE)
-using ButtonState = BitField<JAVELIN_BUTTON_STATE_BIT_SIZE>;
+constexpr size_t BUTTON_STATE_BIT_SIZE = JAVELIN_BUTTON_STATE_BIT_SIZE;
 #else
-using ButtonState = BitField<128>;
+constexpr size_t BUTTON_STATE_BIT_SIZE = 128;
 #endif
+using ButtonState = BitField<BUTTON_STATE_BIT_SIZE>;
 
 struct TimedButtonState {
   uint32_t timestamp;
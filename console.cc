@@ -9,6 +9,7 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 
 //---------------------------------------------------------------------------
 
@@ -86,6 +87,7 @@ void Console::ChannelHistory::AddHistoryEntry(int channelId) {
 //---------------------------------------------------------------------------
 
 Console Console::instance;
+uint8_t Console::decodeBuffer[BUFFER_SIZE * 3 / 4];
 
 Console::Console() {
   freeBuffers.Add(&channels[0]);
@@ -122,20 +124,46 @@ static constexpr ConsoleCommand DISABLE_EVENTS_COMMAND = {
     .context = nullptr,
 };
 
-static constexpr size_t MAX_COMMAND_COUNT = 64;
-static size_t commandCount = 4;
+static constexpr ConsoleCommand BEGIN_PIPELINE_COMMAND = {
+    .command = "begin_pipeline",
+    .description = "Only reports errors until end_pipeline",
+    .handler = &Console::BeginPipelineCommand,
+    .context = nullptr,
+};
+
+static constexpr ConsoleCommand END_PIPELINE_COMMAND = {
+    .command = "end_pipeline",
+    .description = "Ends pipelined commands",
+    .handler = &Console::EndPipelineCommand,
+    .context = nullptr,
+};
+
+static constexpr size_t MAX_COMMAND_COUNT = 96;
+static size_t commandCount = 6;
 static ConsoleCommand commands[MAX_COMMAND_COUNT] = {
     HELLO_COMMAND,
     HELP_COMMAND,
 
     ENABLE_EVENTS_COMMAND,
     DISABLE_EVENTS_COMMAND,
+
+    BEGIN_PIPELINE_COMMAND,
+    END_PIPELINE_COMMAND,
 };
 
+// Open addressed hash of command names to commands index + 1, with 0 for
+// empty slots. Commands are added lazily on lookup, since the built-in
+// commands are statically initialized.
+static constexpr size_t COMMAND_HASH_SIZE = 256;
+static_assert(MAX_COMMAND_COUNT < COMMAND_HASH_SIZE / 2);
+static size_t hashedCommandCount = 0;
+static uint8_t commandHashTable[COMMAND_HASH_SIZE];
+
 static constexpr const char *EVENT_NAMES[] = {
     "analog_data",       //
     "button_state",      //
     "dictionary_status", //
+    "latency",           //
     "paper_tape",        //
     "script",            //
 #if JAVELIN_BLE          //
@@ -169,6 +197,45 @@ void Console::RegisterCommand(const char *command, const char *description,
 
 //---------------------------------------------------------------------------
 
+// Defers the channel prefix until a command writes output, so that
+// suppressed OK responses do not leave a dangling prefix.
+class Console::PipelineWriter final : public IWriter {
+public:
+  PipelineWriter(IWriter *writer, int channelId)
+      : writer(writer), channelId(channelId) {}
+
+  void Write(const char *data, size_t length) final {
+    if (!hasOutput) {
+      hasOutput = true;
+      if (channelId >= 0) {
+        writer->Printf("c%02d ", channelId);
+      }
+    }
+    writer->Write(data, length);
+  }
+
+  bool HasOutput() const { return hasOutput; }
+
+private:
+  bool hasOutput = false;
+  IWriter *const writer;
+  const int channelId;
+};
+
+struct Console::PipelineState {
+  bool isActive;
+  int8_t channelId;
+  ConnectionId connectionId;
+  PipelineWriter *writer;
+
+  // The channel running the current command, or nullptr for RunCommand.
+  const Channel *currentChannel;
+};
+
+Console::PipelineState Console::pipeline;
+
+//---------------------------------------------------------------------------
+
 void Console::PrintfInternal(const char *format, ...) {
   va_list args;
   va_start(args, format);
@@ -227,7 +294,21 @@ Console::Channel *Console::GetChannel(int channelId,
   return result;
 }
 
-int Console::AllocateChannelId() { return channelHistory.AllocateId(); }
+int Console::AllocateChannelId() {
+  const int channelId = channelHistory.AllocateId();
+
+  // A pipeline on a reused id belongs to an abandoned session.
+  if (pipeline.isActive && pipeline.channelId == channelId) {
+    pipeline.isActive = false;
+  }
+  return channelId;
+}
+
+void Console::OnConnectionReset(ConnectionId connectionId) {
+  if (pipeline.connectionId == connectionId) {
+    pipeline.isActive = false;
+  }
+}
 
 bool Console::HasPerPacketChannelId(ConnectionId connectionId) {
   switch (connectionId) {
@@ -298,10 +379,25 @@ void Console::ProcessChannelCommand(Channel &channel, size_t offset) {
     return;
   }
 
-  if (channel.id >= 0) {
-    Printf("c%02d ", channel.id);
+  pipeline.currentChannel = &channel;
+  if (pipeline.isActive && pipeline.channelId == channel.id &&
+      pipeline.connectionId == channel.connectionId) {
+    PipelineWriter writer(ConsoleWriter::GetActiveWriter(), channel.id);
+    ConsoleWriter::Push(&writer);
+    pipeline.writer = &writer;
+    ProcessCommand(channel, offset);
+    pipeline.writer = nullptr;
+    ConsoleWriter::Pop();
+  } else {
+    if (channel.id >= 0) {
+      Printf("c%02d ", channel.id);
+    }
+    ProcessCommand(channel, offset);
   }
+  pipeline.currentChannel = nullptr;
+}
 
+void Console::ProcessCommand(Channel &channel, size_t offset) {
   if (isLocked) {
     Printf("ERR Console access is disabled\n\n");
     ButtonScriptManager::ExecuteScript(
@@ -328,14 +424,54 @@ void Console::ProcessChannelCommand(Channel &channel, size_t offset) {
   }
 }
 
-const ConsoleCommand *Console::GetCommand(const char *buffer) {
-  for (size_t i = 0; i < commandCount; ++i) {
-    if (Str::HasPrefix(buffer, commands[i].command) &&
-        Unicode::IsWhitespace(buffer[Str::Length(commands[i].command)])) {
-      return &commands[i];
+static uint32_t HashCommandName(const char *name, size_t length) {
+  // FNV-1a
+  uint32_t hash = 2166136261;
+  for (size_t i = 0; i < length; ++i) {
+    hash = (hash ^ (uint8_t)name[i]) * 16777619;
+  }
+  return hash;
+}
+
+static size_t FindCommandSlot(const char *name, size_t length) {
+  size_t slot = HashCommandName(name, length) & (COMMAND_HASH_SIZE - 1);
+  for (;;) {
+    const size_t entry = commandHashTable[slot];
+    if (entry == 0) {
+      return slot;
+    }
+    const char *command = commands[entry - 1].command;
+    if (Str::Length(command) == length && memcmp(command, name, length) == 0) {
+      return slot;
+    }
+    slot = (slot + 1) & (COMMAND_HASH_SIZE - 1);
+  }
+}
+
+void Console::UpdateCommandHashTable() {
+  while (hashedCommandCount < commandCount) {
+    const char *command = commands[hashedCommandCount].command;
+    const size_t slot = FindCommandSlot(command, Str::Length(command));
+
+    // Earlier registrations take precedence.
+    if (commandHashTable[slot] == 0) {
+      commandHashTable[slot] = ++hashedCommandCount;
+    } else {
+      ++hashedCommandCount;
     }
   }
-  return nullptr;
+}
+
+const ConsoleCommand *Console::GetCommand(const char *buffer) {
+  UpdateCommandHashTable();
+
+  size_t length = 0;
+  while (!Unicode::IsWhitespace(buffer[length])) {
+    ++length;
+  }
+
+  const size_t entry = commandHashTable[FindCommandSlot(buffer, length)];
+  return entry == 0 ? nullptr : &commands[entry - 1];
 }
 
 bool Console::RunCommand(const char *command, IWriter &writer) {
@@ -351,10 +487,42 @@ bool Console::RunCommand(const char *command, IWriter &writer) {
   return true;
 }
 
-void Console::SendOk() { Write("OK\n\n", 4); }
+void Console::SendOk() {
+  // Successful pipelined commands do not respond.
+  if (pipeline.writer != nullptr &&
+      ConsoleWriter::GetActiveWriter() == pipeline.writer &&
+      !pipeline.writer->HasOutput()) {
+    return;
+  }
+  Write("OK\n\n", 4);
+}
+
+void Console::BeginPipelineCommand(void *context, const char *line) {
+  const Channel *channel = pipeline.currentChannel;
+  if (channel == nullptr) {
+    Printf("ERR Pipelining requires a console channel\n\n");
+    return;
+  }
+
+  // Only one channel is pipelined at a time.
+  pipeline.isActive = true;
+  pipeline.channelId = channel->id;
+  pipeline.connectionId = channel->connectionId;
+  SendOk();
+}
+
+void Console::EndPipelineCommand(void *context, const char *line) {
+  pipeline.isActive = false;
+
+  // Bypass SendOk, since this command is itself pipelined.
+  Write("OK\n\n", 4);
+}
 
 // Used to flush the output buffer and ensure a stable connection.
 void Console::HelloCommand(void *context, const char *line) {
+  // A new session does not inherit an abandoned pipeline.
+  pipeline.isActive = false;
+
   const char *suffix = strchr(line, ' ');
   Printf("c%02d ID Hello%s\n\n", instance.AllocateChannelId(),
          suffix == nullptr ? "" : suffix);
@@ -471,6 +639,79 @@ TEST_BEGIN("Console should handle enable & disable events") {
 }
 TEST_END
 
+TEST_BEGIN("Console should match whole command names") {
+  assert(Console::RunCommand("help", NullWriter::instance));
+  assert(Console::RunCommand("help me", NullWriter::instance));
+  assert(Console::RunCommand("disable_events\tpaper_tape",
+                             NullWriter::instance));
+  assert(!Console::RunCommand("hel", NullWriter::instance));
+  assert(!Console::RunCommand("helpx", NullWriter::instance));
+  assert(!Console::RunCommand("", NullWriter::instance));
+}
+TEST_END
+
+TEST_BEGIN("Console should only report errors when pipelined") {
+  Console console;
+  constexpr char INPUT[] = "c01 begin_pipeline\n"
+                           "enable_events paper_tape\n"
+                           "asdf\n"
+                           "disable_events paper_tape\n"
+                           "end_pipeline\n"
+                           "disable_events paper_tape\n";
+  console.HandleInput(INPUT, sizeof(INPUT) - 1, ConnectionId::USB);
+
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(),
+                 "c01 OK\n\n"
+                 "c01 ERR Invalid command. Use \"help\" for a list of commands"
+                 "\n\n"
+                 "c01 OK\n\n"
+                 "c01 OK\n\n"));
+  Console::history.clear();
+}
+TEST_END
+
+TEST_BEGIN("Console should end abandoned pipelines") {
+  Console console;
+  constexpr char BEGIN_INPUT[] = "c50 begin_pipeline\n";
+  constexpr char HELLO_INPUT[] = "hello\n";
+  constexpr char NEXT_INPUT[] = "c50 disable_events paper_tape\n";
+
+  // A new session starts without ending the previous one's pipeline.
+  console.HandleInput(BEGIN_INPUT, sizeof(BEGIN_INPUT) - 1, ConnectionId::USB);
+  console.HandleInput(HELLO_INPUT, sizeof(HELLO_INPUT) - 1, ConnectionId::USB);
+  Console::history.clear();
+  console.HandleInput(NEXT_INPUT, sizeof(NEXT_INPUT) - 1, ConnectionId::USB);
+
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(), "c50 OK\n\n"));
+  Console::history.clear();
+
+  console.HandleInput(BEGIN_INPUT, sizeof(BEGIN_INPUT) - 1, ConnectionId::USB);
+  Console::OnConnectionReset(ConnectionId::USB);
+  console.HandleInput(NEXT_INPUT, sizeof(NEXT_INPUT) - 1, ConnectionId::USB);
+
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(), "c50 OK\n\n"
+                                            "c50 OK\n\n"));
+  Console::history.clear();
+
+  // A fresh console allocates c01, which the pipeline can no longer use.
+  constexpr char REUSE_INPUT[] = "c01 begin_pipeline\n";
+  console.HandleInput(REUSE_INPUT, sizeof(REUSE_INPUT) - 1, ConnectionId::USB);
+  Console newConsole;
+  assert(newConsole.AllocateChannelId() == 1);
+  constexpr char REUSED_INPUT[] = "c01 disable_events paper_tape\n";
+  console.HandleInput(REUSED_INPUT, sizeof(REUSED_INPUT) - 1,
+                      ConnectionId::USB);
+
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(), "c01 OK\n\n"
+                                            "c01 OK\n\n"));
+  Console::history.clear();
+}
+TEST_END
+
 #endif
 
 //---------------------------------------------------------------------------
@@ -58,6 +58,7 @@ enum class ConsoleEvent {
   ANALOG_DATA,
   BUTTON_STATE,
   DICTIONARY_STATUS,
+  LATENCY,
   PAPER_TAPE,
   SCRIPT,
 #if JAVELIN_BLE
@@ -78,6 +79,9 @@ public:
 
   int AllocateChannelId();
 
+  // Ends any pipeline on the connection, since its session is gone.
+  static void OnConnectionReset(ConnectionId connectionId);
+
   void HandleInput(const char *data, size_t length, ConnectionId connectionId);
   static void SendOk();
 
@@ -93,6 +97,8 @@ public:
   static void HelpCommand(void *context, const char *line);
   static void EnableEvents(void *context, const char *line);
   static void DisableEvents(void *context, const char *line);
+  static void BeginPipelineCommand(void *context, const char *line);
+  static void EndPipelineCommand(void *context, const char *line);
 
   static void Write(const char *data, size_t length) {
     ConsoleWriter::WriteToActive(data, length);
@@ -109,6 +115,11 @@ public:
     Write(text, N - 1);
   }
 
+  // Format is parsed and checked against args at compile time.
+  template <PrintfFormat F, typename... T> static void Printf(T... args) {
+    ConsoleWriter::instance.GetActiveWriter()->Printf<F>(args...);
+  }
+
   static void Print(const char *text) { Write(text, strlen(text)); }
 
   static void Dump(const void *data, size_t length) {
@@ -139,6 +150,10 @@ public:
   static const size_t BUFFER_SIZE = 2048;
   static Console instance;
 
+  // Shared by commands that decode a base64 argument. The contents are only
+  // valid until the command returns.
+  static uint8_t decodeBuffer[BUFFER_SIZE * 3 / 4];
+
 private:
   struct Channel {
     int8_t id;
@@ -163,6 +178,10 @@ private:
     }
   };
 
+  class PipelineWriter;
+  struct PipelineState;
+  static PipelineState pipeline;
+
   class ChannelHistory {
   public:
     int AllocateId();
@@ -187,8 +206,10 @@ private:
 
   Channel *GetChannel(int channelId, ConnectionId connectionId);
   void ProcessChannelCommand(Channel &channel, size_t offset);
+  void ProcessCommand(Channel &channel, size_t offset);
   static void PrintfInternal(const char *format, ...);
 
+  static void UpdateCommandHashTable();
   static const ConsoleCommand *GetCommand(const char *buffer);
 
   static void UpdateEvents(const char *line, bool value);
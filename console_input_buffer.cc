@@ -63,6 +63,11 @@ void ConsoleInputBuffer::ConsoleInputBufferData::OnDataReceived(
       (ConnectionId)((const uint8_t *)data)[0]);
 }
 
+void ConsoleInputBuffer::ConsoleInputBufferData::OnReceiveConnectionReset() {
+  Console::OnConnectionReset(ConnectionId::USB_PAIR);
+  Console::OnConnectionReset(ConnectionId::SERIAL_CONSOLE_PAIR);
+}
+
 #else
 void ConsoleInputBuffer::ConsoleInputBufferData::UpdateBuffer(
     TxBuffer &buffer) {
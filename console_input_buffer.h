@@ -75,6 +75,7 @@ private:
 
 #if JAVELIN_SPLIT_IS_MASTER
     void OnDataReceived(const void *data, size_t length) final;
+    void OnReceiveConnectionReset() final;
 #else
     void UpdateBuffer(TxBuffer &buffer) final;
     void OnTransmitConnectionReset() final { isConnected = false; }
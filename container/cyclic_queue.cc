@@ -48,4 +48,20 @@ TEST_BEGIN("CyclicQueue: Iterator works as expected") {
 }
 TEST_END
 
+TEST_BEGIN("CyclicQueue: AddCount wraps around") {
+  CyclicQueue<int, 8> queue;
+  const int values[] = {1, 2, 3, 4, 5, 6};
+  queue.AddCount(values, 6);
+  assert(queue.GetFrontContiguousCount() == 6);
+  queue.RemoveFront(5);
+
+  queue.AddCount(values, 6);
+  assert(queue.GetCount() == 7);
+  assert(queue.GetFrontContiguousCount() == 3);
+  assert(queue.Front() == 6);
+  assert(queue[1] == 1);
+  assert(queue[6] == 6);
+}
+TEST_END
+
 //---------------------------------------------------------------------------
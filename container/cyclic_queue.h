@@ -3,6 +3,7 @@
 #pragma once
 #include <assert.h>
 #include <stddef.h>
+#include <string.h>
 
 //---------------------------------------------------------------------------
 
@@ -36,6 +37,25 @@ public:
   T &Add() { return data[endIndex++ & (N - 1)]; }
   void Add(const T &value) { data[endIndex++ & (N - 1)] = value; }
 
+  // Copies count values with at most two memcpy calls. The values are
+  // written before endIndex is updated, so a single consumer never sees
+  // partial data.
+  void AddCount(const T *values, size_t count) {
+    assert(GetAvailable() >= count);
+    const size_t offset = endIndex & (N - 1);
+    const size_t firstCount = N - offset < count ? N - offset : count;
+    memcpy(&data[offset], values, firstCount * sizeof(T));
+    memcpy(&data[0], values + firstCount, (count - firstCount) * sizeof(T));
+    endIndex += count;
+  }
+
+  // Returns the number of values that are contiguous from Front().
+  size_t GetFrontContiguousCount() const {
+    const size_t offset = startIndex & (N - 1);
+    const size_t count = GetCount();
+    return N - offset < count ? N - offset : count;
+  }
+
   T &RemoveFront() { return data[startIndex++ & (N - 1)]; }
   void RemoveFront(size_t count) {
     assert(GetCount() >= count);
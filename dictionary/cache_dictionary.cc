@@ -1,6 +1,7 @@
 //---------------------------------------------------------------------------
 
 #include "cache_dictionary.h"
+#include "../mem.h"
 
 //---------------------------------------------------------------------------
 
@@ -22,9 +23,54 @@ StenoCacheDictionary::Stats StenoCacheDictionary::stats;
 
 //---------------------------------------------------------------------------
 
+StenoCachedTextPool StenoCachedTextPool::instance;
+
+const char *StenoCachedTextPool::Add(const char *text, size_t length) {
+  if (length >= sizeof(Slot::text) || usedMask == uint64_t(-1)) {
+    return nullptr;
+  }
+
+  const size_t index = __builtin_ctzll(~usedMask);
+  usedMask |= uint64_t(1) << index;
+
+  Slot &slot = slots[index];
+  slot.referenceCount = 1;
+  Mem::Copy(slot.text, text, length);
+  slot.text[length] = '\0';
+  return slot.text;
+}
+
+void StenoCachedTextPool::Release(const char *text) {
+  Slot &slot = GetSlot(text);
+  if (--slot.referenceCount == 0) {
+    usedMask &= ~(uint64_t(1) << (&slot - slots));
+  }
+}
+
+//---------------------------------------------------------------------------
+
 void StenoCacheDictionary::CacheEntry::Clear() {
   hash = 0;
   strokeLength = 0;
+  SetDefinition(StenoDictionaryLookupResult::CreateInvalid(), nullptr);
+}
+
+void StenoCacheDictionary::CacheEntry::SetDefinition(
+    const StenoDictionaryLookupResult result,
+    const StenoDictionary *dictionary) const {
+  StenoCachedTextPool &pool = StenoCachedTextPool::instance;
+  if (pool.Contains(definition)) {
+    pool.Release(definition);
+  }
+
+  if (result.IsStatic()) {
+    definition = result.GetText();
+  } else if (USE_CACHED_TEXT_POOL && dictionary->CanCacheDynamicResults()) {
+    const char *text = result.GetText();
+    definition = pool.Add(text, Str::Length(text));
+  } else {
+    definition = nullptr;
+  }
 }
 
 bool StenoCacheDictionary::CacheEntry::IsMatch(
@@ -38,11 +84,7 @@ void StenoCacheDictionary::CacheEntry::AddResult(
     const StenoDictionaryLookupResult result,
     const StenoDictionary *dictionary) {
   provider = dictionary;
-  if (result.IsStatic()) {
-    staticDefinition = result.GetText();
-  } else {
-    staticDefinition = nullptr;
-  }
+  SetDefinition(result, dictionary);
   hash = lookup.hash;
   strokeLength = lookup.length;
   lookup.strokes->CopyTo(strokes, lookup.length);
@@ -105,6 +147,8 @@ void StenoCacheDictionary::Cache::AddResult(
 
 //---------------------------------------------------------------------------
 
+StenoCacheDictionary::~StenoCacheDictionary() { cache.Clear(); }
+
 StenoDictionaryLookupResult
 StenoCacheDictionary::Lookup(const StenoDictionaryLookup &lookup) const {
   if (lookup.length > MAXIMUM_STROKE_SIZE_TO_CACHE) {
@@ -130,8 +174,16 @@ StenoDictionaryLookupResult StenoCacheDictionary::LookupInternal(
     return super::Lookup(lookup);
   }
 
-  const char *definition = entry->staticDefinition;
+  const char *definition = entry->definition;
   if (definition) [[likely]] {
+    StenoCachedTextPool &pool = StenoCachedTextPool::instance;
+    if (pool.Contains(definition)) {
+#if ENABLE_DICTIONARY_LOOKUP_CACHE_STATS
+      stats.lookup.hitCachedDefinition++;
+#endif
+      pool.AddReference(definition);
+      return StenoDictionaryLookupResult::CreateCachedString(definition);
+    }
 #if ENABLE_DICTIONARY_LOOKUP_CACHE_STATS
     stats.lookup.hitDefinition++;
 #endif
@@ -152,8 +204,8 @@ StenoDictionaryLookupResult StenoCacheDictionary::LookupInternal(
   stats.lookup.hitDictionary++;
 #endif
   StenoDictionaryLookupResult result = provider->Lookup(lookup);
-  if (result.IsStatic()) {
-    entry->staticDefinition = result.GetText();
+  if (result.IsValid()) {
+    entry->SetDefinition(result, provider);
   }
   return result;
 }
@@ -207,9 +259,10 @@ const char *StenoCacheDictionary::GetName() const { return "#cache"; }
 void StenoCacheDictionary::PrintInfo() {
 #if ENABLE_DICTIONARY_LOOKUP_CACHE_STATS
   Console::Printf("Dictionary Cache Stats\n");
-  Console::Printf("  lookup: %zu, %zu, %zu, %zu, %zu\n",
+  Console::Printf("  lookup: %zu, %zu, %zu, %zu, %zu, %zu\n",
                   stats.lookup.lengthLimitExceeded, stats.lookup.miss,
-                  stats.lookup.hitDefinition, stats.lookup.hitEmpty,
+                  stats.lookup.hitDefinition,
+                  stats.lookup.hitCachedDefinition, stats.lookup.hitEmpty,
                   stats.lookup.hitDictionary);
   Console::Printf("  getDictionaryForOutline: %zu, %zu, %zu\n",
                   stats.getDictionaryForOutline.lengthLimitExceeded,
@@ -218,6 +271,90 @@ void StenoCacheDictionary::PrintInfo() {
 #endif
 }
 
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "../unit_test.h"
+#include "dictionary_list.h"
+#include "jeff_numbers_dictionary.h"
+
+//---------------------------------------------------------------------------
+
+#if USE_CACHED_TEXT_POOL
+TEST_BEGIN("CacheDictionary: Dynamic results are kept in the text pool") {
+  StenoDictionary *dictionaries[] = {&StenoJeffNumbersDictionary::instance};
+  StenoDictionaryList dictionaryList(dictionaries, 1);
+  StenoDictionary *cacheDictionary =
+      dictionaryList.CreateCacheDictionary(&dictionaryList);
+  StenoCachedTextPool &pool = StenoCachedTextPool::instance;
+  assert(pool.GetUsedCount() == 0);
+
+  // The first lookup is generated, and a copy is added to the pool.
+  const StenoStroke stroke("#ST");
+  StenoDictionaryLookupResult first = cacheDictionary->Lookup(&stroke, 1);
+  assert(Str::Eq(first.GetText(), "12"));
+  assert(!pool.Contains(first.GetText()));
+  assert(pool.GetUsedCount() == 1);
+
+  StenoDictionaryLookupResult second = cacheDictionary->Lookup(&stroke, 1);
+  StenoDictionaryLookupResult third = cacheDictionary->Lookup(&stroke, 1);
+  assert(Str::Eq(second.GetText(), "12"));
+  assert(pool.Contains(second.GetText()));
+  assert(second.GetText() == third.GetText());
+
+  StenoDictionaryLookupResult clone = second.Clone();
+  assert(clone.GetText() == second.GetText());
+  first.Destroy();
+  second.Destroy();
+  third.Destroy();
+
+  // Results stay valid after the cache is cleared.
+  cacheDictionary->OnLookupDataChanged();
+  assert(pool.GetUsedCount() == 1);
+  assert(Str::Eq(clone.GetText(), "12"));
+  clone.Destroy();
+  assert(pool.GetUsedCount() == 0);
+
+  // Text that does not fit in a slot is not cached.
+  const char *text = "0123456789012345678901234567890123456789";
+  assert(pool.Add(text, 40) == nullptr);
+  const char *copy = pool.Add(text, 20);
+  assert(copy != nullptr && Str::Eq(copy, "01234567890123456789"));
+  pool.Release(copy);
+  assert(pool.GetUsedCount() == 0);
+}
+TEST_END
+
+TEST_BEGIN("CacheDictionary: Replaced caches release their text") {
+  StenoDictionary *dictionaries[] = {&StenoJeffNumbersDictionary::instance};
+  StenoCachedTextPool &pool = StenoCachedTextPool::instance;
+  const StenoStroke stroke("#ST");
+  {
+    StenoDictionaryList dictionaryList(dictionaries, 1);
+    StenoDictionary *cacheDictionary =
+        dictionaryList.CreateCacheDictionary(&dictionaryList);
+    cacheDictionary->Lookup(&stroke, 1).Destroy();
+    StenoDictionaryLookupResult result = cacheDictionary->Lookup(&stroke, 1);
+    assert(pool.Contains(result.GetText()));
+    assert(pool.GetUsedCount() == 1);
+
+    // The replaced cache releases its entry, but not the result's reference.
+    cacheDictionary = dictionaryList.CreateCacheDictionary(&dictionaryList);
+    assert(pool.GetUsedCount() == 1);
+    assert(Str::Eq(result.GetText(), "12"));
+    result.Destroy();
+    assert(pool.GetUsedCount() == 0);
+
+    cacheDictionary->Lookup(&stroke, 1).Destroy();
+    assert(pool.GetUsedCount() == 1);
+  }
+
+  // Destroying the list destroys its cache.
+  assert(pool.GetUsedCount() == 0);
+}
+TEST_END
+#endif
+
 //---------------------------------------------------------------------------
 
 #endif // ENABLE_DICTIONARY_LOOKUP_CACHE
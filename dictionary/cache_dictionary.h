@@ -5,6 +5,66 @@
 
 //---------------------------------------------------------------------------
 
+#if !defined(JAVELIN_DICTIONARY_CACHED_TEXT_SLOT_SIZE)
+#define JAVELIN_DICTIONARY_CACHED_TEXT_SLOT_SIZE 32
+#endif
+
+// With JAVELIN_THREADS, lookups run concurrently and reference counts are
+// not atomic, so dynamic results are not cached.
+#if defined(JAVELIN_THREADS)
+#define USE_CACHED_TEXT_POOL 0
+#else
+#define USE_CACHED_TEXT_POOL 1
+#endif
+
+//---------------------------------------------------------------------------
+
+// Fixed slots of reference counted text, holding copies of dynamic lookup
+// results so that StenoCacheDictionary hits do not need to regenerate or
+// allocate them.
+//
+// The cache holds one reference for each entry, and each lookup result
+// holds another, so text stays valid if the entry is evicted, or the cache
+// destroyed, while the result is still in use.
+//
+// The pool uses 64 slots of JAVELIN_DICTIONARY_CACHED_TEXT_SLOT_SIZE bytes,
+// i.e. 2 KB of RAM by default.
+class StenoCachedTextPool {
+public:
+  // Returns a copy of text with a single reference, or nullptr if it does
+  // not fit in a slot, or all slots are in use.
+  const char *Add(const char *text, size_t length);
+
+  bool Contains(const char *text) const {
+    return uintptr_t(text) - uintptr_t(slots) < sizeof(slots);
+  }
+
+  void AddReference(const char *text) { ++GetSlot(text).referenceCount; }
+  void Release(const char *text);
+
+  size_t GetUsedCount() const { return __builtin_popcountll(usedMask); }
+
+  static StenoCachedTextPool instance;
+
+private:
+  static constexpr size_t SLOT_COUNT = 64;
+  static constexpr size_t SLOT_SIZE = JAVELIN_DICTIONARY_CACHED_TEXT_SLOT_SIZE;
+
+  struct Slot {
+    uint16_t referenceCount;
+    char text[SLOT_SIZE - sizeof(uint16_t)];
+  };
+
+  uint64_t usedMask;
+  Slot slots[SLOT_COUNT];
+
+  Slot &GetSlot(const char *text) {
+    return slots[(uintptr_t(text) - uintptr_t(slots)) / sizeof(Slot)];
+  }
+};
+
+//---------------------------------------------------------------------------
+
 class StenoCacheDictionary final : public StenoWrappedDictionary {
 private:
   using super = StenoWrappedDictionary;
@@ -13,6 +73,9 @@ public:
   StenoCacheDictionary(StenoDictionary *dictionary)
       : StenoWrappedDictionary(dictionary) {}
 
+  // Releases the pool references held by cache entries.
+  ~StenoCacheDictionary();
+
   virtual StenoDictionaryLookupResult
   Lookup(const StenoDictionaryLookup &lookup) const;
   using StenoDictionary::Lookup;
@@ -42,6 +105,7 @@ private:
     size_t lengthLimitExceeded;
     size_t hitEmpty;
     size_t hitDefinition;
+    size_t hitCachedDefinition;
     size_t hitDictionary;
     size_t miss;
   };
@@ -54,21 +118,25 @@ private:
 #endif
 
   struct CacheEntry {
-    uint32_t hash;
-    uint8_t strokeLength;
-    uint8_t nextCacheEntryIndex; // Conceptually part of CacheBlock, here for
-                                 // better packing.
+    uint32_t hash = 0;
+    uint8_t strokeLength = 0;
+    uint8_t nextCacheEntryIndex = 0; // Conceptually part of CacheBlock, here
+                                     // for better packing.
     StenoStroke strokes[MAXIMUM_STROKE_SIZE_TO_CACHE];
 
-    // The definition of the lookup if it is static.
+    // The definition of the lookup if it is static, or a copy held in
+    // StenoCachedTextPool if the provider can cache dynamic results.
     //
-    // Only static definitions are cached, to ensure that memory allocations
-    // are not extended beyond the lifecycle of processing steno input.
-    mutable const char *staticDefinition;
+    // Other dynamic definitions are not cached, to ensure that memory
+    // allocations are not extended beyond the lifecycle of processing steno
+    // input.
+    mutable const char *definition = nullptr;
 
     const StenoDictionary *provider;
 
     void Clear();
+    void SetDefinition(const StenoDictionaryLookupResult result,
+                       const StenoDictionary *dictionary) const;
     bool IsMatch(const StenoDictionaryLookup &lookup) const;
     void AddResult(const StenoDictionaryLookup &lookup,
                    const StenoDictionaryLookupResult result,
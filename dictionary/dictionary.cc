@@ -1,6 +1,7 @@
 //---------------------------------------------------------------------------
 
 #include "dictionary.h"
+#include "cache_dictionary.h"
 #include "map_data_lookup.h"
 
 #include "../console.h"
@@ -22,6 +23,17 @@ StenoDictionary::Stats StenoDictionary::stats;
 constexpr StenoDictionaryLookupResult
     StenoDictionaryLookupResult::NO_OP("{:=}");
 
+// Non-static text is either cached or allocated.
+extern "C" [[gnu::used]] void DestroyDynamicLookupText(const char *text) {
+#if ENABLE_DICTIONARY_LOOKUP_CACHE
+  if (StenoCachedTextPool::instance.Contains(text)) {
+    StenoCachedTextPool::instance.Release(text);
+    return;
+  }
+#endif
+  free((char *)text);
+}
+
 #if JAVELIN_CPU_CORTEX_M0
 
 [[gnu::naked]] void
@@ -31,7 +43,7 @@ StenoDictionaryLookupResult::DestroyInternal(const char *text) {
     bmi 1f
     bx  lr
   1:
-    ldr r1, =free
+    ldr r1, =DestroyDynamicLookupText
     bx r1
   )");
 }
@@ -40,7 +52,7 @@ StenoDictionaryLookupResult::DestroyInternal(const char *text) {
 
 void StenoDictionaryLookupResult::DestroyInternal(const char *text) {
   if (!IsStatic(text)) {
-    free((char *)text);
+    DestroyDynamicLookupText(text);
   }
 }
 
@@ -49,9 +61,14 @@ void StenoDictionaryLookupResult::DestroyInternal(const char *text) {
 const char *StenoDictionaryLookupResult::CloneInternal(const char *text) {
   if (IsStatic(text)) {
     return text;
-  } else {
-    return Str::Dup(text);
   }
+#if ENABLE_DICTIONARY_LOOKUP_CACHE
+  if (StenoCachedTextPool::instance.Contains(text)) {
+    StenoCachedTextPool::instance.AddReference(text);
+    return text;
+  }
+#endif
+  return Str::Dup(text);
 }
 
 #else
@@ -65,10 +82,23 @@ void StenoDictionaryLookupResult::FreeText(StenoDictionaryLookupResult *p) {
   free((char *)p->text);
 }
 
+void StenoDictionaryLookupResult::ReleaseCachedText(
+    StenoDictionaryLookupResult *p) {
+#if ENABLE_DICTIONARY_LOOKUP_CACHE
+  StenoCachedTextPool::instance.Release(p->text);
+#endif
+}
+
 StenoDictionaryLookupResult StenoDictionaryLookupResult::Clone() const {
   if (destroyMethod == &Nop) {
     return *this;
   }
+#if ENABLE_DICTIONARY_LOOKUP_CACHE
+  if (destroyMethod == &ReleaseCachedText) {
+    StenoCachedTextPool::instance.AddReference(text);
+    return *this;
+  }
+#endif
 
   return CreateDup(GetText());
 }
@@ -194,12 +224,71 @@ StenoDictionaryLookupResult::CreateFromBuffer(BufferWriter &writer) {
 
 //---------------------------------------------------------------------------
 
-[[gnu::noinline]] void
-ConsolePrintDictionaryContext::Print(const StenoStroke *strokes, size_t length,
-                                     const char *definition) {
+StreamingPrintDictionaryContext::StreamingPrintDictionaryContext(
+    const char *name, IWriter &writer, PrintDictionaryFormat format)
+    : format(format), name(name), chunkWriter(writer),
+      base64Writer(&chunkWriter) {}
+
+void StreamingPrintDictionaryContext::Begin() {
+  if (format == PrintDictionaryFormat::JSON) {
+    chunkWriter.WriteByte('{');
+  }
+}
+
+void StreamingPrintDictionaryContext::Print(const StenoStroke *strokes,
+                                            size_t length,
+                                            const char *definition) {
+  ++entryCount;
+  switch (format) {
+  case PrintDictionaryFormat::JSON:
+    PrintJson(strokes, length, definition);
+    break;
+  case PrintDictionaryFormat::BINARY:
+    PrintBinary(strokes, length, definition);
+    break;
+  }
+}
+
+void StreamingPrintDictionaryContext::PrintJson(const StenoStroke *strokes,
+                                                size_t length,
+                                                const char *definition) {
   const char *format = ",\n\t\"%T\": \"%J\"";
-  Console::Printf(format + isFirst, strokes, length, definition);
-  isFirst = false;
+  chunkWriter.Printf(format + (entryCount == 1), strokes, length, definition);
+}
+
+void StreamingPrintDictionaryContext::PrintBinary(const StenoStroke *strokes,
+                                                  size_t length,
+                                                  const char *definition) {
+  base64Writer.WriteVarUint(length);
+  for (size_t i = 0; i < length; ++i) {
+    base64Writer.WriteVarUint(strokes[i].GetKeyState());
+  }
+  const size_t definitionLength = Str::Length(definition);
+  base64Writer.WriteVarUint(definitionLength);
+  base64Writer.Write(definition, definitionLength);
+}
+
+void StreamingPrintDictionaryContext::End() {
+  switch (format) {
+  case PrintDictionaryFormat::JSON:
+    chunkWriter.Write("\n}\n\n", 4);
+    break;
+  case PrintDictionaryFormat::BINARY:
+    base64Writer.WriteVarUint(0);
+    base64Writer.Flush();
+    chunkWriter.Write("\n\n", 2);
+    break;
+  }
+  chunkWriter.Flush();
+}
+
+// Writing each chunk through to the transport before generating the next
+// one keeps memory use bounded to a single chunk, and allows slow transports
+// to throttle the export.
+void StreamingPrintDictionaryContext::ChunkWriter::Flush(const char *data,
+                                                         size_t length) {
+  next.Write(data, length);
+  Console::Flush();
 }
 
 //---------------------------------------------------------------------------
@@ -6,6 +6,7 @@
 #include "../malloc_allocate.h"
 #include "../str.h"
 #include "../stroke.h"
+#include "../writer.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -90,6 +91,12 @@ public:
 
   static StenoDictionaryLookupResult CreateFromBuffer(BufferWriter &writer);
 
+  // p is a reference counted string from StenoCachedTextPool, and the
+  // reference is released when the Lookup is destroyed.
+  static StenoDictionaryLookupResult CreateCachedString(const char *p) {
+    return StenoDictionaryLookupResult(p);
+  }
+
   bool operator==(const StenoDictionaryLookupResult &other) const {
     return text == other.text;
   }
@@ -104,6 +111,7 @@ private:
 
   static void Nop(StenoDictionaryLookupResult *);
   static void FreeText(StenoDictionaryLookupResult *);
+  static void ReleaseCachedText(StenoDictionaryLookupResult *);
 
 public:
   bool IsValid() const { return text != nullptr; }
@@ -156,6 +164,15 @@ public:
 
   static StenoDictionaryLookupResult CreateFromBuffer(BufferWriter &writer);
 
+  // p is a reference counted string from StenoCachedTextPool, and the
+  // reference is released when the Lookup is destroyed.
+  static StenoDictionaryLookupResult CreateCachedString(const char *p) {
+    StenoDictionaryLookupResult result;
+    result.text = p;
+    result.destroyMethod = &ReleaseCachedText;
+    return result;
+  }
+
   bool operator==(const StenoDictionaryLookupResult &other) const {
     return text == other.text;
   }
@@ -263,18 +280,59 @@ public:
   }
 };
 
-class ConsolePrintDictionaryContext final : public PrintDictionaryContext {
+enum class PrintDictionaryFormat : uint8_t {
+  // Entries are written as a JSON object.
+  JSON,
+
+  // Entries are written as base64 encoded binary records:
+  //   varuint strokeLength, varuint keyState * strokeLength,
+  //   varuint textLength, text.
+  // A strokeLength of zero terminates the stream.
+  BINARY,
+};
+
+// Batches entries into large chunks before writing them to the target
+// writer, so that the transport receives few large writes rather than
+// several small writes per entry.
+class StreamingPrintDictionaryContext final : public PrintDictionaryContext {
 public:
-  ConsolePrintDictionaryContext(const char *name) : name(name) {}
+  StreamingPrintDictionaryContext(const char *name, IWriter &writer,
+                                  PrintDictionaryFormat format);
 
   bool HasName() const { return name != nullptr; }
   const char *GetName() const { return name; }
 
+  void Begin();
   void Print(const StenoStroke *strokes, size_t length, const char *definition);
+  void End();
+
+  size_t GetEntryCount() const { return entryCount; }
+
+  static const size_t CHUNK_SIZE = 1024;
 
 private:
-  bool isFirst = true;
+  class ChunkWriter final : public BlockWriter<CHUNK_SIZE> {
+  public:
+    ChunkWriter(IWriter &next) : next(next) {}
+
+    using BlockWriterBase::Flush;
+
+  private:
+    IWriter &next;
+
+    virtual void Flush(const char *data, size_t length);
+  };
+
+  const PrintDictionaryFormat format;
+  size_t entryCount = 0;
   const char *name;
+  ChunkWriter chunkWriter;
+  Base64Writer base64Writer;
+
+  void PrintJson(const StenoStroke *strokes, size_t length,
+                 const char *definition);
+  void PrintBinary(const StenoStroke *strokes, size_t length,
+                   const char *definition);
 };
 
 class LookupDictionaryContext {
@@ -413,6 +471,11 @@ public:
   virtual bool IsInternal() const { return false; }
   virtual const char *GetName() const = 0;
 
+  // Returns true if dynamic lookup results depend only on the outline, so
+  // that StenoCacheDictionary can keep a copy rather than repeating the
+  // lookup.
+  virtual bool CanCacheDynamicResults() const { return false; }
+
   // Returns the lookup dictionary within a WrappedDictionary.
   //
   // This optimization avoids multiple wrapped chain calls.
@@ -3,12 +3,25 @@
 #include "dictionary_list.h"
 #include "../console.h"
 #include "../str.h"
+#include "../thread.h"
 
 //---------------------------------------------------------------------------
 
+StenoDictionaryList::~StenoDictionaryList() {
+#if ENABLE_DICTIONARY_LOOKUP_CACHE
+  if (hasCacheDictionary) {
+    cacheDictionaryContainer->~StenoCacheDictionary();
+  }
+#endif
+}
+
 StenoDictionary *
 StenoDictionaryList::CreateCacheDictionary(StenoDictionary *dictionary) {
 #if ENABLE_DICTIONARY_LOOKUP_CACHE
+  if (hasCacheDictionary) {
+    cacheDictionaryContainer->~StenoCacheDictionary();
+  }
+  hasCacheDictionary = true;
   return new (cacheDictionaryContainer) StenoCacheDictionary(dictionary);
 #else
   return dictionary;
@@ -100,6 +113,67 @@ const StenoDictionary *StenoDictionaryList::GetDictionaryForOutline(
   return nullptr;
 }
 
+struct StenoDictionaryList::LookupBatchContext {
+  const StenoDictionaryList *dictionaryList;
+  const StenoDictionaryLookup *lookups;
+  StenoDictionaryLookupResult *results;
+  size_t count;
+  size_t splitDepth;
+
+  void Run() const;
+
+  static void ThreadEntryPoint(void *context) {
+    ((const LookupBatchContext *)context)->Run();
+  }
+};
+
+void StenoDictionaryList::LookupBatchContext::Run() const {
+#ifdef JAVELIN_THREADS
+  if (splitDepth != 0 && count >= 2 * MINIMUM_PARALLEL_LOOKUP_BATCH_SIZE) {
+    const size_t firstCount = count / 2;
+    const LookupBatchContext first = {
+        .dictionaryList = dictionaryList,
+        .lookups = lookups,
+        .results = results,
+        .count = firstCount,
+        .splitDepth = splitDepth - 1,
+    };
+    const LookupBatchContext second = {
+        .dictionaryList = dictionaryList,
+        .lookups = lookups + firstCount,
+        .results = results + firstCount,
+        .count = count - firstCount,
+        .splitDepth = splitDepth - 1,
+    };
+    RunParallel(&ThreadEntryPoint, (void *)&first, &ThreadEntryPoint,
+                (void *)&second);
+    return;
+  }
+#endif
+
+  for (size_t i = 0; i < count; ++i) {
+    // Shards may run concurrently, so must never update the lookup cache.
+    StenoDictionaryLookup lookup = lookups[i];
+#if ENABLE_DICTIONARY_LOOKUP_CACHE
+    lookup.updateCache = false;
+#endif
+    results[i] = dictionaryList->Lookup(lookup);
+  }
+}
+
+void StenoDictionaryList::LookupBatch(const StenoDictionaryLookup *lookups,
+                                      StenoDictionaryLookupResult *results,
+                                      size_t count) const {
+  const LookupBatchContext context = {
+      .dictionaryList = this,
+      .lookups = lookups,
+      .results = results,
+      .count = count,
+      .splitDepth = LOOKUP_BATCH_SPLIT_DEPTH,
+  };
+  context.Run();
+}
+
 void StenoDictionaryList::GetDictionariesForOutline(
     List<const StenoDictionary *> &results,
     const StenoDictionaryLookup &lookup) const {
@@ -301,3 +375,102 @@ void StenoDictionaryList::SendDictionaryStatus(const char *name,
 }
 
 //---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "../unit_test.h"
+#include "compact_map_dictionary.h"
+#include "jeff_numbers_dictionary.h"
+#include "jeff_phrasing_dictionary.h"
+#include "test_dictionary.h"
+
+TEST_BEGIN("DictionaryList: LookupBatch matches individual lookups") {
+  StenoCompactMapDictionary *testDictionary = new (TestDictionary::definition)
+      StenoCompactMapDictionary(TestDictionary::definition);
+
+  static StenoDictionary *DICTIONARIES[] = {
+      &StenoJeffPhrasingDictionary::instance,
+      &StenoJeffNumbersDictionary::instance,
+      testDictionary,
+  };
+  const StenoDictionaryList dictionaryList(
+      DICTIONARIES, sizeof(DICTIONARIES) / sizeof(*DICTIONARIES)); // NOLINT
+
+  // spellchecker: disable
+  const StenoStroke outlines[][2] = {
+      {StenoStroke("TEFT"), StenoStroke("-D")},
+      {StenoStroke("TEFT"), StenoStroke()},
+      {StenoStroke("SWR-RPB"), StenoStroke()},
+      {StenoStroke("1-9"), StenoStroke()},
+      {StenoStroke("KAT"), StenoStroke()},
+  };
+  // spellchecker: enable
+  const size_t outlineCount = sizeof(outlines) / sizeof(*outlines);
+
+  List<StenoDictionaryLookup> lookups;
+  srand(0x1234);
+  for (size_t i = 0; i < 2000; ++i) {
+    const StenoStroke *strokes = outlines[rand() % outlineCount];
+    lookups.Add(StenoDictionaryLookup(strokes, strokes[1].IsEmpty() ? 1 : 2));
+  }
+
+  StenoDictionaryLookupResult *results = (StenoDictionaryLookupResult *)malloc(
+      sizeof(StenoDictionaryLookupResult) * lookups.GetCount());
+  dictionaryList.LookupBatch(begin(lookups), results, lookups.GetCount());
+
+  for (size_t i = 0; i < lookups.GetCount(); ++i) {
+    StenoDictionaryLookupResult expected = dictionaryList.Lookup(lookups[i]);
+    assert(expected.IsValid() == results[i].IsValid());
+    if (expected.IsValid()) {
+      assert(Str::Eq(expected.GetText(), results[i].GetText()));
+    }
+    expected.Destroy();
+    results[i].Destroy();
+  }
+
+  free(results);
+  delete testDictionary;
+}
+TEST_END
+
+#if ENABLE_DICTIONARY_LOOKUP_CACHE
+TEST_BEGIN("DictionaryList: LookupBatch does not update the cache") {
+  static StenoDictionary *DICTIONARIES[] = {
+      &StenoJeffNumbersDictionary::instance,
+  };
+  StenoDictionaryList dictionaryList(DICTIONARIES, 1);
+  StenoDictionary *cacheDictionary =
+      dictionaryList.CreateCacheDictionary(&dictionaryList);
+  const size_t usedCount = StenoCachedTextPool::instance.GetUsedCount();
+
+  // Large enough to be sharded with JAVELIN_THREADS.
+  const size_t count = 4096;
+  const StenoStroke strokes[] = {"#S", "#T", "#P", "#H", "#ST", "#-T"};
+  List<StenoDictionaryLookup> lookups;
+  for (size_t i = 0; i < count; ++i) {
+    StenoDictionaryLookup lookup(&strokes[i % 6], 1);
+    lookup.updateCache = true;
+    lookups.Add(lookup);
+  }
+
+  StenoDictionaryLookupResult *results = (StenoDictionaryLookupResult *)malloc(
+      sizeof(StenoDictionaryLookupResult) * count);
+  dictionaryList.LookupBatch(begin(lookups), results, count);
+
+  assert(StenoCachedTextPool::instance.GetUsedCount() == usedCount);
+  for (size_t i = 0; i < count; ++i) {
+    assert(results[i].IsValid());
+    results[i].Destroy();
+  }
+  free(results);
+
+  // The cache marks lookups that miss for update.
+  for (const StenoStroke &stroke : strokes) {
+    const StenoDictionaryLookup lookup(&stroke, 1);
+    cacheDictionary->Lookup(lookup).Destroy();
+    assert(lookup.updateCache);
+  }
+}
+TEST_END
+#endif
+
+//---------------------------------------------------------------------------
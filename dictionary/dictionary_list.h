@@ -62,6 +62,7 @@ private:
 public:
   StenoDictionaryList(List<StenoDictionaryListEntry> &&dictionaries);
   StenoDictionaryList(StenoDictionary *const *dictionaries, size_t count);
+  ~StenoDictionaryList();
 
   virtual StenoDictionaryLookupResult
   Lookup(const StenoDictionaryLookup &lookup) const;
@@ -97,12 +98,28 @@ public:
   virtual void EnableAllDictionaries();
   virtual void DisableAllDictionaries();
 
+  // Any previous cache created by this list is destroyed.
   StenoDictionary *CreateCacheDictionary(StenoDictionary *dictionary);
 
+  // Resolves each lookup with the same priority order as Lookup(), writing
+  // the results to the corresponding index of results. The lookup cache is
+  // not updated.
+  //
+  // With JAVELIN_THREADS, large batches are sharded across threads.
+  void LookupBatch(const StenoDictionaryLookup *lookups,
+                   StenoDictionaryLookupResult *results, size_t count) const;
+
 private:
+  struct LookupBatchContext;
+
   FastIterable<StenoDictionaryListEntry> dictionaries;
 
+  // Batches are split in half this many times, giving up to 2^n threads.
+  static const size_t LOOKUP_BATCH_SPLIT_DEPTH = 2;
+  static const size_t MINIMUM_PARALLEL_LOOKUP_BATCH_SIZE = 256;
+
 #if ENABLE_DICTIONARY_LOOKUP_CACHE
+  bool hasCacheDictionary = false;
   mutable JavelinStaticAllocate<StenoCacheDictionary> cacheDictionaryContainer;
 #endif
 
@@ -24,6 +24,7 @@ public:
   using super::GetDictionaryForOutline;
 
   virtual const char *GetName() const;
+  virtual bool CanCacheDynamicResults() const { return true; }
 
   static StenoJeffNumbersDictionary instance;
 
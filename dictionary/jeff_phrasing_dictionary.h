@@ -22,6 +22,7 @@ public:
   GetDictionaryForOutline(const StenoDictionaryLookup &lookup) const;
 
   virtual const char *GetName() const;
+  virtual bool CanCacheDynamicResults() const { return true; }
   virtual void ReverseLookup(StenoReverseDictionaryLookup &lookup) const;
   virtual void PrintDictionary(PrintDictionaryContext &context) const;
 
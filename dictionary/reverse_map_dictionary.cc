@@ -1,4 +1,3 @@
-
 //---------------------------------------------------------------------------
 
 #include "reverse_map_dictionary.h"
@@ -41,8 +40,9 @@ void StenoReverseMapDictionary::PrintEntriesWithPrefix(
 const uint8_t *
 StenoReverseMapDictionary::FindMapDataLookup(const char *t) const {
   const uint8_t *text = (const uint8_t *)t;
-  const uint8_t *left = index[text[0]];
-  const uint8_t *right = index[text[0] + 1];
+  const uint8_t *left;
+  const uint8_t *right;
+  FindSearchRange(text, left, right);
 
   // Skip first letter as index ensures they're in range.
   ++text;
@@ -81,8 +81,9 @@ StenoReverseMapDictionary::FindMapDataLookup(const char *t) const {
 const uint8_t *
 StenoReverseMapDictionary::FindPrefixLookup(const char *t) const {
   const uint8_t *text = (const uint8_t *)t;
-  const uint8_t *left = index[text[0]];
-  const uint8_t *right = index[text[0] + 1];
+  const uint8_t *left;
+  const uint8_t *right;
+  FindSearchRange(text, left, right);
 
   while (left < right) {
     const uint8_t *mid = left + size_t(right - left) / 2;
@@ -118,6 +119,28 @@ StenoReverseMapDictionary::FindFirstEntryWithPrefix(int c) const {
   return left;
 }
 
+void StenoReverseMapDictionary::FindSearchRange(const uint8_t *text,
+                                                const uint8_t *&left,
+                                                const uint8_t *&right) const {
+  const int c = text[0];
+#if USE_REVERSE_MAP_SECOND_LEVEL_INDEX
+  const uint8_t *const *const secondLevel = secondLevelIndex[c];
+  if (c != 0 && secondLevel != nullptr) {
+    // Prefixes of length one cover the entire first level range.
+    if (text[1] == 0) {
+      left = secondLevel[0];
+      right = secondLevel[256];
+    } else {
+      left = secondLevel[text[1]];
+      right = secondLevel[text[1] + 1];
+    }
+    return;
+  }
+#endif
+  left = index[c];
+  right = index[c + 1];
+}
+
 void StenoReverseMapDictionary::AddMapDictionaryData(
     StenoReverseDictionaryLookup &lookup) const {
   const uint8_t *p = FindMapDataLookup(lookup.definition);
@@ -146,10 +169,127 @@ void StenoReverseMapDictionary::BuildIndex() {
     index[i] = FindFirstEntryWithPrefix((uint8_t) i);
   }
   index[256] = end(textBlock) - 1;
+
+#if USE_REVERSE_MAP_SECOND_LEVEL_INDEX
+  BuildSecondLevelIndex();
+#endif
+}
+
+#if USE_REVERSE_MAP_SECOND_LEVEL_INDEX
+
+const uint8_t *StenoReverseMapDictionary::FindFirstEntryWithSecondLetter(
+    const uint8_t *left, const uint8_t *right, int c) {
+  while (left < right) {
+    const uint8_t *mid = left + size_t(right - left) / 2;
+    const uint8_t *wordStart = StenoTextBlock::FindPreviousWordStart(mid);
+
+    const int secondLetter = wordStart[1];
+    if (secondLetter >= c) {
+      right = wordStart;
+    } else {
+      left = StenoTextBlock::FindNextWordStart(mid);
+    }
+  }
+  return left;
+}
+
+StenoReverseMapDictionary::~StenoReverseMapDictionary() {
+  free(secondLevelTables);
+}
+
+void StenoReverseMapDictionary::BuildSecondLevelIndex() {
+  size_t tableCount = 0;
+  for (size_t i = 1; i < 256; ++i) {
+    if (size_t(index[i + 1] - index[i]) >= SECOND_LEVEL_INDEX_MINIMUM_RANGE) {
+      ++tableCount;
+    }
+  }
+  secondLevelTables =
+      tableCount == 0
+          ? nullptr
+          : (const uint8_t **)malloc(tableCount * 257 * sizeof(uint8_t *));
+
+  const uint8_t **secondLevel = secondLevelTables;
+  secondLevelIndex[0] = nullptr;
+  for (size_t i = 1; i < 256; ++i) {
+    const uint8_t *left = index[i];
+    const uint8_t *right = index[i + 1];
+    if (size_t(right - left) < SECOND_LEVEL_INDEX_MINIMUM_RANGE) {
+      secondLevelIndex[i] = nullptr;
+      continue;
+    }
+
+    for (size_t j = 0; j < 256; ++j) {
+      secondLevel[j] = FindFirstEntryWithSecondLetter(left, right, j);
+    }
+    secondLevel[256] = right;
+    secondLevelIndex[i] = secondLevel;
+    secondLevel += 257;
+  }
 }
 
+#endif
+
 const char *StenoReverseMapDictionary::GetName() const {
   return "#internal#reverse_map_dictionary";
 }
 
 //---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "../unit_test.h"
+#include "compact_map_dictionary.h"
+#include "test_dictionary.h"
+#include <algorithm>
+
+TEST_BEGIN("ReverseMapDictionary: Prefix lookups match text block order") {
+  std::vector<std::string> words;
+  for (char first = 'a'; first <= 'c'; ++first) {
+    words.push_back(std::string(1, first));
+    for (char second = 'a'; second <= 'z'; ++second) {
+      for (const char *suffix : {"", "a", "b", "c", "d"}) {
+        words.push_back(std::string{first, second} + suffix);
+      }
+    }
+  }
+  std::sort(words.begin(), words.end());
+
+  std::vector<uint8_t> block;
+  std::vector<size_t> wordOffsets;
+  block.push_back(0xff);
+  for (const std::string &word : words) {
+    wordOffsets.push_back(block.size());
+    block.insert(block.end(), word.begin(), word.end());
+    block.insert(block.end(), {0, 0, 0, 0, 0, 0xff});
+  }
+  block.push_back(0);
+
+  StenoCompactMapDictionary *mainDictionary = new (TestDictionary::definition)
+      StenoCompactMapDictionary(TestDictionary::definition);
+  const SizedList<uint8_t> textBlock = {.count = block.size(),
+                                        .data = block.data()};
+  StenoReverseMapDictionary dictionary(mainDictionary, block.data(),
+                                       textBlock);
+
+  for (size_t i = 0; i < words.size(); ++i) {
+    const uint8_t *expectedData =
+        block.data() + wordOffsets[i] + words[i].size() + 1;
+    assert(dictionary.FindMapDataLookup(words[i].c_str()) == expectedData);
+  }
+  assert(dictionary.FindMapDataLookup("abe") == nullptr);
+  assert(dictionary.FindMapDataLookup("d") == nullptr);
+
+  // Prefix lookups return the first entry after the prefix.
+  for (const char *prefix : {"ab", "abz", "az", "b", "bzz", "c", "cz", "d"}) {
+    const auto it = std::upper_bound(words.begin(), words.end(), prefix);
+    const uint8_t *expected =
+        it == words.end() ? block.data() + block.size() - 1
+                          : block.data() + wordOffsets[it - words.begin()];
+    assert(dictionary.FindPrefixLookup(prefix) == expected);
+  }
+
+  delete mainDictionary;
+}
+TEST_END
+
+//---------------------------------------------------------------------------
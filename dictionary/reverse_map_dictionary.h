@@ -6,6 +6,16 @@
 
 //---------------------------------------------------------------------------
 
+// Hosts have the memory to build a second level (two byte prefix) index at
+// load time, which allows prefix lookups to resolve their range directly.
+#if JAVELIN_PLATFORM_PICO_SDK || JAVELIN_PLATFORM_NRF5_SDK
+#define USE_REVERSE_MAP_SECOND_LEVEL_INDEX 0
+#else
+#define USE_REVERSE_MAP_SECOND_LEVEL_INDEX 1
+#endif
+
+//---------------------------------------------------------------------------
+
 class StenoReverseMapDictionary final : public StenoWrappedDictionary {
 private:
   using super = StenoWrappedDictionary;
@@ -14,6 +24,9 @@ public:
   StenoReverseMapDictionary(StenoDictionary *dictionary,
                             const uint8_t *baseAddress,
                             const SizedList<uint8_t> &textBlock);
+#if USE_REVERSE_MAP_SECOND_LEVEL_INDEX
+  ~StenoReverseMapDictionary();
+#endif
 
   virtual void ReverseLookup(StenoReverseDictionaryLookup &lookup) const;
 
@@ -32,12 +45,32 @@ private:
   // Point to the first entry that has the starting letter.
   const uint8_t *index[257];
 
+#if USE_REVERSE_MAP_SECOND_LEVEL_INDEX
+  // For first letters with large ranges, points to the first entry that has
+  // the second letter. nullptr if the range is small enough to search.
+  const uint8_t **secondLevelIndex[256];
+
+  // Single allocation holding 257 entries for each second level index.
+  const uint8_t **secondLevelTables;
+
+  static const size_t SECOND_LEVEL_INDEX_MINIMUM_RANGE = 1024;
+#endif
+
   void AddMapDictionaryData(StenoReverseDictionaryLookup &lookup) const;
   void FilterResult(StenoReverseDictionaryLookup &lookup) const;
 
   const uint8_t *FindFirstEntryWithPrefix(int c) const;
+  void FindSearchRange(const uint8_t *text, const uint8_t *&left,
+                       const uint8_t *&right) const;
 
   void BuildIndex();
+
+#if USE_REVERSE_MAP_SECOND_LEVEL_INDEX
+  static const uint8_t *FindFirstEntryWithSecondLetter(const uint8_t *left,
+                                                       const uint8_t *right,
+                                                       int c);
+  void BuildSecondLevelIndex();
+#endif
 };
 
 //---------------------------------------------------------------------------
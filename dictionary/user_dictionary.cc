@@ -529,10 +529,11 @@ void StenoUserDictionary::PrintDictionary(
 }
 
 void StenoUserDictionary::PrintJsonDictionary() const {
-  Console::Printf("{");
-  ConsolePrintDictionaryContext context(GetName());
+  StreamingPrintDictionaryContext context(
+      GetName(), *ConsoleWriter::GetActiveWriter(), PrintDictionaryFormat::JSON);
+  context.Begin();
   PrintDictionary(context);
-  Console::Printf("\n}\n\n");
+  context.End();
 }
 
 const char *StenoUserDictionary::GetName() const { return "user_dictionary"; }
@@ -644,6 +645,8 @@ void StenoUserDictionary::AddConsoleCommands(Console &console) {
 #include "../str.h"
 #include "../unit_test.h"
 
+#define DO_PROFILE_EXPORT_TEST 0
+
 [[gnu::aligned(4096)]] static uint8_t userDictionaryBuffer[512 * 1024];
 
 TEST_BEGIN("StenoUserDictionary will reset if descriptor is invalid") {
@@ -824,6 +827,99 @@ TEST_BEGIN("StenoUserDictionary will dump Json dictionary") {
 }
 TEST_END
 
+TEST_BEGIN("StenoUserDictionary will dump binary dictionary") {
+  const StenoUserDictionaryData layout(userDictionaryBuffer,
+                                       sizeof(userDictionaryBuffer));
+
+  for (size_t i = 0; i < sizeof(userDictionaryBuffer); ++i) {
+    userDictionaryBuffer[i] = rand();
+  }
+
+  StenoUserDictionary userDictionary(layout);
+
+  // spellchecker: disable
+  const StenoStroke KAT[] = {StenoStroke("KAT")};
+  const StenoStroke KAPBG_RAO[] = {StenoStroke("KAPBG"), StenoStroke("RAO")};
+
+  userDictionary.Add(KAT, 1, "cat");
+  userDictionary.Add(KAPBG_RAO, 2, "kangaroo");
+
+  StreamingPrintDictionaryContext context(
+      nullptr, ConsoleWriter::instance, PrintDictionaryFormat::BINARY);
+  context.Begin();
+  userDictionary.PrintDictionary(context);
+  context.End();
+  assert(context.GetEntryCount() == 2);
+
+  BufferWriter binary;
+  binary.WriteVarUint(1);
+  binary.WriteVarUint(KAT[0].GetKeyState());
+  binary.WriteVarUint(3);
+  binary.Write("cat", 3);
+  binary.WriteVarUint(2);
+  binary.WriteVarUint(KAPBG_RAO[0].GetKeyState());
+  binary.WriteVarUint(KAPBG_RAO[1].GetKeyState());
+  binary.WriteVarUint(8);
+  binary.Write("kangaroo", 8);
+  binary.WriteVarUint(0);
+  // spellchecker: enable
+
+  BufferWriter expected;
+  expected.WriteBase64(binary.GetBuffer(), binary.GetCount());
+  expected.Write("\n\n", 2);
+
+  assert(Console::history.size() == expected.GetCount());
+  assert(memcmp(&Console::history.front(), expected.GetBuffer(),
+                expected.GetCount()) == 0);
+}
+TEST_END
+
+TEST_BEGIN("StenoUserDictionary streaming export throughput") {
+  const StenoUserDictionaryData layout(userDictionaryBuffer,
+                                       sizeof(userDictionaryBuffer));
+  memset(userDictionaryBuffer, 0xff, sizeof(userDictionaryBuffer));
+
+  StenoUserDictionary userDictionary(layout);
+
+  const size_t dictionaryEntryCount = 1000;
+  for (size_t i = 0; i < dictionaryEntryCount; ++i) {
+    const StenoStroke strokes[] = {StenoStroke(i + 1), StenoStroke(i * 7)};
+    char text[32];
+    Str::Sprintf(text, "entry \"%zu\"", i);
+    userDictionary.Add(strokes, 2, text);
+  }
+
+#if DO_PROFILE_EXPORT_TEST
+  const size_t iterationCount = 1000;
+#else
+  const size_t iterationCount = 2;
+#endif
+
+  for (PrintDictionaryFormat format :
+       {PrintDictionaryFormat::JSON, PrintDictionaryFormat::BINARY}) {
+    CountWriter writer;
+    size_t entryCount = 0;
+
+    const ProfileTimer timer;
+    for (size_t i = 0; i < iterationCount; ++i) {
+      StreamingPrintDictionaryContext context(nullptr, writer, format);
+      context.Begin();
+      userDictionary.PrintDictionary(context);
+      context.End();
+      entryCount += context.GetEntryCount();
+    }
+#if DO_PROFILE_EXPORT_TEST
+    timer.PrintRate(format == PrintDictionaryFormat::JSON ? "JSON export"
+                                                          : "Binary export",
+                    entryCount, "entries");
+#endif
+
+    assert(entryCount == dictionaryEntryCount * iterationCount);
+    assert(writer.GetCount() != 0);
+  }
+}
+TEST_END
+
 TEST_BEGIN("StenoUserDictionary will not erase on every overwrite") {
   // spellchecker: disable
   const StenoStroke KAT[] = {StenoStroke("KAT")};
@@ -144,13 +144,15 @@ void StenoEngine::PrintInfo() const {
   GetDictionary().PrintInfo(4);
 }
 
-void StenoEngine::PrintDictionary(const char *name) const {
+void StenoEngine::PrintDictionary(const char *name,
+                                  PrintDictionaryFormat format) const {
   const ExternalFlashSentry externalFlashSentry;
 
-  Console::Printf("{");
-  ConsolePrintDictionaryContext context(name);
+  StreamingPrintDictionaryContext context(
+      name, *ConsoleWriter::GetActiveWriter(), format);
+  context.Begin();
   GetDictionary().PrintDictionary(context);
-  Console::Printf("\n}\n\n");
+  context.End();
 }
 
 void StenoEngine::ListDictionaries() const {
@@ -244,6 +246,7 @@ char *StenoEngine::ConvertText(StenoSegmentList &segments,
 
 #if RUN_TESTS
 
+#include "engine_event_queue.h"
 #include "key.h"
 #include "key_code.h"
 #include "unit_test.h"
@@ -280,6 +283,7 @@ public:
   static void TestScancodeAddTranslation(StenoEngine &engine);
   static void TestRetroInsertSpace(StenoEngine &engine);
   static void TestRetroInsertSpaceAutoSuffix(StenoEngine &engine);
+  static void TestBatchDoesNotAffectState(StenoEngine &engine);
   static void VerifyTextBuffer(StenoEngine &engine, const char *expected);
 };
 
@@ -293,6 +297,28 @@ void StenoEngineTester::VerifyTextBuffer(StenoEngine &engine,
   free(p);
 }
 
+#if JAVELIN_ENGINE_TRANSLATE_STROKES_COMMAND
+void StenoEngineTester::TestBatchDoesNotAffectState(StenoEngine &engine) {
+  // spellchecker: disable
+  engine.Process(StenoStroke("TEFT"));
+  Key::history.clear();
+  char *text = engine.nextConversionBuffer.keyCodeBuffer.ToString();
+  const size_t strokeCount = engine.GetStrokeCount();
+
+  StenoEngine::TranslateStrokes_Binding(&engine, "translate_strokes TEFT/-G");
+  // spellchecker: enable
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(), "t: testing\n\n"));
+  Console::history.clear();
+
+  assert(engine.GetStrokeCount() == strokeCount);
+  assert(engine.history.GetCount() == 1);
+  VerifyTextBuffer(engine, text);
+  assert(Key::history.empty());
+  free(text);
+}
+#endif
+
 void StenoEngineTester::TestSymbols(StenoEngine &engine) {
   // spellchecker: disable
   engine.ProcessStroke(StenoStroke("SKWHEUFPL"));
@@ -504,6 +530,9 @@ TEST_BEGIN("Engine: Random spam") {
   for (size_t i = 0; i < iterationCount; ++i) {
     const StenoStroke stroke(rand() & StrokeMask::ALL);
     engine.ProcessStroke(stroke);
+
+    // There is no main loop to write queued events.
+    EngineEventQueue::instance.Flush();
   }
 
   Key::EnableHistory();
@@ -665,6 +694,125 @@ TEST_BEGIN("Engine: Verify =retro_insert_space with auto-suffix") {
 }
 TEST_END
 
+TEST_BEGIN("Engine: Batch translation of stroke log") {
+  StenoCompactMapDictionary *testDictionary = new (TestDictionary::definition)
+      StenoCompactMapDictionary(TestDictionary::definition);
+
+  StenoDictionary *const DICTIONARIES[] = {
+      &StenoEmilySymbolsDictionary::specifySpacesInstance,
+      testDictionary,
+  };
+
+  StenoDictionaryList dictionaryList(
+      DICTIONARIES, sizeof(DICTIONARIES) / sizeof(*DICTIONARIES)); // NOLINT
+  const StenoCompiledOrthography orthography(
+      StenoOrthography::emptyOrthography);
+  StenoSystem system;
+  StenoEngine engine(dictionaryList, &system, orthography);
+
+  // spellchecker: disable
+  BufferWriter writer;
+  const size_t count =
+      engine.TranslateBatch("TEFT/-G TEFT\n-D\nTEFT TEFT *", writer);
+  // spellchecker: enable
+  writer.WriteByte('\0');
+
+  assert(count == 7);
+  assert(Str::Eq(writer.GetBuffer(), "testing tested test"));
+  assert(Key::history.empty());
+  assert(engine.GetStrokeCount() == 0);
+
+#if JAVELIN_ENGINE_TRANSLATE_STROKES_COMMAND
+  StenoEngineTester::TestBatchDoesNotAffectState(engine);
+#endif
+
+  delete testDictionary;
+}
+TEST_END
+
+#if ENABLE_DICTIONARY_LOOKUP_CACHE
+TEST_BEGIN("Engine: Batch translation does not update the lookup cache") {
+  StenoCompactMapDictionary *testDictionary = new (TestDictionary::definition)
+      StenoCompactMapDictionary(TestDictionary::definition);
+
+  StenoDictionary *const DICTIONARIES[] = {testDictionary};
+
+  StenoDictionaryList dictionaryList(DICTIONARIES, 1);
+  StenoDictionary *cacheDictionary =
+      dictionaryList.CreateCacheDictionary(&dictionaryList);
+  const StenoCompiledOrthography orthography(
+      StenoOrthography::emptyOrthography);
+  StenoSystem system;
+  StenoEngine engine(*cacheDictionary, &system, orthography);
+
+  // spellchecker: disable
+  const StenoStroke stroke("TEFT");
+  BufferWriter writer;
+  engine.TranslateBatch(&stroke, 1, writer);
+  writer.WriteByte('\0');
+  assert(Str::Eq(writer.GetBuffer(), "test"));
+  // spellchecker: enable
+
+  // The cache marks lookups that miss for update.
+  const StenoDictionaryLookup lookup(&stroke, 1);
+  cacheDictionary->Lookup(lookup).Destroy();
+  assert(lookup.updateCache);
+
+  delete testDictionary;
+}
+TEST_END
+#endif
+
+TEST_BEGIN("Engine: Batch translation throughput") {
+  StenoCompactMapDictionary *mainDictionary =
+      new (DICTIONARY) StenoCompactMapDictionary(DICTIONARY);
+  StenoCompactMapDictionary *testDictionary = new (TestDictionary::definition)
+      StenoCompactMapDictionary(TestDictionary::definition);
+
+  static StenoDictionary *DICTIONARIES[] = {
+      &StenoJeffShowStrokeDictionary::instance,
+      &StenoJeffPhrasingDictionary::instance,
+      &StenoJeffNumbersDictionary::instance,
+      &StenoEmilySymbolsDictionary::specifySpacesInstance,
+      mainDictionary,
+      testDictionary,
+  };
+
+  StenoDictionaryList dictionaryList(
+      DICTIONARIES, sizeof(DICTIONARIES) / sizeof(*DICTIONARIES)); // NOLINT
+
+  const StenoCompiledOrthography orthography(
+      StenoOrthography::emptyOrthography);
+  StenoSystem system;
+  StenoEngine engine(*dictionaryList.CreateCacheDictionary(&dictionaryList),
+                     &system, orthography);
+
+#if DO_PROFILE_TEST
+  const size_t strokeCount = 1'000'000;
+#else
+  const size_t strokeCount = 1000;
+#endif
+  srand(0x1234);
+  List<StenoStroke> strokes;
+  for (size_t i = 0; i < strokeCount; ++i) {
+    strokes.Add(StenoStroke(rand() & StrokeMask::ALL));
+  }
+
+  CountWriter writer;
+  const ProfileTimer timer;
+  engine.TranslateBatch(begin(strokes), strokes.GetCount(), writer);
+#if DO_PROFILE_TEST
+  timer.PrintRate("Batch translation", strokeCount, "strokes");
+#endif
+
+  assert(writer.GetCount() != 0);
+  assert(Key::history.empty());
+
+  delete mainDictionary;
+  delete testDictionary;
+}
+TEST_END
+
 //---------------------------------------------------------------------------
 #endif // RUN_TESTS
 //---------------------------------------------------------------------------
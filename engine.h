@@ -22,6 +22,18 @@ struct StenoSystem;
 
 //---------------------------------------------------------------------------
 
+// translate_strokes allocates a second engine on the heap for each command,
+// so is only registered on the host.
+#if !defined(JAVELIN_ENGINE_TRANSLATE_STROKES_COMMAND)
+#if JAVELIN_PLATFORM_PICO_SDK || JAVELIN_PLATFORM_NRF5_SDK
+#define JAVELIN_ENGINE_TRANSLATE_STROKES_COMMAND 0
+#else
+#define JAVELIN_ENGINE_TRANSLATE_STROKES_COMMAND 1
+#endif
+#endif
+
+//---------------------------------------------------------------------------
+
 enum StenoEngineMode { NORMAL, ADD_TRANSLATION, CONSOLE };
 
 //---------------------------------------------------------------------------
@@ -43,7 +55,9 @@ public:
 
   void SendText(const uint8_t *p);
   void PrintInfo() const;
-  void PrintDictionary(const char *name) const;
+  void PrintDictionary(
+      const char *name,
+      PrintDictionaryFormat format = PrintDictionaryFormat::JSON) const;
 
   void ListDictionaries() const;
   bool EnableDictionary(const char *name);
@@ -87,6 +101,16 @@ public:
   char *ConvertText(StenoSegmentList &segments, size_t startingOffset,
                     size_t startingStrokeId);
 
+  // Translates strokes in a separate engine starting from a reset state,
+  // without emitting key presses, paper tape or suggestions, and writes the
+  // final text to writer.
+  void TranslateBatch(const StenoStroke *strokes, size_t count,
+                      IWriter &writer) const;
+
+  // Translates a stroke log, where strokes are separated by whitespace or
+  // '/'. Returns the number of strokes translated.
+  size_t TranslateBatch(const char *strokeLog, IWriter &writer) const;
+
 private:
   static constexpr size_t PAPER_TAPE_SUGGESTION_SEGMENT_LIMIT = 8;
 
@@ -111,6 +135,10 @@ private:
 
   StenoKeyCodeEmitter emitter;
 
+  // When non-null, strokes are being batch translated, and output text is
+  // accumulated here instead of being emitted.
+  BufferWriter *batchText = nullptr;
+
   StenoStrokeHistory history;
   StenoStrokeHistory altTranslationHistory;
 
@@ -161,6 +189,12 @@ private:
   void ConsoleModeExecute();
   void EndConsoleMode();
 
+  StenoEngine *CreateBatchEngine(BufferWriter &text) const;
+  static void EndBatchTranslation(StenoEngine *engine, IWriter &writer);
+  bool UpdateBatchText(const StenoKeyCodeBuffer &previousKeyCodeBuffer,
+                       const StenoKeyCodeBuffer &nextKeyCodeBuffer);
+  void RemoveBatchTextCharacters(size_t count);
+
   bool IsNewline(StenoStroke stroke) const;
   void AddTranslation(size_t newlineIndex);
   void DeleteTranslation(size_t newlineIndex);
@@ -213,6 +247,8 @@ private:
   static void DisableDictionary_Binding(void *context, const char *commandLine);
   static void ToggleDictionary_Binding(void *context, const char *commandLine);
   static void PrintDictionary_Binding(void *context, const char *commandLine);
+  static void PrintBinaryDictionary_Binding(void *context,
+                                            const char *commandLine);
   static void Lookup_Binding(void *context, const char *commandLine);
   static void LookupPrefix_Binding(void *context, const char *commandLine);
   static void LookupStroke_Binding(void *context, const char *commandLine);
@@ -220,6 +256,10 @@ private:
                                            const char *commandLine);
   static void RemoveOutline_Binding(void *context, const char *commandLine);
   static void ProcessStrokes_Binding(void *context, const char *commandLine);
+#if JAVELIN_ENGINE_TRANSLATE_STROKES_COMMAND
+  static void TranslateStrokes_Binding(void *context,
+                                       const char *commandLine);
+#endif
 
   static void ListTemplateValues_Binding(void *context,
                                          const char *commandLine);
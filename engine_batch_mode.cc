@@ -0,0 +1,148 @@
+//---------------------------------------------------------------------------
+
+#include "engine.h"
+#include "dictionary/dictionary.h"
+#include "str.h"
+
+//---------------------------------------------------------------------------
+
+static bool IsStrokeSeparator(int c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '/';
+}
+
+//---------------------------------------------------------------------------
+
+void StenoEngine::TranslateBatch(const StenoStroke *strokes, size_t count,
+                                 IWriter &writer) const {
+  BufferWriter text;
+  StenoEngine *engine = CreateBatchEngine(text);
+  for (size_t i = 0; i < count; ++i) {
+    engine->Process(strokes[i]);
+  }
+  EndBatchTranslation(engine, writer);
+}
+
+size_t StenoEngine::TranslateBatch(const char *strokeLog,
+                                   IWriter &writer) const {
+  BufferWriter text;
+  StenoEngine *engine = CreateBatchEngine(text);
+
+  size_t count = 0;
+  const char *p = strokeLog;
+  for (;;) {
+    while (IsStrokeSeparator(*p)) {
+      ++p;
+    }
+    if (*p == '\0') {
+      break;
+    }
+
+    const char *start = p;
+    while (*p != '\0' && !IsStrokeSeparator(*p)) {
+      ++p;
+    }
+
+    char *strokeText = Str::DupN(start, p - start);
+    StenoStroke stroke;
+    stroke.Set(strokeText);
+    free(strokeText);
+
+    if (stroke.IsNotEmpty()) {
+      engine->Process(stroke);
+      ++count;
+    }
+  }
+
+  EndBatchTranslation(engine, writer);
+  return count;
+}
+
+// Batches run in their own engine, so that the history, state and stroke
+// count of this engine are unaffected.
+//
+// Lookups bypass any StenoCacheDictionary, so that batches do not evict the
+// entries of this engine. The dictionary tree is otherwise shared, so the
+// wrapped dictionaries keep their parents.
+StenoEngine *StenoEngine::CreateBatchEngine(BufferWriter &text) const {
+  StenoEngine *engine =
+      new StenoEngine(*storedDictionaries, system, orthography, undoStroke);
+  StenoDictionary *dictionary = storedDictionaries->GetLookupDictionary();
+  engine->activeDictionary = dictionary;
+  engine->storedDictionaries = dictionary;
+  engine->previousConversionBuffer.Prepare(&engine->orthography, dictionary);
+  engine->nextConversionBuffer.Prepare(&engine->orthography, dictionary);
+  engine->placeSpaceAfter = placeSpaceAfter;
+  engine->batchText = &text;
+  return engine;
+}
+
+void StenoEngine::EndBatchTranslation(StenoEngine *engine, IWriter &writer) {
+  // Strokes that launch other modes are ignored during batch translation,
+  // so the engine should still be in normal mode.
+  assert(engine->mode == StenoEngineMode::NORMAL);
+  engine->batchText->WriteBufferTo(&writer);
+  for (TemplateValue &templateValue : engine->templateValues) {
+    templateValue.Set(nullptr);
+  }
+  delete engine;
+}
+
+// Mirrors StenoKeyCodeEmitter::Process, but updates batchText rather than
+// emitting key presses. Returns whether the update can combine undo.
+bool StenoEngine::UpdateBatchText(
+    const StenoKeyCodeBuffer &previousKeyCodeBuffer,
+    const StenoKeyCodeBuffer &nextKeyCodeBuffer) {
+  const StenoKeyCode *previousData = previousKeyCodeBuffer.buffer;
+  const size_t previousLength = previousKeyCodeBuffer.GetCount();
+  const StenoKeyCode *nextData = nextKeyCodeBuffer.buffer;
+  const size_t nextLength = nextKeyCodeBuffer.GetCount();
+  size_t i = 0;
+  while (i < previousLength && i < nextLength &&
+         previousData[i].HasSameOutput(nextData[i])) {
+    ++i;
+  }
+
+  // As with the emitter, undo can only be combined if no characters were
+  // removed or added.
+  bool shouldCombineUndo = true;
+  size_t backspaceCount = 0;
+  for (size_t j = i; j < previousLength; ++j) {
+    if (!previousData[j].IsRawKeyCode()) {
+      ++backspaceCount;
+    }
+  }
+  if (backspaceCount != 0) {
+    shouldCombineUndo = false;
+    RemoveBatchTextCharacters(backspaceCount);
+  }
+
+  for (size_t j = i; j < nextLength; ++j) {
+    if (!nextData[j].IsRawKeyCode()) {
+      shouldCombineUndo = false;
+      break;
+    }
+  }
+
+  if (i < nextLength) {
+    char *text = nextKeyCodeBuffer.ToString(i);
+    batchText->WriteString(text);
+    free(text);
+  }
+
+  return shouldCombineUndo;
+}
+
+void StenoEngine::RemoveBatchTextCharacters(size_t count) {
+  const char *text = batchText->GetBuffer();
+  size_t length = batchText->GetCount();
+  while (count > 0 && length > 0) {
+    // Skip back over UTF-8 continuation bytes.
+    do {
+      --length;
+    } while (length > 0 && (text[length] & 0xc0) == 0x80);
+    --count;
+  }
+  batchText->Truncate(length);
+}
+
+//---------------------------------------------------------------------------
@@ -3,7 +3,9 @@
 #include "console.h"
 #include "dictionary/dictionary.h"
 #include "engine.h"
+#include "engine_event_queue.h"
 #include "hal/external_flash.h"
+#include "metrics.h"
 #include "stroke_list_parser.h"
 #include "writer.h"
 
@@ -125,6 +127,17 @@ void StenoEngine::PrintDictionary_Binding(void *context,
   engine->PrintDictionary(dictionary);
 }
 
+void StenoEngine::PrintBinaryDictionary_Binding(void *context,
+                                                const char *commandLine) {
+  const char *dictionary = strchr(commandLine, ' ');
+  if (dictionary) {
+    ++dictionary;
+  }
+
+  StenoEngine *engine = (StenoEngine *)context;
+  engine->PrintDictionary(dictionary, PrintDictionaryFormat::BINARY);
+}
+
 void StenoEngine::Lookup_Binding(void *context, const char *commandLine) {
   const char *definition = strchr(commandLine, ' ');
   if (definition == nullptr) {
@@ -353,6 +366,23 @@ void StenoEngine::ProcessStrokes_Binding(void *context,
   ConsoleWriter::Pop();
 }
 
+#if JAVELIN_ENGINE_TRANSLATE_STROKES_COMMAND
+void StenoEngine::TranslateStrokes_Binding(void *context,
+                                           const char *commandLine) {
+  const char *strokeStart = strchr(commandLine, ' ');
+  if (!strokeStart) {
+    Console::Printf("ERR No strokes specified\n\n");
+    return;
+  }
+
+  const StenoEngine *engine = (const StenoEngine *)context;
+  BufferWriter text;
+  engine->TranslateBatch(strokeStart + 1, text);
+  text.WriteByte('\0');
+  Console::Printf("t: %Y\n\n", text.GetBuffer());
+}
+#endif
+
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wstring-plus-int"
 void StenoEngine::ListTemplateValues_Binding(void *context,
@@ -430,6 +460,9 @@ void StenoEngine::AddConsoleCommands(Console &console) {
   console.RegisterCommand("print_dictionary",
                           "Prints a dictionary in JSON format",
                           StenoEngine::PrintDictionary_Binding, this);
+  console.RegisterCommand("print_binary_dictionary",
+                          "Prints a dictionary in base64 encoded binary format",
+                          StenoEngine::PrintBinaryDictionary_Binding, this);
   console.RegisterCommand("lookup", "Looks up a definition",
                           StenoEngine::Lookup_Binding, this);
   console.RegisterCommand("lookup_prefix",
@@ -445,10 +478,18 @@ void StenoEngine::AddConsoleCommands(Console &console) {
                           StenoEngine::RemoveOutline_Binding, this);
   console.RegisterCommand("process_strokes", "Processes a stroke list",
                           StenoEngine::ProcessStrokes_Binding, this);
+#if JAVELIN_ENGINE_TRANSLATE_STROKES_COMMAND
+  console.RegisterCommand("translate_strokes",
+                          "Translates a stroke list without affecting state",
+                          StenoEngine::TranslateStrokes_Binding, this);
+#endif
   console.RegisterCommand("list_template_values", "Lists all template values",
                           StenoEngine::ListTemplateValues_Binding, this);
   console.RegisterCommand("set_template_value", "Sets template value",
                           StenoEngine::SetTemplateValue_Binding, this);
+
+  Metrics::Register("engine", "strokes", MetricType::COUNTER, &strokeCount);
+  EngineEventQueue::instance.RegisterMetrics();
 }
 
 //---------------------------------------------------------------------------
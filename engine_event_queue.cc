@@ -0,0 +1,401 @@
+//---------------------------------------------------------------------------
+
+#include "engine_event_queue.h"
+#include "clock.h"
+#include "console.h"
+#include "dictionary/dictionary.h"
+#include "mem.h"
+#include "metrics.h"
+#include "str.h"
+#include <stdlib.h>
+
+//---------------------------------------------------------------------------
+
+constexpr int TIMER_ID = -(('E' << 24) | ('V' << 16) | ('Q' << 8) | 'U');
+
+EngineEventQueue EngineEventQueue::instance;
+
+//---------------------------------------------------------------------------
+
+// Record payloads, following the RecordHeader:
+//
+//   PAPER_TAPE:      stroke, uint32_t undoCount, dictionaryName, text
+//   PAPER_TAPE_UNDO: stroke, uint32_t undoCount
+//   SUGGESTION:      uint32_t arrowPrefixCount,
+//                    {uint32_t length, StenoStroke strokes[length]}[count],
+//                    dictionaryName, text
+//
+// Strings are null terminated, with an empty dictionaryName if it is not
+// shown.
+
+uint8_t *EngineEventQueue::Allocate(RecordType type, size_t size,
+                                    size_t count) {
+  const size_t recordSize = AlignUp(sizeof(RecordHeader) + size, 4);
+  if (recordSize > BUFFER_SIZE / 2) {
+    oversizedRecord = (RecordHeader *)malloc(recordSize);
+    if (oversizedRecord == nullptr) {
+      ++statistics.droppedCount;
+      return nullptr;
+    }
+    *oversizedRecord = {
+        .size = 0,
+        .type = type,
+        .count = uint8_t(count),
+    };
+    return (uint8_t *)(oversizedRecord + 1);
+  }
+
+  const size_t offset = writeOffset & (BUFFER_SIZE - 1);
+  const size_t paddingSize =
+      offset + recordSize > BUFFER_SIZE ? BUFFER_SIZE - offset : 0;
+  if (GetUsedSize() + paddingSize + recordSize > BUFFER_SIZE) {
+    ++statistics.droppedCount;
+    return nullptr;
+  }
+
+  if (paddingSize != 0) {
+    *(RecordHeader *)(buffer + offset) = {
+        .size = uint16_t(paddingSize),
+        .type = RecordType::PADDING,
+        .count = 0,
+    };
+    writeOffset += paddingSize;
+  }
+
+  RecordHeader *header =
+      (RecordHeader *)(buffer + (writeOffset & (BUFFER_SIZE - 1)));
+  *header = {
+      .size = uint16_t(recordSize),
+      .type = type,
+      .count = uint8_t(count),
+  };
+  return (uint8_t *)(header + 1);
+}
+
+void EngineEventQueue::Commit() {
+  if (oversizedRecord != nullptr) {
+    Flush();
+    PrintRecord(oversizedRecord);
+    free(oversizedRecord);
+    oversizedRecord = nullptr;
+    ++statistics.oversizedCount;
+    return;
+  }
+
+  const RecordHeader *header =
+      (const RecordHeader *)(buffer + (writeOffset & (BUFFER_SIZE - 1)));
+  writeOffset += header->size;
+
+  ++statistics.addedCount;
+  if (GetUsedSize() > statistics.maxUsedSize) {
+    statistics.maxUsedSize = GetUsedSize();
+  }
+
+  if (!isTimerActive) {
+    isTimerActive = true;
+    TimerManager::instance.StartTimer(TIMER_ID, 0, false, this,
+                                      Clock::GetMilliseconds());
+  }
+}
+
+static uint8_t *WriteString(uint8_t *p, const char *text, size_t length) {
+  Mem::Copy((char *)p, text, length);
+  p[length] = '\0';
+  return p + length + 1;
+}
+
+//---------------------------------------------------------------------------
+
+bool EngineEventQueue::AddPaperTape(StenoStroke stroke, size_t undoCount,
+                                    const char *dictionaryName,
+                                    const char *text, size_t textLength) {
+  if (dictionaryName == nullptr) {
+    dictionaryName = "";
+  }
+  const size_t dictionaryNameLength = Str::Length(dictionaryName);
+
+  uint8_t *p = Allocate(RecordType::PAPER_TAPE,
+                        sizeof(StenoStroke) + sizeof(uint32_t) +
+                            dictionaryNameLength + 1 + textLength + 1,
+                        0);
+  if (p == nullptr) {
+    return false;
+  }
+
+  *(StenoStroke *)p = stroke;
+  *(uint32_t *)(p + 4) = undoCount;
+  p = WriteString(p + 8, dictionaryName, dictionaryNameLength);
+  WriteString(p, text, textLength);
+  Commit();
+  return true;
+}
+
+bool EngineEventQueue::AddPaperTapeUndo(StenoStroke stroke,
+                                        size_t undoCount) {
+  uint8_t *p = Allocate(RecordType::PAPER_TAPE_UNDO,
+                        sizeof(StenoStroke) + sizeof(uint32_t), 0);
+  if (p == nullptr) {
+    return false;
+  }
+
+  *(StenoStroke *)p = stroke;
+  *(uint32_t *)(p + 4) = undoCount;
+  Commit();
+  return true;
+}
+
+bool EngineEventQueue::AddSuggestion(
+    size_t arrowPrefixCount, const char *text,
+    const StenoReverseDictionaryResult *results, size_t resultCount,
+    const char *dictionaryName) {
+  if (dictionaryName == nullptr) {
+    dictionaryName = "";
+  }
+  const size_t dictionaryNameLength = Str::Length(dictionaryName);
+  const size_t textLength = Str::Length(text);
+
+  size_t size = sizeof(uint32_t) + dictionaryNameLength + 1 + textLength + 1;
+  for (size_t i = 0; i < resultCount; ++i) {
+    size += sizeof(uint32_t) + results[i].length * sizeof(StenoStroke);
+  }
+
+  uint8_t *p = Allocate(RecordType::SUGGESTION, size, resultCount);
+  if (p == nullptr) {
+    return false;
+  }
+
+  *(uint32_t *)p = arrowPrefixCount;
+  p += sizeof(uint32_t);
+  for (size_t i = 0; i < resultCount; ++i) {
+    const StenoReverseDictionaryResult &result = results[i];
+    *(uint32_t *)p = result.length;
+    p += sizeof(uint32_t);
+    result.strokes->CopyTo((StenoStroke *)p, result.length);
+    p += result.length * sizeof(StenoStroke);
+  }
+  p = WriteString(p, dictionaryName, dictionaryNameLength);
+  WriteString(p, text, textLength);
+  Commit();
+  return true;
+}
+
+bool EngineEventQueue::ShouldSkipSuggestions() {
+  if (BUFFER_SIZE - GetUsedSize() >= SUGGESTION_RESERVE_SIZE) {
+    return false;
+  }
+  ++statistics.skippedSuggestionCount;
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+void EngineEventQueue::PrintRecord(const RecordHeader *header) const {
+  const uint8_t *p = (const uint8_t *)(header + 1);
+  switch (header->type) {
+  case RecordType::PADDING:
+    break;
+
+  case RecordType::PAPER_TAPE: {
+    const StenoStroke *stroke = (const StenoStroke *)p;
+    const size_t undoCount = *(const uint32_t *)(p + 4);
+    const char *dictionaryName = (const char *)(p + 8);
+    const char *text = dictionaryName + Str::Length(dictionaryName) + 1;
+
+    Console::Printf<"EV e: p\no: %t">(stroke);
+    if (undoCount > 0) {
+      Console::Printf<"\nu: %zu">(undoCount);
+    }
+    if (*dictionaryName) {
+      Console::Printf<"\nd: %Y">(dictionaryName);
+    }
+    Console::Printf<"\nt: %Y\n\n">(text);
+  } break;
+
+  case RecordType::PAPER_TAPE_UNDO: {
+    const StenoStroke *stroke = (const StenoStroke *)p;
+    const size_t undoCount = *(const uint32_t *)(p + 4);
+    Console::Printf<"EV e: p\no: %t\nu: %zu\n\n">(stroke, undoCount);
+  } break;
+
+  case RecordType::SUGGESTION: {
+    const size_t arrowPrefixCount = *(const uint32_t *)p;
+    p += sizeof(uint32_t);
+
+    // Find the strings first, since the results are printed after the text.
+    const uint8_t *results = p;
+    for (size_t i = 0; i < header->count; ++i) {
+      const size_t length = *(const uint32_t *)p;
+      p += sizeof(uint32_t) + length * sizeof(StenoStroke);
+    }
+    const char *dictionaryName = (const char *)p;
+    const char *text = dictionaryName + Str::Length(dictionaryName) + 1;
+
+    Console::Printf<"EV e: s\nc: %zu\nt: %Y\no: ">(arrowPrefixCount, text);
+    if (header->count != 1) {
+      Console::Printf("[");
+    }
+    p = results;
+    for (size_t i = 0; i < header->count; ++i) {
+      const size_t length = *(const uint32_t *)p;
+      const StenoStroke *strokes = (const StenoStroke *)(p + 4);
+      if (i != 0) {
+        Console::Printf(",");
+      }
+      Console::Printf<"%O">(strokes, length);
+      p += sizeof(uint32_t) + length * sizeof(StenoStroke);
+    }
+    if (header->count != 1) {
+      Console::Printf("]");
+    }
+    if (*dictionaryName) {
+      Console::Printf<"\nd: %Y">(dictionaryName);
+    }
+    Console::Printf("\n\n");
+  } break;
+  }
+}
+
+void EngineEventQueue::Flush() {
+  if (isTimerActive) {
+    isTimerActive = false;
+    TimerManager::instance.StopTimer(TIMER_ID, Clock::GetMilliseconds());
+  }
+
+  while (!IsEmpty()) {
+    const RecordHeader *header =
+        (const RecordHeader *)(buffer + (readOffset & (BUFFER_SIZE - 1)));
+    PrintRecord(header);
+    readOffset += header->size;
+  }
+}
+
+void EngineEventQueue::Run(intptr_t id) {
+  // The timer has already been removed.
+  isTimerActive = false;
+  Flush();
+}
+
+//---------------------------------------------------------------------------
+
+void EngineEventQueue::RegisterMetrics() const {
+  Metrics::Register("engineEvents", "added", MetricType::COUNTER,
+                    &statistics.addedCount);
+  Metrics::Register("engineEvents", "dropped", MetricType::COUNTER,
+                    &statistics.droppedCount);
+  Metrics::Register("engineEvents", "oversized", MetricType::COUNTER,
+                    &statistics.oversizedCount);
+  Metrics::Register("engineEvents", "skippedSuggestions", MetricType::COUNTER,
+                    &statistics.skippedSuggestionCount);
+  Metrics::Register("engineEvents", "maxUsedBytes", MetricType::GAUGE,
+                    &statistics.maxUsedSize);
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "unit_test.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+static void VerifyConsoleHistory(const char *expected) {
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(), expected));
+  Console::history.clear();
+}
+
+TEST_BEGIN("EngineEventQueue: Records are printed on flush") {
+  EngineEventQueue &queue = EngineEventQueue::instance;
+  Console::history.clear();
+
+  assert(queue.AddPaperTape(StenoStroke("KAT"), 0, "main.json", "cat", 3));
+  assert(queue.AddPaperTape(StenoStroke("-S"), 1, nullptr, "{^s}", 4));
+  assert(queue.AddPaperTapeUndo(StenoStroke("*"), 2));
+
+  StenoStroke strokes[] = {"KAT", "-S"};
+  const StenoReverseDictionaryResult results[] = {
+      {.length = 2, .strokes = strokes, .dictionary = nullptr},
+      {.length = 1, .strokes = strokes, .dictionary = nullptr},
+  };
+  assert(queue.AddSuggestion(2, "cats", results, 2, "main.json"));
+  assert(queue.AddSuggestion(1, "cat", results + 1, 1, nullptr));
+
+  // Nothing is written until the main loop runs.
+  assert(Console::history.empty());
+  assert(TimerManager::instance.HasTimers());
+
+  TimerManager::instance.ProcessTimers(Clock::GetMilliseconds());
+  assert(queue.IsEmpty());
+  assert(!TimerManager::instance.HasTimers());
+  VerifyConsoleHistory("EV e: p\no: KAT\nd: main.json\nt: cat\n\n"
+                       "EV e: p\no: -S\nu: 1\nt: \"{^s}\"\n\n"
+                       "EV e: p\no: \"*\"\nu: 2\n\n"
+                       "EV e: s\nc: 2\nt: cats\no: [KAT/-S,KAT]\n"
+                       "d: main.json\n\n"
+                       "EV e: s\nc: 1\nt: cat\no: KAT\n\n");
+}
+TEST_END
+
+TEST_BEGIN("EngineEventQueue: Full queue drops records") {
+  EngineEventQueue &queue = EngineEventQueue::instance;
+  const size_t droppedCount = queue.GetStatistics().droppedCount;
+
+  char text[64];
+  memset(text, 'a', sizeof(text));
+  size_t addedCount = 0;
+  while (queue.AddPaperTape(StenoStroke("KAT"), 0, nullptr, text,
+                            sizeof(text))) {
+    ++addedCount;
+    assert(queue.GetUsedSize() <= JAVELIN_ENGINE_EVENT_QUEUE_SIZE);
+  }
+  assert(addedCount > 0);
+  assert(queue.GetStatistics().droppedCount == droppedCount + 1);
+  assert(queue.ShouldSkipSuggestions());
+
+  queue.Flush();
+  assert(queue.IsEmpty());
+  assert(!queue.ShouldSkipSuggestions());
+  assert(!TimerManager::instance.HasTimers());
+  Console::history.clear();
+
+  // Records wrap around the end of the buffer.
+  for (size_t i = 0; i < JAVELIN_ENGINE_EVENT_QUEUE_SIZE / 8; ++i) {
+    assert(queue.AddPaperTape(StenoStroke("KAT"), 0, nullptr, "cat", 3));
+    queue.Flush();
+    VerifyConsoleHistory("EV e: p\no: KAT\nt: cat\n\n");
+  }
+}
+TEST_END
+
+TEST_BEGIN("EngineEventQueue: Oversized records are written immediately") {
+  EngineEventQueue &queue = EngineEventQueue::instance;
+  const EngineEventQueue::Statistics statistics = queue.GetStatistics();
+  Console::history.clear();
+
+  static char text[JAVELIN_ENGINE_EVENT_QUEUE_SIZE + 1];
+  memset(text, 'a', JAVELIN_ENGINE_EVENT_QUEUE_SIZE);
+  text[JAVELIN_ENGINE_EVENT_QUEUE_SIZE] = '\0';
+
+  assert(queue.AddPaperTape(StenoStroke("KAT"), 0, nullptr, "cat", 3));
+  assert(queue.AddPaperTape(StenoStroke("-S"), 0, nullptr, text,
+                            JAVELIN_ENGINE_EVENT_QUEUE_SIZE));
+
+  // The queued record is written first.
+  assert(queue.IsEmpty());
+  assert(!TimerManager::instance.HasTimers());
+  assert(queue.GetStatistics().droppedCount == statistics.droppedCount);
+  assert(queue.GetStatistics().oversizedCount ==
+         statistics.oversizedCount + 1);
+
+  Console::history.push_back(0);
+  const char *history = &Console::history.front();
+  constexpr char PREFIX[] = "EV e: p\no: KAT\nt: cat\n\nEV e: p\no: -S\nt: ";
+  assert(Str::HasPrefix(history, PREFIX));
+  history += sizeof(PREFIX) - 1;
+  assert(memcmp(history, text, JAVELIN_ENGINE_EVENT_QUEUE_SIZE) == 0);
+  assert(Str::Eq(history + JAVELIN_ENGINE_EVENT_QUEUE_SIZE, "\n\n"));
+  Console::history.clear();
+}
+TEST_END
+
+//---------------------------------------------------------------------------
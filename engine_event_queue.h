@@ -0,0 +1,122 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "stroke.h"
+#include "timer_manager.h"
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+struct StenoReverseDictionaryResult;
+
+//---------------------------------------------------------------------------
+
+// The queue is held in RAM, so devices use a smaller buffer. Records larger
+// than half of the buffer are written immediately instead of being queued.
+#if !defined(JAVELIN_ENGINE_EVENT_QUEUE_SIZE)
+#if JAVELIN_PLATFORM_PICO_SDK || JAVELIN_PLATFORM_NRF5_SDK
+#define JAVELIN_ENGINE_EVENT_QUEUE_SIZE 1024
+#else
+#define JAVELIN_ENGINE_EVENT_QUEUE_SIZE 2048
+#endif
+#endif
+
+//---------------------------------------------------------------------------
+
+// Holds paper tape and suggestion events as compact binary records, so that
+// stroke processing does not wait on slow console transports (BLE, split
+// forwarding). Records are formatted and written from a timer, i.e. on the
+// next main loop iteration.
+//
+// Code that processes strokes without running TimerManager, e.g. tests and
+// host tools, must call Flush() itself, otherwise nothing is written and
+// events are dropped once the queue is full.
+//
+// Records that do not fit in the free space are dropped and counted, rather
+// than blocking. Records that could never fit are written synchronously,
+// after any queued records.
+class EngineEventQueue final : public TimerHandler {
+public:
+  struct Statistics {
+    size_t addedCount;
+    size_t droppedCount;
+
+    // Records written synchronously because they were too large to queue.
+    size_t oversizedCount;
+
+    // Suggestions that were not looked up because the queue was nearly
+    // full.
+    size_t skippedSuggestionCount;
+    size_t maxUsedSize;
+  };
+
+  // Each returns false if the record was dropped.
+  bool AddPaperTape(StenoStroke stroke, size_t undoCount,
+                    const char *dictionaryName, const char *text,
+                    size_t textLength);
+  bool AddPaperTapeUndo(StenoStroke stroke, size_t undoCount);
+
+  // dictionaryName is nullptr if it should not be shown.
+  bool AddSuggestion(size_t arrowPrefixCount, const char *text,
+                     const StenoReverseDictionaryResult *results,
+                     size_t resultCount, const char *dictionaryName);
+
+  // Suggestion lookups are expensive, so are skipped entirely when the
+  // result is likely to be dropped.
+  bool ShouldSkipSuggestions();
+
+  // Writes all queued events to the console.
+  void Flush();
+
+  size_t GetUsedSize() const { return writeOffset - readOffset; }
+  bool IsEmpty() const { return writeOffset == readOffset; }
+  const Statistics &GetStatistics() const { return statistics; }
+
+  void RegisterMetrics() const;
+
+  static EngineEventQueue instance;
+
+private:
+  static constexpr size_t BUFFER_SIZE = JAVELIN_ENGINE_EVENT_QUEUE_SIZE;
+  static_assert((BUFFER_SIZE & (BUFFER_SIZE - 1)) == 0);
+
+  // Suggestions are skipped with less than this much free space.
+  static constexpr size_t SUGGESTION_RESERVE_SIZE = BUFFER_SIZE / 4;
+
+  enum class RecordType : uint8_t {
+    // Fills the space to the end of the buffer when a record does not fit.
+    PADDING,
+    PAPER_TAPE,
+    PAPER_TAPE_UNDO,
+    SUGGESTION,
+  };
+
+  struct RecordHeader {
+    uint16_t size;
+    RecordType type;
+    uint8_t count;
+  };
+
+  bool isTimerActive;
+
+  // Offsets increase without wrapping, and are masked on access.
+  uint32_t readOffset;
+  uint32_t writeOffset;
+  Statistics statistics;
+
+  // Heap allocated record that is being written synchronously.
+  RecordHeader *oversizedRecord;
+
+  [[gnu::aligned(4)]] uint8_t buffer[BUFFER_SIZE];
+
+  // Returns nullptr, and counts a drop, if there is no space.
+  uint8_t *Allocate(RecordType type, size_t size, size_t count);
+  void Commit();
+
+  void PrintRecord(const RecordHeader *header) const;
+
+  void Run(intptr_t id) final;
+};
+
+//---------------------------------------------------------------------------
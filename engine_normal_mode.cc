@@ -3,7 +3,9 @@
 #include "clamp.h"
 #include "console.h"
 #include "engine.h"
+#include "engine_event_queue.h"
 #include "key.h"
+#include "latency_histogram.h"
 #include "processor/paper_tape.h"
 #include "segment.h"
 #include "state.h"
@@ -158,6 +160,7 @@ void StenoEngine::ProcessNormalModeStroke(StenoStroke stroke) {
   const size_t previousSourceStrokeCount = history.GetCount();
   const size_t startingStroke = GetStartingStrokeForNormalModeProcessing();
 
+  LatencyStopwatch latencyStopwatch;
   history.Add(stroke, state);
 
   const size_t conversionCount = history.GetCount() - startingStroke;
@@ -193,6 +196,7 @@ void StenoEngine::ProcessNormalModeStroke(StenoStroke stroke) {
   history.UpdateDefinitionBoundaries(
       history.GetCount() - conversionCount, nextSegments,
       nextConversionBuffer.segmentBuilder.GetStrokes(0));
+  latencyStopwatch.Lap(LatencyStage::SEGMENT_BUILD);
 
 #if ENABLE_PROFILE
   const uint32_t t2 = sysTick->ReadCycleCount();
@@ -258,6 +262,7 @@ void StenoEngine::ProcessNormalModeStroke(StenoStroke stroke) {
 #else
   nextConvertTextData.ConvertText();
 #endif
+  latencyStopwatch.Lap(LatencyStage::CONVERSION);
 
 #if ENABLE_PROFILE
   const uint32_t t4 = sysTick->ReadCycleCount();
@@ -284,8 +289,11 @@ void StenoEngine::ProcessNormalModeStroke(StenoStroke stroke) {
 
   bool printSuggestions = true;
   const bool canCombine =
-      emitter.Process(previousConversionBuffer.keyCodeBuffer,
-                      nextConversionBuffer.keyCodeBuffer);
+      batchText ? UpdateBatchText(previousConversionBuffer.keyCodeBuffer,
+                                  nextConversionBuffer.keyCodeBuffer)
+                : emitter.Process(previousConversionBuffer.keyCodeBuffer,
+                                  nextConversionBuffer.keyCodeBuffer);
+  latencyStopwatch.Lap(LatencyStage::EMISSION);
 
 #if ENABLE_PROFILE
   const uint32_t t5 = sysTick->ReadCycleCount();
@@ -309,6 +317,18 @@ void StenoEngine::ProcessNormalModeStroke(StenoStroke stroke) {
     }
   }
 
+  if (batchText) {
+    // Batch translation skips output and does not launch other modes, but
+    // keeps the same undo and reset behavior.
+    if (nextConversionBuffer.keyCodeBuffer.launchAddTranslation ||
+        nextConversionBuffer.keyCodeBuffer.launchConsole) {
+      history.SetBackNoCombineUndo();
+    } else if (nextConversionBuffer.keyCodeBuffer.doResetState) {
+      ResetState();
+    }
+    return;
+  }
+
   PrintTextLog(previousConversionBuffer.keyCodeBuffer,
                nextConversionBuffer.keyCodeBuffer);
   PrintPaperTape(stroke, previousSegments, nextSegments);
@@ -375,6 +395,10 @@ void StenoEngine::ProcessNormalModeUndo() {
 
   const size_t undoCount = history.GetUndoCount();
   if (undoCount == 0) {
+    if (batchText) {
+      RemoveBatchTextCharacters(1);
+      return;
+    }
     Key::Tap(KeyCode::BACKSPACE);
     PrintPaperTapeUndo(0);
     return;
@@ -515,6 +539,12 @@ void StenoEngine::ProcessNormalModeUndo() {
   DumpKeyCodeBufferElements();
 #endif
 
+  if (batchText) {
+    UpdateBatchText(previousConversionBuffer.keyCodeBuffer,
+                    nextConversionBuffer.keyCodeBuffer);
+    return;
+  }
+
   emitter.Process(previousConversionBuffer.keyCodeBuffer,
                   nextConversionBuffer.keyCodeBuffer);
 
@@ -642,7 +672,7 @@ void StenoEngine::PrintPaperTapeUndo(size_t undoCount) const {
     return;
   }
 
-  Console::Printf("EV e: p\no: %t\nu: %zu\n\n", &undoStroke, undoCount);
+  EngineEventQueue::instance.AddPaperTapeUndo(undoStroke, undoCount);
 }
 
 void StenoEngine::PrintPaperTape(StenoStroke stroke,
@@ -652,8 +682,6 @@ void StenoEngine::PrintPaperTape(StenoStroke stroke,
     return;
   }
 
-  Console::Printf("EV e: p\no: %t", &stroke);
-
   size_t undoCount = 0;
   const StenoSegment &segment = nextSegments.Back();
   const size_t startingStrokeIndex =
@@ -666,18 +694,13 @@ void StenoEngine::PrintPaperTape(StenoStroke stroke,
     ++undoCount;
   }
 
-  if (undoCount > 0) {
-    Console::Printf("\nu: %zu", undoCount);
-  }
-
   const StenoStroke *strokes =
       nextConversionBuffer.segmentBuilder.GetStrokes(startingStrokeIndex);
   const size_t length = segment.strokeLength;
   const StenoDictionary *provider =
       GetDictionary().GetDictionaryForOutline(strokes, length);
-  if (provider != nullptr) {
-    Console::Printf("\nd: %Y", provider->GetName());
-  }
+  const char *dictionaryName =
+      provider == nullptr ? nullptr : provider->GetName();
 
   // Unescape buffer commands.
   const char *lookup = segment.lookup.GetText();
@@ -691,10 +714,12 @@ void StenoEngine::PrintPaperTape(StenoStroke stroke,
       }
       writer.WriteByte(c);
     }
-    writer.WriteByte('\0');
-    Console::Printf("\nt: %Y\n\n", writer.GetBuffer());
+    EngineEventQueue::instance.AddPaperTape(stroke, undoCount, dictionaryName,
+                                            writer.GetBuffer(),
+                                            writer.GetCount());
   } else {
-    Console::Printf("\nt: %Y\n\n", lookup);
+    EngineEventQueue::instance.AddPaperTape(stroke, undoCount, dictionaryName,
+                                            lookup, Str::Length(lookup));
   }
 }
 
@@ -706,10 +731,13 @@ void StenoEngine::PrintSuggestions(const StenoSegmentList &previousSegments,
   const uint32_t t0 = sysTick->ReadCycleCount();
 #endif
 
-  if (!Console::IsEventEnabled(ConsoleEvent::SUGGESTION)) {
+  if (!Console::IsEventEnabled(ConsoleEvent::SUGGESTION) ||
+      EngineEventQueue::instance.ShouldSkipSuggestions()) {
     return;
   }
 
+  const LatencySentry latencySentry(LatencyStage::SUGGESTIONS);
+
   // Finger spelling suggestions.
   if (Str::IsFingerSpellingCommand(nextSegments.Back().lookup.GetText())) {
     if (state.isManualStateChange || state.joinNext) {
@@ -852,39 +880,22 @@ void StenoEngine::PrintSuggestion(const char *p, size_t arrowPrefixCount,
                                   size_t strokeThreshold) const {
   StenoReverseDictionaryLookup lookup(p, strokeThreshold);
   ReverseLookup(lookup);
-  switch (lookup.results.GetCount()) {
-  case 0:
+  if (lookup.results.IsEmpty()) {
     return;
+  }
 
-  case 1: {
-    const StenoReverseDictionaryResult &entry = lookup.results.Front();
-    Console::Printf("EV e: s\nc: %zu\nt: %Y\no: %O", arrowPrefixCount, p,
-                    entry.strokes, entry.length);
-
-    const StenoDictionary *dictionary = entry.dictionary;
+  const char *dictionaryName = nullptr;
+  if (lookup.results.GetCount() == 1 ||
+      lookup.AreAllResultsFromSameDictionary()) {
+    const StenoDictionary *dictionary = lookup.results.Front().dictionary;
     if (!dictionary->IsInternal()) {
-      Console::Printf("\nd: %Y", dictionary->GetName());
+      dictionaryName = dictionary->GetName();
     }
-    Console::Printf("\n\n");
-  } break;
-
-  default:
-    Console::Printf("EV e: s\nc: %zu\nt: %Y\no: [", arrowPrefixCount, p);
-    for (size_t i = 0; i < lookup.results.GetCount(); ++i) {
-      const StenoReverseDictionaryResult &entry = lookup.results[i];
-      Console::Printf(i == 0 ? "%O" : ",%O", entry.strokes, entry.length);
-    }
-    Console::Printf("]");
-
-    if (lookup.AreAllResultsFromSameDictionary()) {
-      const StenoDictionary *dictionary = lookup.results.Front().dictionary;
-      if (!dictionary->IsInternal()) {
-        Console::Printf("\nd: %Y", dictionary->GetName());
-      }
-    }
-    Console::Printf("\n\n");
-    break;
   }
+
+  EngineEventQueue::instance.AddSuggestion(
+      arrowPrefixCount, p, &lookup.results.Front(),
+      lookup.results.GetCount(), dictionaryName);
 }
 
 static bool ShouldShowSuggestions(const StenoSegmentList &segments,
@@ -1023,7 +1034,7 @@ void StenoEngine::PrintTextLog(
 
   if (backspaceCount == 0 && i < nextLength) {
     char *text = nextKeyCodeBuffer.ToString(i);
-    Console::Printf("EV e: t\nt: %Y\n\n", text);
+    Console::Printf<"EV e: t\nt: %Y\n\n">(text);
     free(text);
   } else {
     Console::Printf("EV e: t\nt: \"");
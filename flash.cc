@@ -4,7 +4,11 @@
 #include "base64.h"
 #include "button_script_manager.h"
 #include "console.h"
+#include "crc32.h"
 #include "hal/external_flash.h"
+#include "latency_histogram.h"
+#include "metrics.h"
+#include "str.h"
 #include "unicode.h"
 #include <assert.h>
 #include <string.h>
@@ -19,6 +23,15 @@ Flash Flash::instance;
 int flashEraseCount = 0;
 int flashWriteCount = 0;
 
+[[gnu::aligned(4096)]] static char flashWriteTestData[8 * 1024];
+
+[[gnu::weak]] Flash::MappedRegion Flash::GetMappedRegion() {
+  return {
+      .start = (const uint8_t *)flashWriteTestData,
+      .end = (const uint8_t *)flashWriteTestData + sizeof(flashWriteTestData),
+  };
+}
+
 [[gnu::weak]] void Flash::EraseBlockInternal(const void *target, size_t size) {
   assert((intptr_t(target) & (BLOCK_SIZE - 1)) == 0);
   assert((size & (BLOCK_SIZE - 1)) == 0);
@@ -88,6 +101,7 @@ void Flash::BeginWrite(const uint8_t *address) {
   target = address;
   writeStart = address;
   writeInProgress = true;
+  decoder.Reset();
 
   const void *baseAddress = AlignDown(address, WRITE_DATA_BUFFER_SIZE);
   const size_t offsetIntoPage = size_t(address) & (WRITE_DATA_BUFFER_SIZE - 1);
@@ -114,6 +128,36 @@ void Flash::AddData(const uint8_t *data, size_t length) {
   target += length;
 }
 
+// Copies earlier output, which is either still in the write buffer or
+// already in flash.
+bool Flash::AddMatch(size_t distance, size_t length) {
+  while (length != 0) {
+    const uint8_t *const bufferStart =
+        AlignDown(target, WRITE_DATA_BUFFER_SIZE);
+    const uint8_t *const source = target - distance;
+
+    uint8_t chunk[64];
+    size_t count = length < sizeof(chunk) ? length : sizeof(chunk);
+    if (count > distance) {
+      count = distance;
+    }
+
+    if (source < bufferStart) {
+      if (count > size_t(bufferStart - source)) {
+        count = bufferStart - source;
+      }
+      const ExternalFlashSentry sentry;
+      memcpy(chunk, source, count);
+    } else {
+      memcpy(chunk, buffer + (source - bufferStart), count);
+    }
+
+    AddData(chunk, count);
+    length -= count;
+  }
+  return true;
+}
+
 void Flash::WriteRemaining() {
   const size_t bytesToWrite = size_t(target) & (WRITE_DATA_BUFFER_SIZE - 1);
   if (bytesToWrite != 0) {
@@ -235,6 +279,7 @@ void Flash::EraseBlock(const void *target, const void *data, size_t size) {
 
 void Flash::WriteBlock(const void *const target, const void *const data,
                        const size_t size) {
+  const LatencySentry latencySentry(LatencyStage::FLASH_WRITE);
   EraseBlock(target, data, size);
 
   const uint8_t *const t = (const uint8_t *)target;
@@ -277,6 +322,12 @@ void Flash::WriteBlock(const void *const target, const void *const data,
   return false;
 }
 
+#if !RUN_TESTS
+[[gnu::weak]] Flash::MappedRegion Flash::GetMappedRegion() {
+  return {.start = nullptr, .end = nullptr};
+}
+#endif
+
 //---------------------------------------------------------------------------
 
 void Flash::BeginWriteBinding(void *context, const char *commandLine) {
@@ -325,15 +376,45 @@ void Flash::WriteBinding(void *context, const char *commandLine) {
     return;
   }
 
-  uint8_t decodeBuffer[256];
-  const size_t byteCount = Base64::Decode(decodeBuffer, (const uint8_t *)p);
+  const size_t byteCount =
+      Base64::Decode(Console::decodeBuffer, (const uint8_t *)p);
 
   if (byteCount == 0) {
     Console::Printf("ERR No data\n\n");
     return;
   }
 
-  instance.AddData(decodeBuffer, byteCount);
+  instance.AddData(Console::decodeBuffer, byteCount);
+
+  Console::SendOk();
+}
+
+// Writes LZ4 block format data, which may be split across any number of
+// commands.
+void Flash::WriteLz4Binding(void *context, const char *commandLine) {
+  const char *p = strchr(commandLine, ' ');
+  if (!p) {
+    Console::Printf("ERR Missing data\n\n");
+    return;
+  }
+
+  if (!IsUpdating()) {
+    Console::Printf("ERR No write in progress\n\n");
+    return;
+  }
+
+  const size_t byteCount =
+      Base64::Decode(Console::decodeBuffer, (const uint8_t *)p);
+
+  if (byteCount == 0) {
+    Console::Printf("ERR No data\n\n");
+    return;
+  }
+
+  if (!instance.decoder.Decode(instance, Console::decodeBuffer, byteCount)) {
+    Console::Printf("ERR Invalid compressed data\n\n");
+    return;
+  }
 
   Console::SendOk();
 }
@@ -348,21 +429,93 @@ void Flash::EndWriteBinding(void *context, const char *commandLine) {
       instance.IsScriptMemory(instance.writeStart, instance.target);
 
   instance.WriteRemaining();
-  Console::SendOk();
+  if (instance.decoder.IsComplete()) {
+    Console::SendOk();
+  } else {
+    Console::Printf("ERR Incomplete compressed data\n\n");
+  }
 
   if (isScriptMemory) {
     ButtonScriptManager::GetInstance().Reset();
   }
 }
 
+// Prints the Crc32 of each BLOCK_SIZE block, so that hosts can skip
+// uploading blocks that are unchanged.
+void Flash::GetBlockCrcsBinding(void *context, const char *commandLine) {
+  const char *p = strchr(commandLine, ' ');
+  if (!p) {
+    Console::Printf("ERR Missing address\n\n");
+    return;
+  }
+  ++p;
+
+  size_t addressValue = 0;
+  for (; *p && *p != ' '; ++p) {
+    const int hexValue = Unicode::GetHexValue(*p);
+    if (hexValue == -1) {
+      continue;
+    }
+    addressValue = 16 * addressValue + hexValue;
+  }
+
+  int count;
+  if (*p != ' ' || !Str::ParseInteger(&count, p + 1, false) || count < 0) {
+    Console::Printf("ERR Missing block count\n\n");
+    return;
+  }
+
+  const uint8_t *block = (const uint8_t *)addressValue;
+  if ((addressValue & (BLOCK_SIZE - 1)) != 0) {
+    Console::Printf("ERR Address is not block aligned\n\n");
+    return;
+  }
+
+  const MappedRegion region = GetMappedRegion();
+  if (block < region.start || block >= region.end) {
+    Console::Printf("ERR Address is outside of flash\n\n");
+    return;
+  }
+
+  const size_t availableCount = (region.end - block) / BLOCK_SIZE;
+  if (size_t(count) > availableCount) {
+    count = availableCount;
+  }
+
+  Console::Printf("[");
+  for (int i = 0; i < count; ++i) {
+    uint32_t crc;
+    {
+      const ExternalFlashSentry sentry;
+      crc = Crc32::Hash(block, BLOCK_SIZE);
+    }
+    Console::Printf(i == 0 ? "%u" : ",%u", crc);
+    block += BLOCK_SIZE;
+  }
+  Console::Printf("]\n\n");
+}
+
 void Flash::AddConsoleCommands(Console &console) {
   console.RegisterCommand("begin_write",
                           "Begins writing to the specified flash address",
                           &Flash::BeginWriteBinding, nullptr);
   console.RegisterCommand("write", "Writes base64 data to the address to flash",
                           &Flash::WriteBinding, nullptr);
+  console.RegisterCommand("write_lz4",
+                          "Writes base64 LZ4 compressed data to flash",
+                          &Flash::WriteLz4Binding, nullptr);
   console.RegisterCommand("end_write", "Completes writing to flash",
                           &Flash::EndWriteBinding, nullptr);
+  console.RegisterCommand("get_block_crcs",
+                          "Lists flash block CRC32s (address, count)",
+                          &Flash::GetBlockCrcsBinding, nullptr);
+
+  Metrics::Register("flash", "erasedBytes", MetricType::COUNTER,
+                    &instance.erasedBytes);
+  Metrics::Register("flash", "programmedBytes", MetricType::COUNTER,
+                    &instance.programmedBytes);
+  Metrics::Register("flash", "reprogrammedBytes", MetricType::COUNTER,
+                    &instance.reprogrammedBytes);
 }
 
 //---------------------------------------------------------------------------
@@ -381,8 +534,6 @@ void Flash::PrintInfo() {
 
 //---------------------------------------------------------------------------
 
-[[gnu::aligned(4096)]] static char flashWriteTestData[8 * 1024];
-
 static void RandomizeFlashWriteTestData() {
   for (size_t i = 0; i < sizeof(flashWriteTestData); ++i) {
     flashWriteTestData[i] = rand();
@@ -521,4 +672,98 @@ TEST_BEGIN("Flash: Write with FlashWriteMode::RESET") {
 }
 TEST_END
 
+static void RunFlashCommand(void (*handler)(void *, const char *),
+                            const char *line) {
+  handler(nullptr, line);
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(), "OK\n\n"));
+  Console::history.clear();
+}
+
+TEST_BEGIN("Flash: Write LZ4 compressed data") {
+  RandomizeFlashWriteTestData();
+
+  static constexpr char LITERALS[] = "0123456789abcdef";
+  static constexpr uint8_t COMPRESSED_DATA[] = {
+      // 16 literals, match of 5000 at distance 16.
+      0xff, 0x01, '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b',
+      'c', 'd', 'e', 'f', 0x10, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      136,
+      // Match of 100 at distance 4100, which has been written to flash.
+      0x0f, 0x04, 0x10, 81,
+      // Last literals.
+      0x40, 't', 'a', 'i', 'l'};
+
+  char expected[8192];
+  Mem::Copy(expected, flashWriteTestData, sizeof(expected));
+  char *p = expected + 16;
+  for (size_t i = 0; i < 5016; ++i) {
+    *p++ = LITERALS[i % 16];
+  }
+  for (size_t i = 0; i < 100; ++i, ++p) {
+    *p = p[-4100];
+  }
+  Mem::Copy(p, "tail", 4);
+
+  char line[64];
+  snprintf(line, sizeof(line), "begin_write %zx",
+           size_t(flashWriteTestData + 16));
+  RunFlashCommand(&Flash::BeginWriteBinding, line);
+
+  // Split mid-sequence to check decoding resumes across commands.
+  constexpr size_t SPLIT = 25;
+  BufferWriter writer;
+  writer.Write("write_lz4 ", 10);
+  writer.WriteBase64(COMPRESSED_DATA, SPLIT);
+  writer.WriteByte('\0');
+  RunFlashCommand(&Flash::WriteLz4Binding, writer.GetBuffer());
+
+  writer.Truncate(10);
+  writer.WriteBase64(COMPRESSED_DATA + SPLIT, sizeof(COMPRESSED_DATA) - SPLIT);
+  writer.WriteByte('\0');
+  RunFlashCommand(&Flash::WriteLz4Binding, writer.GetBuffer());
+
+  RunFlashCommand(&Flash::EndWriteBinding, "end_write");
+  assert(Mem::Eq(flashWriteTestData, expected, sizeof(expected)));
+}
+TEST_END
+
+TEST_BEGIN("Flash: Get block CRCs") {
+  RandomizeFlashWriteTestData();
+
+  char line[64];
+  snprintf(line, sizeof(line), "get_block_crcs %zx 2",
+           size_t(flashWriteTestData));
+  Flash::GetBlockCrcsBinding(nullptr, line);
+
+  char expected[64];
+  snprintf(expected, sizeof(expected), "[%u,%u]\n\n",
+           Crc32::Hash(flashWriteTestData, 4096),
+           Crc32::Hash(flashWriteTestData + 4096, 4096));
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(), expected));
+  Console::history.clear();
+
+  // Counts are clamped to the end of flash.
+  snprintf(line, sizeof(line), "get_block_crcs %zx 5",
+           size_t(flashWriteTestData + 4096));
+  Flash::GetBlockCrcsBinding(nullptr, line);
+
+  snprintf(expected, sizeof(expected), "[%u]\n\n",
+           Crc32::Hash(flashWriteTestData + 4096, 4096));
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(), expected));
+  Console::history.clear();
+
+  snprintf(line, sizeof(line), "get_block_crcs %zx 1",
+           size_t(flashWriteTestData + 8192));
+  Flash::GetBlockCrcsBinding(nullptr, line);
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(),
+                 "ERR Address is outside of flash\n\n"));
+  Console::history.clear();
+}
+TEST_END
+
 //---------------------------------------------------------------------------
@@ -1,6 +1,7 @@
 //---------------------------------------------------------------------------
 
 #pragma once
+#include "lz4_stream_decoder.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -32,7 +33,7 @@ enum class FlashWriteMode {
 
 //---------------------------------------------------------------------------
 
-class Flash {
+class Flash final : private Lz4StreamDecoder::Output {
 public:
   static bool IsUpdating() { return instance.writeInProgress; }
 
@@ -52,11 +53,22 @@ public:
 
   static constexpr size_t BLOCK_SIZE = 4096;
 
+  struct MappedRegion {
+    const uint8_t *start;
+    const uint8_t *end;
+  };
+
+  // Returns the memory mapped flash that get_block_crcs is allowed to read.
+  // Platforms provide this, the default region is empty.
+  static MappedRegion GetMappedRegion();
+
   static void PrintInfo();
 
   static void BeginWriteBinding(void *context, const char *commandLine);
   static void WriteBinding(void *context, const char *commandLine);
+  static void WriteLz4Binding(void *context, const char *commandLine);
   static void EndWriteBinding(void *context, const char *commandLine);
+  static void GetBlockCrcsBinding(void *context, const char *commandLine);
 
   static void AddConsoleCommands(Console &console);
 
@@ -80,6 +92,11 @@ private:
   void AddData(const uint8_t *data, size_t length);
   void WriteRemaining();
 
+  void AddLiterals(const uint8_t *data, size_t length) final {
+    AddData(data, length);
+  }
+  bool AddMatch(size_t distance, size_t length) final;
+
   static constexpr size_t WRITE_DATA_BUFFER_SIZE = BLOCK_SIZE;
 
   bool isLocked = false;
@@ -90,6 +107,7 @@ private:
 
   const uint8_t *target;
   const void *writeStart;
+  Lz4StreamDecoder decoder;
   uint8_t buffer[WRITE_DATA_BUFFER_SIZE];
 
   static Flash instance;
@@ -0,0 +1,168 @@
+//---------------------------------------------------------------------------
+
+#include "glyph_run_cache.h"
+#include "../../crc32.h"
+#include "../../utf8_pointer.h"
+#include <string.h>
+
+#if JAVELIN_GLYPH_RUN_CACHE_SIZE
+
+//---------------------------------------------------------------------------
+
+GlyphRunCache::CacheBlock GlyphRunCache::cache[CACHE_BLOCK_COUNT];
+
+//---------------------------------------------------------------------------
+
+bool GlyphRunCache::CacheEntry::IsEqual(uint32_t crc, FontId fontId,
+                                        const char *text,
+                                        size_t textLength) const {
+  if (crc != this->crc) [[likely]] {
+    return false;
+  }
+  return fontId == this->fontId && textLength == this->textLength &&
+         memcmp(text, this->text, textLength) == 0;
+}
+
+void GlyphRunCache::CacheEntry::Set(uint32_t crc, FontId fontId,
+                                    const char *text, size_t textLength) {
+  this->crc = crc;
+  this->fontId = fontId;
+  this->textLength = textLength;
+  memcpy(this->text, text, textLength);
+
+  // Positions follow Font::GetStringWidth, which only adds spacing after
+  // the first non-zero width.
+  const Font *font = Font::GetFont(fontId);
+  uint32_t x = 0;
+  size_t glyphCount = 0;
+  Utf8Pointer utf8p(text);
+  for (;;) {
+    const uint32_t c = *utf8p++;
+    if (c == 0) {
+      break;
+    }
+
+    if (x != 0) {
+      x += font->spacing;
+    }
+
+    const uint8_t *data = font->GetCharacterData(c);
+    if (data == nullptr) {
+      x += font->width;
+      continue;
+    }
+
+    const uint32_t width = font->GetCharacterWidth(c);
+    run.glyphs[glyphCount++] = {
+        .data = data,
+        .x = uint16_t(x),
+        .width = uint8_t(width),
+    };
+    x += width;
+  }
+  run.width = x;
+  run.glyphCount = glyphCount;
+}
+
+//---------------------------------------------------------------------------
+
+const GlyphRunCache::Run *GlyphRunCache::Lookup(FontId fontId,
+                                                const char *text) {
+  const size_t textLength = strlen(text);
+  if (textLength > MAX_TEXT_LENGTH) {
+    return nullptr;
+  }
+
+  const uint32_t crc = Crc32::Hash(text, textLength) ^ (uint32_t)fontId;
+  CacheBlock &block = cache[crc % CACHE_BLOCK_COUNT];
+  for (CacheEntry &entry : block.entries) {
+    if (entry.IsEqual(crc, fontId, text, textLength)) {
+      return &entry.run;
+    }
+  }
+
+  CacheEntry &entry =
+      block.entries[block.nextEntryIndex++ % CACHE_ASSOCIATIVITY];
+  entry.Set(crc, fontId, text, textLength);
+  return &entry.run;
+}
+
+void GlyphRunCache::Reset() { memset(cache, 0, sizeof(cache)); }
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "../../unit_test.h"
+
+//---------------------------------------------------------------------------
+
+#define DO_PROFILE_TEST 0
+
+//---------------------------------------------------------------------------
+
+TEST_BEGIN("GlyphRunCache: Runs match font metrics") {
+  GlyphRunCache::Reset();
+
+  const char *const TEXTS[] = {"", "WPM 123", "Layer: Gaming", "~|}"};
+  for (FontId fontId : {FontId::DEFAULT, FontId::LARGE, FontId::DOS}) {
+    const Font *font = Font::GetFont(fontId);
+    for (const char *text : TEXTS) {
+      const GlyphRunCache::Run *run = GlyphRunCache::Lookup(fontId, text);
+      assert(run != nullptr);
+      assert(run->width == font->GetStringWidth(text));
+
+      // Repeated lookups return the cached run.
+      assert(GlyphRunCache::Lookup(fontId, text) == run);
+    }
+  }
+
+  const GlyphRunCache::Run *run = GlyphRunCache::Lookup(FontId::DEFAULT, "Hi");
+  const Font *font = Font::GetFont(FontId::DEFAULT);
+  assert(run->glyphCount == 2);
+  assert(run->glyphs[0].data == font->GetCharacterData('H'));
+  assert(run->glyphs[1].data == font->GetCharacterData('i'));
+  assert(run->glyphs[1].x == font->GetCharacterWidth('H') + font->spacing);
+}
+TEST_END
+
+TEST_BEGIN("GlyphRunCache: Long text is not cached") {
+  assert(GlyphRunCache::Lookup(FontId::DEFAULT,
+                               "0123456789012345678901234567890") != nullptr);
+  assert(GlyphRunCache::Lookup(FontId::DEFAULT,
+                               "01234567890123456789012345678901") == nullptr);
+}
+TEST_END
+
+TEST_BEGIN("GlyphRunCache: Redraw benchmark") {
+#if DO_PROFILE_TEST
+  constexpr size_t ITERATION_COUNT = 10'000'000;
+#else
+  constexpr size_t ITERATION_COUNT = 10;
+#endif
+  const char *const TEXTS[] = {"123 WPM", "Gaming", "Battery 87%"};
+  const Font *font = Font::GetFont(FontId::DEFAULT);
+
+  uint32_t totalWidth = 0;
+  const ProfileTimer uncachedTimer;
+  for (size_t i = 0; i < ITERATION_COUNT; ++i) {
+    totalWidth += font->GetStringWidth(TEXTS[i % 3]);
+  }
+#if DO_PROFILE_TEST
+  uncachedTimer.PrintRate("GetStringWidth", ITERATION_COUNT, "strings");
+#endif
+
+  uint32_t cachedWidth = 0;
+  const ProfileTimer cachedTimer;
+  for (size_t i = 0; i < ITERATION_COUNT; ++i) {
+    cachedWidth += GlyphRunCache::Lookup(FontId::DEFAULT, TEXTS[i % 3])->width;
+  }
+#if DO_PROFILE_TEST
+  cachedTimer.PrintRate("GlyphRunCache::Lookup", ITERATION_COUNT, "strings");
+#endif
+  assert(cachedWidth == totalWidth);
+}
+TEST_END
+
+//---------------------------------------------------------------------------
+
+#endif // JAVELIN_GLYPH_RUN_CACHE_SIZE
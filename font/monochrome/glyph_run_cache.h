@@ -0,0 +1,83 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "font.h"
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+// Each entry uses about 290 bytes of RAM, so the cache is disabled on
+// devices unless the board config enables it.
+#if !defined(JAVELIN_GLYPH_RUN_CACHE_SIZE)
+#if JAVELIN_PLATFORM_PICO_SDK || JAVELIN_PLATFORM_NRF5_SDK
+#define JAVELIN_GLYPH_RUN_CACHE_SIZE 0
+#else
+#define JAVELIN_GLYPH_RUN_CACHE_SIZE 16
+#endif
+#endif
+
+//---------------------------------------------------------------------------
+
+// Caches the decoded glyphs and width of recently drawn strings, so that
+// scripts redrawing the same text each frame skip UTF-8 decoding and glyph
+// offset lookups.
+class GlyphRunCache {
+public:
+  static constexpr size_t MAX_TEXT_LENGTH = 31;
+
+  struct Glyph {
+    const uint8_t *data;
+    uint16_t x;
+    uint8_t width;
+  };
+
+  struct Run {
+    uint16_t width;
+    uint8_t glyphCount;
+    Glyph glyphs[MAX_TEXT_LENGTH];
+
+    const Glyph *begin() const { return glyphs; }
+    const Glyph *end() const { return glyphs + glyphCount; }
+  };
+
+  // Returns nullptr if text is longer than MAX_TEXT_LENGTH, or the cache is
+  // disabled. The result is valid until the next call.
+#if JAVELIN_GLYPH_RUN_CACHE_SIZE
+  static const Run *Lookup(FontId fontId, const char *text);
+  static void Reset();
+#else
+  static const Run *Lookup(FontId fontId, const char *text) { return nullptr; }
+  static void Reset() {}
+#endif
+
+#if JAVELIN_GLYPH_RUN_CACHE_SIZE
+private:
+  static constexpr size_t CACHE_ASSOCIATIVITY = 2;
+  static constexpr size_t CACHE_BLOCK_COUNT =
+      JAVELIN_GLYPH_RUN_CACHE_SIZE / CACHE_ASSOCIATIVITY;
+
+  struct CacheEntry {
+    uint32_t crc;
+    FontId fontId;
+    uint8_t textLength;
+    char text[MAX_TEXT_LENGTH];
+    Run run;
+
+    bool IsEqual(uint32_t crc, FontId fontId, const char *text,
+                 size_t textLength) const;
+    void Set(uint32_t crc, FontId fontId, const char *text,
+             size_t textLength);
+  };
+
+  struct CacheBlock {
+    // The index of the next CacheEntry to replace.
+    uint8_t nextEntryIndex;
+    CacheEntry entries[CACHE_ASSOCIATIVITY];
+  };
+
+  static CacheBlock cache[CACHE_BLOCK_COUNT];
+#endif
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,129 @@
+//---------------------------------------------------------------------------
+
+#include "display_dirty_region.h"
+
+//---------------------------------------------------------------------------
+
+DisplayDirtyRegion::Rect
+DisplayDirtyRegion::Rect::Union(const Rect &other) const {
+  return {
+      .left = left < other.left ? left : other.left,
+      .top = top < other.top ? top : other.top,
+      .right = right > other.right ? right : other.right,
+      .bottom = bottom > other.bottom ? bottom : other.bottom,
+  };
+}
+
+void DisplayDirtyRegion::Add(int left, int top, int right, int bottom) {
+  if (left >= right || top >= bottom) {
+    return;
+  }
+
+  Rect rect = {
+      .left = int16_t(left),
+      .top = int16_t(top),
+      .right = int16_t(right),
+      .bottom = int16_t(bottom),
+  };
+
+  // A merged rectangle can reach others, so restart after each merge.
+  for (size_t i = 0; i < count;) {
+    const Rect merged = rect.Union(rects[i]);
+    if (rect.Intersects(rects[i]) ||
+        merged.GetArea() <= rect.GetArea() + rects[i].GetArea()) {
+      rect = merged;
+      Remove(i);
+      i = 0;
+    } else {
+      ++i;
+    }
+  }
+
+  rects[count++] = rect;
+  if (count <= MAX_RECT_COUNT) {
+    return;
+  }
+
+  size_t bestI = 0;
+  size_t bestJ = 1;
+  size_t bestCost = (size_t)-1;
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t j = i + 1; j < count; ++j) {
+      const size_t cost = rects[i].Union(rects[j]).GetArea() -
+                          rects[i].GetArea() - rects[j].GetArea();
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestI = i;
+        bestJ = j;
+      }
+    }
+  }
+
+  const Rect merged = rects[bestI].Union(rects[bestJ]);
+  Remove(bestJ);
+  Remove(bestI);
+  Add(merged.left, merged.top, merged.right, merged.bottom);
+}
+
+size_t DisplayDirtyRegion::GetPixelCount() const {
+  size_t pixelCount = 0;
+  for (const Rect &rect : *this) {
+    pixelCount += rect.GetArea();
+  }
+  return pixelCount;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "../unit_test.h"
+
+//---------------------------------------------------------------------------
+
+TEST_BEGIN("DisplayDirtyRegion: Merges overlapping and adjacent rects") {
+  DisplayDirtyRegion region;
+  region.Add(0, 0, 10, 10);
+  region.Add(5, 5, 15, 15);
+  assert(region.GetCount() == 1);
+  assert(region.GetPixelCount() == 15 * 15);
+
+  region.Clear();
+  region.Add(0, 0, 10, 10);
+  region.Add(10, 0, 20, 10);
+  assert(region.GetCount() == 1);
+  assert(region.GetPixelCount() == 200);
+
+  // Contained rects add nothing.
+  region.Add(2, 2, 4, 4);
+  assert(region.GetCount() == 1);
+  assert(region.GetPixelCount() == 200);
+
+  // Empty rects are ignored.
+  region.Add(50, 50, 50, 60);
+  assert(region.GetCount() == 1);
+}
+TEST_END
+
+TEST_BEGIN("DisplayDirtyRegion: Keeps distant rects separate") {
+  DisplayDirtyRegion region;
+  region.Add(0, 0, 2, 2);
+  region.Add(100, 0, 102, 2);
+  region.Add(0, 50, 2, 52);
+  region.Add(100, 50, 102, 52);
+  assert(region.GetCount() == 4);
+  assert(region.GetPixelCount() == 16);
+
+  // A fifth rect forces the cheapest merge.
+  region.Add(50, 0, 52, 2);
+  assert(region.GetCount() == 4);
+  assert(region.GetPixelCount() == 2 * 52 + 12);
+
+  for (const DisplayDirtyRegion::Rect &a : region) {
+    for (const DisplayDirtyRegion::Rect &b : region) {
+      assert(&a == &b || !a.Intersects(b));
+    }
+  }
+}
+TEST_END
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,51 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+// Tracks the regions of a display that have changed since the last flush,
+// so that drivers only send those regions over SPI/I2C.
+//
+// Up to MAX_RECT_COUNT disjoint rectangles are kept. Rectangles that
+// intersect, or whose union costs no extra pixels, are merged. When full,
+// the pair whose union grows the least is merged.
+class DisplayDirtyRegion {
+public:
+  // right and bottom are exclusive.
+  struct Rect {
+    int16_t left;
+    int16_t top;
+    int16_t right;
+    int16_t bottom;
+
+    size_t GetArea() const { return size_t(right - left) * (bottom - top); }
+    bool Intersects(const Rect &other) const {
+      return left < other.right && other.left < right && top < other.bottom &&
+             other.top < bottom;
+    }
+    Rect Union(const Rect &other) const;
+  };
+
+  static constexpr size_t MAX_RECT_COUNT = 4;
+
+  void Clear() { count = 0; }
+  void Add(int left, int top, int right, int bottom);
+
+  bool IsEmpty() const { return count == 0; }
+  size_t GetCount() const { return count; }
+  size_t GetPixelCount() const;
+
+  const Rect *begin() const { return rects; }
+  const Rect *end() const { return rects + count; }
+
+private:
+  size_t count = 0;
+  Rect rects[MAX_RECT_COUNT + 1];
+
+  void Remove(size_t index) { rects[index] = rects[--count]; }
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,471 @@
+//---------------------------------------------------------------------------
+
+#include "display_framebuffer.h"
+
+#if USE_DISPLAY_FRAMEBUFFER
+
+#include "../font/monochrome/font.h"
+#include "../font/monochrome/glyph_run_cache.h"
+#include "../utf8_pointer.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+DisplayFramebuffer
+    DisplayFramebuffer::instances[JAVELIN_DISPLAY_FRAMEBUFFER_COUNT];
+
+//---------------------------------------------------------------------------
+
+void DisplayFramebuffer::Reset() {
+  drawColor = 1;
+  autoDrawId = 0;
+  isScreenOn = true;
+  contrast = 0;
+  dirtyRegion.Clear();
+  statistics = {};
+  memset(pixels, 0, sizeof(pixels));
+}
+
+size_t DisplayFramebuffer::Flush() {
+  const size_t pixelCount = dirtyRegion.GetPixelCount();
+  statistics.flushedPixelCount += pixelCount;
+  ++statistics.flushCount;
+  dirtyRegion.Clear();
+  return pixelCount;
+}
+
+void DisplayFramebuffer::SetPixel(ChangeBounds &bounds, int x, int y,
+                                  uint32_t color) {
+  if ((unsigned)x >= WIDTH || (unsigned)y >= HEIGHT) {
+    return;
+  }
+
+  ++statistics.drawnPixelCount;
+  uint32_t &pixel = pixels[y * WIDTH + x];
+  if (pixel == color) {
+    return;
+  }
+  pixel = color;
+
+  if (x < bounds.left) {
+    bounds.left = x;
+  }
+  if (x >= bounds.right) {
+    bounds.right = x + 1;
+  }
+  if (y < bounds.top) {
+    bounds.top = y;
+  }
+  if (y >= bounds.bottom) {
+    bounds.bottom = y + 1;
+  }
+}
+
+void DisplayFramebuffer::CommitChanges(const ChangeBounds &bounds) {
+  dirtyRegion.Add(bounds.left, bounds.top, bounds.right, bounds.bottom);
+}
+
+void DisplayFramebuffer::Clear() {
+  ChangeBounds bounds;
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) {
+      SetPixel(bounds, x, y, 0);
+    }
+  }
+  CommitChanges(bounds);
+}
+
+void DisplayFramebuffer::DrawLine(int x1, int y1, int x2, int y2) {
+  ChangeBounds bounds;
+
+  const int dx = x2 > x1 ? x2 - x1 : x1 - x2;
+  const int dy = y2 > y1 ? y1 - y2 : y2 - y1;
+  const int stepX = x1 < x2 ? 1 : -1;
+  const int stepY = y1 < y2 ? 1 : -1;
+  int error = dx + dy;
+
+  for (;;) {
+    SetPixel(bounds, x1, y1, drawColor);
+    if (x1 == x2 && y1 == y2) {
+      break;
+    }
+    const int error2 = 2 * error;
+    if (error2 >= dy) {
+      error += dy;
+      x1 += stepX;
+    }
+    if (error2 <= dx) {
+      error += dx;
+      y1 += stepY;
+    }
+  }
+
+  CommitChanges(bounds);
+}
+
+void DisplayFramebuffer::DrawRect(int left, int top, int right, int bottom) {
+  if (left < 0) {
+    left = 0;
+  }
+  if (top < 0) {
+    top = 0;
+  }
+  if (right > WIDTH) {
+    right = WIDTH;
+  }
+  if (bottom > HEIGHT) {
+    bottom = HEIGHT;
+  }
+
+  ChangeBounds bounds;
+  for (int y = top; y < bottom; ++y) {
+    for (int x = left; x < right; ++x) {
+      SetPixel(bounds, x, y, drawColor);
+    }
+  }
+  CommitChanges(bounds);
+}
+
+// Bitmaps are column major, with (height + 7) / 8 bytes per column and the
+// least significant bit at the top.
+void DisplayFramebuffer::DrawGlyph(ChangeBounds &bounds, int x, int y,
+                                   int width, int height,
+                                   const uint8_t *data) {
+  const int bytesPerColumn = (height + 7) >> 3;
+  for (int column = 0; column < width; ++column) {
+    const uint8_t *columnData = data + column * bytesPerColumn;
+    for (int row = 0; row < height; ++row) {
+      if (columnData[row >> 3] & (1 << (row & 7))) {
+        SetPixel(bounds, x + column, y + row, drawColor);
+      }
+    }
+  }
+}
+
+static uint32_t Expand5(uint32_t value) { return (value << 3) | (value >> 2); }
+
+void DisplayFramebuffer::DrawImage(int x, int y, int width, int height,
+                                   ImageFormat format, const uint8_t *data) {
+  ChangeBounds bounds;
+
+  if (format == ImageFormat::BITMAP) {
+    DrawGlyph(bounds, x, y, width, height, data);
+    CommitChanges(bounds);
+    return;
+  }
+
+  for (int row = 0; row < height; ++row) {
+    for (int column = 0; column < width; ++column) {
+      uint32_t color;
+      switch (format) {
+      case ImageFormat::LUMINANCE8:
+        color = *data++ * 0x010101;
+        break;
+
+      case ImageFormat::RGB332: {
+        const uint32_t v = *data++;
+        color = ((v >> 5) * 255 / 7) << 16 |
+                (((v >> 2) & 7) * 255 / 7) << 8 | (v & 3) * 85;
+      } break;
+
+      case ImageFormat::RGB565: {
+        const uint32_t v = data[0] | (data[1] << 8);
+        data += 2;
+        color = Expand5(v >> 11) << 16 |
+                (((v >> 5) & 0x3f) << 2 | ((v >> 9) & 3)) << 8 |
+                Expand5(v & 0x1f);
+      } break;
+
+      case ImageFormat::RGB888:
+        color = data[0] << 16 | data[1] << 8 | data[2];
+        data += 3;
+        break;
+
+      case ImageFormat::ALPHA8:
+        if (*data++ < 0x80) {
+          continue;
+        }
+        color = drawColor;
+        break;
+
+      case ImageFormat::ARGB1555: {
+        const uint32_t v = data[0] | (data[1] << 8);
+        data += 2;
+        if ((v & 0x8000) == 0) {
+          continue;
+        }
+        color = Expand5((v >> 10) & 0x1f) << 16 |
+                Expand5((v >> 5) & 0x1f) << 8 | Expand5(v & 0x1f);
+      } break;
+
+      case ImageFormat::RGBA8888: {
+        const uint8_t *p = data;
+        data += 4;
+        if (p[3] < 0x80) {
+          continue;
+        }
+        color = p[0] << 16 | p[1] << 8 | p[2];
+      } break;
+
+      default:
+        return;
+      }
+      SetPixel(bounds, x + column, y + row, color);
+    }
+  }
+
+  CommitChanges(bounds);
+}
+
+void DisplayFramebuffer::DrawLuminanceRange(int x, int y, int width,
+                                            int height, const uint8_t *data,
+                                            int min, int max) {
+  ChangeBounds bounds;
+  for (int row = 0; row < height; ++row) {
+    for (int column = 0; column < width; ++column) {
+      const int value = *data++;
+      if (min <= value && value < max) {
+        SetPixel(bounds, x + column, y + row, drawColor);
+      }
+    }
+  }
+  CommitChanges(bounds);
+}
+
+void DisplayFramebuffer::DrawText(int x, int y, FontId fontId,
+                                  TextAlignment alignment, const char *text) {
+  const Font *font = Font::GetFont(fontId);
+  const GlyphRunCache::Run *run = GlyphRunCache::Lookup(fontId, text);
+  const int width = run ? run->width : font->GetStringWidth(text);
+
+  switch (alignment) {
+  case TextAlignment::LEFT:
+    break;
+  case TextAlignment::MIDDLE:
+    x -= width >> 1;
+    break;
+  case TextAlignment::RIGHT:
+    x -= width;
+    break;
+  }
+  y -= font->baseline;
+
+  ChangeBounds bounds;
+  if (run) {
+    for (const GlyphRunCache::Glyph &glyph : *run) {
+      DrawGlyph(bounds, x + glyph.x, y, glyph.width, font->height,
+                glyph.data);
+    }
+    CommitChanges(bounds);
+    return;
+  }
+
+  Utf8Pointer utf8p(text);
+  for (;;) {
+    const uint32_t c = *utf8p++;
+    if (c == 0) {
+      break;
+    }
+
+    const uint8_t *data = font->GetCharacterData(c);
+    if (data == nullptr) {
+      x += font->width + font->spacing;
+      continue;
+    }
+
+    const int characterWidth = font->GetCharacterWidth(c);
+    DrawGlyph(bounds, x, y, characterWidth, font->height, data);
+    x += characterWidth + font->spacing;
+  }
+  CommitChanges(bounds);
+}
+
+//---------------------------------------------------------------------------
+
+void Display::Clear(int displayId) {
+  DisplayFramebuffer *framebuffer = DisplayFramebuffer::GetInstance(displayId);
+  if (framebuffer) {
+    framebuffer->Clear();
+  }
+}
+
+void Display::SetAutoDraw(int displayId, int autoDrawId) {
+  DisplayFramebuffer *framebuffer = DisplayFramebuffer::GetInstance(displayId);
+  if (framebuffer) {
+    framebuffer->autoDrawId = autoDrawId;
+  }
+}
+
+void Display::SetScreenOn(int displayId, bool on) {
+  DisplayFramebuffer *framebuffer = DisplayFramebuffer::GetInstance(displayId);
+  if (framebuffer) {
+    framebuffer->isScreenOn = on;
+  }
+}
+
+void Display::SetContrast(int displayId, int contrast) {
+  DisplayFramebuffer *framebuffer = DisplayFramebuffer::GetInstance(displayId);
+  if (framebuffer) {
+    framebuffer->contrast = contrast;
+  }
+}
+
+void Display::DrawPixel(int displayId, int x, int y) {
+  DisplayFramebuffer *framebuffer = DisplayFramebuffer::GetInstance(displayId);
+  if (framebuffer) {
+    DisplayFramebuffer::ChangeBounds bounds;
+    framebuffer->SetPixel(bounds, x, y, framebuffer->drawColor);
+    framebuffer->CommitChanges(bounds);
+  }
+}
+
+void Display::DrawLine(int displayId, int x1, int y1, int x2, int y2) {
+  DisplayFramebuffer *framebuffer = DisplayFramebuffer::GetInstance(displayId);
+  if (framebuffer) {
+    framebuffer->DrawLine(x1, y1, x2, y2);
+  }
+}
+
+void Display::DrawImage(int displayId, int x, int y, int width, int height,
+                        ImageFormat format, const uint8_t *data) {
+  DisplayFramebuffer *framebuffer = DisplayFramebuffer::GetInstance(displayId);
+  if (framebuffer) {
+    framebuffer->DrawImage(x, y, width, height, format, data);
+  }
+}
+
+void Display::DrawLuminanceRange(int displayId, int x, int y, int width,
+                                 int height, const uint8_t *data, int min,
+                                 int max) {
+  DisplayFramebuffer *framebuffer = DisplayFramebuffer::GetInstance(displayId);
+  if (framebuffer) {
+    framebuffer->DrawLuminanceRange(x, y, width, height, data, min, max);
+  }
+}
+
+void Display::DrawText(int displayId, int x, int y, FontId fontId,
+                       TextAlignment alignment, const char *text) {
+  DisplayFramebuffer *framebuffer = DisplayFramebuffer::GetInstance(displayId);
+  if (framebuffer) {
+    framebuffer->DrawText(x, y, fontId, alignment, text);
+  }
+}
+
+void Display::DrawRect(int displayId, int left, int top, int right,
+                       int bottom) {
+  DisplayFramebuffer *framebuffer = DisplayFramebuffer::GetInstance(displayId);
+  if (framebuffer) {
+    framebuffer->DrawRect(left, top, right, bottom);
+  }
+}
+
+void Display::SetDrawColor(int displayId, int color) {
+  DisplayFramebuffer *framebuffer = DisplayFramebuffer::GetInstance(displayId);
+  if (framebuffer) {
+    framebuffer->drawColor = color;
+  }
+}
+
+void Display::DrawEffect(int displayId, int effectId, int parameter) {}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "../unit_test.h"
+
+//---------------------------------------------------------------------------
+
+TEST_BEGIN("DisplayFramebuffer: Only changed pixels are flushed") {
+  DisplayFramebuffer &framebuffer = *DisplayFramebuffer::GetInstance(0);
+  framebuffer.Reset();
+
+  Display::DrawRect(0, 10, 10, 20, 15);
+  assert(framebuffer.GetPixel(10, 10) == 1);
+  assert(framebuffer.GetPixel(19, 14) == 1);
+  assert(framebuffer.GetPixel(20, 14) == 0);
+  assert(framebuffer.Flush() == 50);
+
+  // Redrawing identical content leaves nothing to flush.
+  Display::DrawRect(0, 10, 10, 20, 15);
+  assert(framebuffer.Flush() == 0);
+
+  Display::DrawLine(0, 0, 0, 7, 7);
+  assert(framebuffer.GetPixel(3, 3) == 1);
+  assert(framebuffer.Flush() == 64);
+
+  const DisplayFramebuffer::Statistics &statistics =
+      framebuffer.GetStatistics();
+  assert(statistics.drawnPixelCount == 50 + 50 + 8);
+  assert(statistics.flushedPixelCount == 50 + 64);
+  assert(statistics.flushCount == 3);
+
+  Display::Clear(0);
+  assert(framebuffer.GetDirtyRegion().GetCount() == 1);
+  assert(framebuffer.Flush() == 20 * 15);
+}
+TEST_END
+
+TEST_BEGIN("DisplayFramebuffer: Draws text and images") {
+  DisplayFramebuffer &framebuffer = *DisplayFramebuffer::GetInstance(1);
+  framebuffer.Reset();
+
+  const Font *font = Font::GetFont(FontId::DEFAULT);
+  const int width = font->GetStringWidth("Hi");
+  Display::DrawText(1, 64, font->baseline, FontId::DEFAULT,
+                    TextAlignment::MIDDLE, "Hi");
+
+  const DisplayDirtyRegion &region = framebuffer.GetDirtyRegion();
+  assert(region.GetCount() == 1);
+  const DisplayDirtyRegion::Rect &rect = *region.begin();
+  assert(rect.left >= 64 - width / 2 && rect.right <= 64 - width / 2 + width);
+  assert(rect.top >= 0 && rect.bottom <= font->height);
+  framebuffer.Flush();
+
+  static constexpr uint8_t RGB888[] = {0xff, 0, 0, 0, 0x80, 0xff};
+  Display::DrawImage(1, 100, 50, 2, 1, ImageFormat::RGB888, RGB888);
+  assert(framebuffer.GetPixel(100, 50) == 0xff0000);
+  assert(framebuffer.GetPixel(101, 50) == 0x0080ff);
+
+  static constexpr uint8_t RGB565[] = {0x1f, 0xf8};
+  Display::DrawImage(1, 0, 63, 1, 1, ImageFormat::RGB565, RGB565);
+  assert(framebuffer.GetPixel(0, 63) == 0xff00ff);
+  assert(framebuffer.GetDirtyRegion().GetPixelCount() == 3);
+}
+TEST_END
+
+TEST_BEGIN("DisplayFramebuffer: Missing glyphs advance by the font width") {
+  // Missing glyphs take up space as they do in Font::GetStringWidth, so
+  // aligned text is positioned correctly. The long text is not cached.
+  const Font *font = Font::GetFont(FontId::MEDIUM_DIGITS);
+  const int x = 2 * (font->width + font->spacing);
+  const char *const TEXTS[] = {
+      "1x2",
+      "1x2xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx",
+  };
+
+  DisplayFramebuffer &framebuffer = *DisplayFramebuffer::GetInstance(0);
+  uint32_t expected[10 * 16];
+  framebuffer.Reset();
+  Display::DrawText(0, x, font->baseline, FontId::MEDIUM_DIGITS,
+                    TextAlignment::LEFT, "2");
+  for (int i = 0; i < 10 * 16; ++i) {
+    expected[i] = framebuffer.GetPixel(x + i % 10, i / 10);
+  }
+  assert(framebuffer.GetDirtyRegion().GetPixelCount() != 0);
+
+  for (const char *text : TEXTS) {
+    framebuffer.Reset();
+    Display::DrawText(0, 0, font->baseline, FontId::MEDIUM_DIGITS,
+                      TextAlignment::LEFT, text);
+    for (int i = 0; i < 10 * 16; ++i) {
+      assert(framebuffer.GetPixel(x + i % 10, i / 10) == expected[i]);
+    }
+  }
+}
+TEST_END
+
+//---------------------------------------------------------------------------
+
+#endif // USE_DISPLAY_FRAMEBUFFER
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,108 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "display.h"
+#include "display_dirty_region.h"
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+#if !JAVELIN_PLATFORM_PICO_SDK && !JAVELIN_PLATFORM_NRF5_SDK
+#define USE_DISPLAY_FRAMEBUFFER 1
+#else
+#define USE_DISPLAY_FRAMEBUFFER 0
+#endif
+
+#if USE_DISPLAY_FRAMEBUFFER
+
+#if !defined(JAVELIN_DISPLAY_FRAMEBUFFER_COUNT)
+#define JAVELIN_DISPLAY_FRAMEBUFFER_COUNT 2
+#endif
+
+#if !defined(JAVELIN_DISPLAY_FRAMEBUFFER_WIDTH)
+#define JAVELIN_DISPLAY_FRAMEBUFFER_WIDTH 128
+#endif
+
+#if !defined(JAVELIN_DISPLAY_FRAMEBUFFER_HEIGHT)
+#define JAVELIN_DISPLAY_FRAMEBUFFER_HEIGHT 64
+#endif
+
+//---------------------------------------------------------------------------
+
+// Host implementation of Display, so that script display code can be tested
+// and profiled off-device.
+//
+// Pixels hold the draw color, which is 0/1 for monochrome scripts and
+// 0xRRGGBB otherwise. Only pixels that change value are marked dirty.
+class DisplayFramebuffer {
+public:
+  static constexpr int WIDTH = JAVELIN_DISPLAY_FRAMEBUFFER_WIDTH;
+  static constexpr int HEIGHT = JAVELIN_DISPLAY_FRAMEBUFFER_HEIGHT;
+
+  struct Statistics {
+    // Pixels written by draw calls, whether or not they changed.
+    size_t drawnPixelCount;
+
+    // Pixels in the dirty region at each flush.
+    size_t flushedPixelCount;
+    size_t flushCount;
+  };
+
+  void Reset();
+
+  uint32_t GetPixel(int x, int y) const { return pixels[y * WIDTH + x]; }
+  const DisplayDirtyRegion &GetDirtyRegion() const { return dirtyRegion; }
+  const Statistics &GetStatistics() const { return statistics; }
+
+  // Records the dirty region as sent, and returns its pixel count.
+  size_t Flush();
+
+  static DisplayFramebuffer *GetInstance(int displayId) {
+    return (unsigned)displayId < JAVELIN_DISPLAY_FRAMEBUFFER_COUNT
+               ? &instances[displayId]
+               : nullptr;
+  }
+
+private:
+  // Bounds of pixels changed by the current draw call.
+  struct ChangeBounds {
+    int left = WIDTH;
+    int top = HEIGHT;
+    int right = 0;
+    int bottom = 0;
+  };
+
+  uint32_t drawColor = 1;
+  int autoDrawId = 0;
+  bool isScreenOn = true;
+  uint8_t contrast = 0;
+  DisplayDirtyRegion dirtyRegion;
+  Statistics statistics = {};
+  uint32_t pixels[WIDTH * HEIGHT];
+
+  static DisplayFramebuffer instances[JAVELIN_DISPLAY_FRAMEBUFFER_COUNT];
+
+  void SetPixel(ChangeBounds &bounds, int x, int y, uint32_t color);
+  void CommitChanges(const ChangeBounds &bounds);
+
+  void Clear();
+  void DrawLine(int x1, int y1, int x2, int y2);
+  void DrawRect(int left, int top, int right, int bottom);
+  void DrawImage(int x, int y, int width, int height, ImageFormat format,
+                 const uint8_t *data);
+  void DrawLuminanceRange(int x, int y, int width, int height,
+                          const uint8_t *data, int min, int max);
+  void DrawText(int x, int y, FontId fontId, TextAlignment alignment,
+                const char *text);
+  void DrawGlyph(ChangeBounds &bounds, int x, int y, int width, int height,
+                 const uint8_t *data);
+
+  friend class Display;
+};
+
+//---------------------------------------------------------------------------
+
+#endif // USE_DISPLAY_FRAMEBUFFER
+
+//---------------------------------------------------------------------------
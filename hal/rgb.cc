@@ -2,11 +2,67 @@
 
 #include "rgb.h"
 #include "../base64.h"
+#include "../bit.h"
 #include "../console.h"
 #include "../str.h"
 
 //---------------------------------------------------------------------------
 
+bool Rgb::isInFrame = false;
+bool Rgb::isGammaCorrectionEnabled = false;
+uint32_t Rgb::frameStartTime;
+size_t Rgb::outOfRangeCount = 0;
+uint32_t Rgb::frameMask[FRAME_MASK_COUNT];
+uint32_t Rgb::frame[JAVELIN_RGB_FRAME_SIZE];
+
+constexpr uint8_t Rgb::GAMMA_TABLE[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7,
+    7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 11, 11, 11, 12, 12, 13, 13, 13, 14, 14, 15,
+    15, 16, 16, 17, 17, 18, 18, 19, 19, 20, 20, 21, 22, 22, 23, 23, 24, 25, 25,
+    26, 26, 27, 28, 28, 29, 30, 30, 31, 32, 33, 33, 34, 35, 35, 36, 37, 38, 39,
+    39, 40, 41, 42, 43, 43, 44, 45, 46, 47, 48, 49, 49, 50, 51, 52, 53, 54, 55,
+    56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71, 73, 74, 75,
+    76, 77, 78, 79, 81, 82, 83, 84, 85, 87, 88, 89, 90, 91, 93, 94, 95, 97, 98,
+    99, 100, 102, 103, 105, 106, 107, 109, 110, 111, 113, 114, 116, 117, 119,
+    120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135, 137, 138, 140, 141,
+    143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161, 163, 165, 166,
+    168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190, 192, 194,
+    196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221, 223,
+    225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
+
+// Fully saturated colors at full value for 6 * 256 hue steps, with the
+// same ordering as ConvertHsvToRgb.
+struct HueTable {
+  static constexpr size_t STEP_COUNT = 6 * 256;
+
+  constexpr HueTable() : colors() {
+    for (size_t i = 0; i < STEP_COUNT; ++i) {
+      const uint32_t ramp = i & 0xff;
+      const uint32_t primary = (i & 0x100) ? 255 - ramp : 255;
+      const uint32_t secondary = (i & 0x100) ? 255 : ramp;
+      switch (i >> 9) {
+      case 0:
+        colors[i] = primary << 16 | secondary << 8;
+        break;
+      case 1:
+        colors[i] = primary << 8 | secondary;
+        break;
+      case 2:
+        colors[i] = primary | secondary << 16;
+        break;
+      }
+    }
+  }
+
+  uint32_t colors[STEP_COUNT];
+};
+
+static constexpr HueTable HUE_TABLE;
+
+//---------------------------------------------------------------------------
+
 void Rgb::SetRgb_Binding(void *context, const char *commandLine) {
   const char *p = strchr(commandLine, ' ');
   if (!p) {
@@ -42,10 +98,9 @@ void Rgb::SetRgb_Binding(void *context, const char *commandLine) {
 }
 
 void Rgb::SetRgbBase64(size_t startRgbId, const uint8_t *p) {
-  uint8_t buffer[256];
-  const size_t byteCount = Base64::Decode(buffer, (uint8_t *)p);
+  const size_t byteCount = Base64::Decode(Console::decodeBuffer, p);
   const size_t rgbCount = byteCount / 3;
-  const uint8_t *rgb = buffer;
+  const uint8_t *rgb = Console::decodeBuffer;
   for (int i = 0; i < rgbCount; ++i, rgb += 3) {
     SetRgb(startRgbId + i, rgb[0], rgb[1], rgb[2]);
   }
@@ -57,6 +112,109 @@ void Rgb::SetHsv(size_t id, int h, int s, int v) {
   SetRgb(id, r, g, b);
 }
 
+uint32_t Rgb::ConvertPackedHsvToRgb(uint32_t hsv) {
+  const uint32_t v = hsv & 0xff;
+  uint32_t s = (hsv >> 8) & 0xff;
+  s += s >> 7;
+
+  uint32_t c = v * s >> 8;
+  const uint32_t m = v - c;
+  c += c >> 7;
+
+  // Scale all three channels with two multiplies.
+  const uint32_t hue = HUE_TABLE.colors[(hsv >> 16) * 3 >> 7];
+  const uint32_t redBlue = ((hue & 0xff00ff) * c >> 8) & 0xff00ff;
+  const uint32_t green = ((hue & 0xff00) * c >> 8) & 0xff00;
+  return redBlue + green + m * 0x010101;
+}
+
+void Rgb::BeginFrame(uint32_t time) {
+  isInFrame = true;
+  frameStartTime = time;
+}
+
+void Rgb::CommitExpiredFrame(uint32_t time) {
+  if (isInFrame && GetFrameTimeoutDelay(time) <= 0) {
+    CommitFrame();
+  }
+}
+
+int Rgb::GetFrameTimeoutDelay(uint32_t time) {
+  if (!isInFrame) {
+    return 0;
+  }
+  return int(frameStartTime + JAVELIN_RGB_FRAME_TIMEOUT - time);
+}
+
+void Rgb::CommitFrame() {
+  isInFrame = false;
+  if (outOfRangeCount != 0) {
+    Console::Printf("ERR %zu RGB ids were outside of the frame\n\n",
+                    outOfRangeCount);
+    outOfRangeCount = 0;
+  }
+  for (size_t i = 0; i < FRAME_MASK_COUNT; ++i) {
+    uint32_t mask = frameMask[i];
+    frameMask[i] = 0;
+    while (mask) {
+      const size_t id = 32 * i + Bit<4>::CountTrailingZeros(mask);
+      mask &= mask - 1;
+
+      const uint32_t rgb = frame[id];
+      int r = (rgb >> 16) & 0xff;
+      int g = (rgb >> 8) & 0xff;
+      int b = rgb & 0xff;
+      if (isGammaCorrectionEnabled) {
+        r = GAMMA_TABLE[r];
+        g = GAMMA_TABLE[g];
+        b = GAMMA_TABLE[b];
+      }
+      SetRgb(id, r, g, b);
+    }
+  }
+}
+
+void Rgb::SetFrameRgb(size_t id, uint32_t rgb) {
+  if (id >= JAVELIN_RGB_FRAME_SIZE) {
+    ++outOfRangeCount;
+    return;
+  }
+  frame[id] = rgb;
+  frameMask[id / 32] |= 1 << (id & 31);
+}
+
+// Returns how many of the ids from startId are inside the frame, so that
+// data past the frame is never read.
+size_t Rgb::ClampFrameCount(size_t startId, size_t count) {
+  const size_t available =
+      startId < JAVELIN_RGB_FRAME_SIZE ? JAVELIN_RGB_FRAME_SIZE - startId : 0;
+  if (count <= available) {
+    return count;
+  }
+  outOfRangeCount += count - available;
+  return available;
+}
+
+void Rgb::SetFrameRgb(size_t startId, const Uint32 *rgb, size_t count) {
+  count = ClampFrameCount(startId, count);
+  for (size_t i = 0; i < count; ++i) {
+    SetFrameRgb(startId + i, rgb[i].ToUint32() & 0xffffff);
+  }
+  if (!isInFrame) {
+    CommitFrame();
+  }
+}
+
+void Rgb::SetFrameHsv(size_t startId, const Uint32 *hsv, size_t count) {
+  count = ClampFrameCount(startId, count);
+  for (size_t i = 0; i < count; ++i) {
+    SetFrameRgb(startId + i, ConvertPackedHsvToRgb(hsv[i].ToUint32()));
+  }
+  if (!isInFrame) {
+    CommitFrame();
+  }
+}
+
 void Rgb::ConvertHsvToRgb(int &r, int &g, int &b, int h, int s, int v) {
   h = 6 * (h & 0xffff);
 
@@ -116,3 +274,127 @@ void Rgb::AddConsoleCommands(Console &console) {
 #endif
 
 //---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "../unit_test.h"
+
+//---------------------------------------------------------------------------
+
+#define DO_PROFILE_TEST 0
+
+//---------------------------------------------------------------------------
+
+static bool IsNear(int a, int b) { return a - b <= 2 && b - a <= 2; }
+
+TEST_BEGIN("Rgb: Packed HSV conversion matches ConvertHsvToRgb") {
+  for (int h = 0; h < 0x10000; h += 97) {
+    for (int s = 0; s < 256; s += 15) {
+      for (int v = 0; v < 256; v += 15) {
+        int r, g, b;
+        Rgb::ConvertHsvToRgb(r, g, b, h, s + (s >> 7), v);
+        const uint32_t rgb = Rgb::ConvertPackedHsvToRgb(h << 16 | s << 8 | v);
+        assert(IsNear(r, rgb >> 16));
+        assert(IsNear(g, (rgb >> 8) & 0xff));
+        assert(IsNear(b, rgb & 0xff));
+      }
+    }
+  }
+
+  assert(Rgb::ConvertPackedHsvToRgb(0x0000ffff) == 0xff0000);
+  assert(Rgb::ConvertPackedHsvToRgb(0x5555ffff) == 0x00ff00);
+  assert(Rgb::ConvertPackedHsvToRgb(0x1234007f) == 0x7f7f7f);
+}
+TEST_END
+
+TEST_BEGIN("Rgb: Frames buffer bulk updates") {
+  const Uint32 rgb[] = {0x123456, 0xff000000};
+  Rgb::BeginFrame(0);
+  Rgb::SetFrameRgb(3, rgb, 2);
+  assert(Rgb::IsInFrame());
+  assert(Rgb::GetFrameRgb(3) == 0x123456);
+  assert(Rgb::GetFrameRgb(4) == 0);
+
+  const Uint32 hsv[] = {0x0000ffff};
+  Rgb::SetFrameHsv(JAVELIN_RGB_FRAME_SIZE - 1, hsv, 2);
+  assert(Rgb::GetFrameRgb(JAVELIN_RGB_FRAME_SIZE - 1) == 0xff0000);
+
+  Rgb::CommitFrame();
+  assert(!Rgb::IsInFrame());
+
+  // The second HSV value was outside of the frame.
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(),
+                 "ERR 1 RGB ids were outside of the frame\n\n"));
+  Console::history.clear();
+}
+TEST_END
+
+TEST_BEGIN("Rgb: Bulk updates are clamped to the frame") {
+  const Uint32 rgb[] = {0x010203, 0x040506};
+  Rgb::BeginFrame(0);
+
+  // Only the first two values are read.
+  Rgb::SetFrameRgb(JAVELIN_RGB_FRAME_SIZE - 2, rgb, 1000);
+  assert(Rgb::GetFrameRgb(JAVELIN_RGB_FRAME_SIZE - 2) == 0x010203);
+  assert(Rgb::GetFrameRgb(JAVELIN_RGB_FRAME_SIZE - 1) == 0x040506);
+
+  // Nothing is read when the start is outside of the frame.
+  Rgb::SetFrameHsv(JAVELIN_RGB_FRAME_SIZE, nullptr, 5);
+  Rgb::SetFrameRgb(SIZE_MAX, nullptr, 3);
+  Rgb::CommitFrame();
+
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(),
+                 "ERR 1006 RGB ids were outside of the frame\n\n"));
+  Console::history.clear();
+}
+TEST_END
+
+TEST_BEGIN("Rgb: Uncommitted frames time out") {
+  Rgb::BeginFrame(1000);
+  assert(Rgb::GetFrameTimeoutDelay(1000) == JAVELIN_RGB_FRAME_TIMEOUT);
+
+  Rgb::CommitExpiredFrame(1000 + JAVELIN_RGB_FRAME_TIMEOUT - 1);
+  assert(Rgb::IsInFrame());
+
+  Rgb::CommitExpiredFrame(1000 + JAVELIN_RGB_FRAME_TIMEOUT);
+  assert(!Rgb::IsInFrame());
+  assert(Rgb::GetFrameTimeoutDelay(2000) == 0);
+}
+TEST_END
+
+TEST_BEGIN("Rgb: Frame update benchmark") {
+#if DO_PROFILE_TEST
+  constexpr size_t FRAME_COUNT = 100'000;
+#else
+  constexpr size_t FRAME_COUNT = 2;
+#endif
+  constexpr size_t LED_COUNT = 64;
+
+  Uint32 hsv[LED_COUNT];
+  const ProfileTimer perLedTimer;
+  for (size_t frame = 0; frame < FRAME_COUNT; ++frame) {
+    for (size_t i = 0; i < LED_COUNT; ++i) {
+      Rgb::SetHsv(i, (frame * 64 + i * 1024) & 0xffff, 256, 128);
+    }
+  }
+#if DO_PROFILE_TEST
+  perLedTimer.PrintRate("Rgb::SetHsv", FRAME_COUNT * LED_COUNT, "LEDs");
+#endif
+
+  const ProfileTimer frameTimer;
+  for (size_t frame = 0; frame < FRAME_COUNT; ++frame) {
+    for (size_t i = 0; i < LED_COUNT; ++i) {
+      hsv[i] = ((frame * 64 + i * 1024) & 0xffff) << 16 | 0xff80;
+    }
+    Rgb::BeginFrame(0);
+    Rgb::SetFrameHsv(0, hsv, LED_COUNT);
+    Rgb::CommitFrame();
+  }
+#if DO_PROFILE_TEST
+  frameTimer.PrintRate("Rgb::SetFrameHsv", FRAME_COUNT * LED_COUNT, "LEDs");
+#endif
+}
+TEST_END
+
+//---------------------------------------------------------------------------
@@ -1,12 +1,26 @@
 //---------------------------------------------------------------------------
 
 #pragma once
+#include "../uint32.h"
 #include <stddef.h>
 #include <stdint.h>
 #include JAVELIN_BOARD_CONFIG
 
 //---------------------------------------------------------------------------
 
+#if !defined(JAVELIN_RGB_FRAME_SIZE)
+#define JAVELIN_RGB_FRAME_SIZE 128
+#endif
+
+// Frames that are not committed within this many milliseconds are committed
+// by CommitExpiredFrame(), so that a script that never commits cannot freeze
+// the LEDs.
+#if !defined(JAVELIN_RGB_FRAME_TIMEOUT)
+#define JAVELIN_RGB_FRAME_TIMEOUT 100
+#endif
+
+//---------------------------------------------------------------------------
+
 class Console;
 
 //---------------------------------------------------------------------------
@@ -22,6 +36,33 @@ public:
 
   static void ConvertHsvToRgb(int &r, int &g, int &b, int h, int s, int v);
 
+  // Table based conversion of packed 0xHHHHSSVV to 0xRRGGBB, where
+  // saturation is 0-255. Results are within 2 of ConvertHsvToRgb.
+  static uint32_t ConvertPackedHsvToRgb(uint32_t hsv);
+
+  // Colors set between BeginFrame() and CommitFrame() are buffered, and
+  // CommitFrame() passes each LED that was set to SetRgb() once.
+  // Bulk sets outside of a frame are committed immediately.
+  // Ids of JAVELIN_RGB_FRAME_SIZE or more are reported by CommitFrame().
+  static void BeginFrame(uint32_t time);
+  static void CommitFrame();
+  static bool IsInFrame() { return isInFrame; }
+
+  static void CommitExpiredFrame(uint32_t time);
+
+  // Returns 0 if no frame is open.
+  static int GetFrameTimeoutDelay(uint32_t time);
+
+  static void SetFrameRgb(size_t id, uint32_t rgb);
+  static void SetFrameRgb(size_t startId, const Uint32 *rgb, size_t count);
+  static void SetFrameHsv(size_t startId, const Uint32 *hsv, size_t count);
+  static uint32_t GetFrameRgb(size_t id) { return frame[id]; }
+
+  // Applies a 2.2 gamma curve to committed frames.
+  static void SetGammaCorrection(bool enabled) {
+    isGammaCorrectionEnabled = enabled;
+  }
+
   static void SetRgbBase64(size_t start, const uint8_t *p);
   static size_t GetCount();
 
@@ -32,6 +73,20 @@ public:
 #else
   static void AddConsoleCommands(Console &console) {}
 #endif
+
+private:
+  static constexpr size_t FRAME_MASK_COUNT = (JAVELIN_RGB_FRAME_SIZE + 31) / 32;
+
+  static bool isInFrame;
+  static bool isGammaCorrectionEnabled;
+  static uint32_t frameStartTime;
+  static size_t outOfRangeCount;
+  static uint32_t frameMask[FRAME_MASK_COUNT];
+  static uint32_t frame[JAVELIN_RGB_FRAME_SIZE];
+
+  static const uint8_t GAMMA_TABLE[256];
+
+  static size_t ClampFrameCount(size_t startId, size_t count);
 };
 
 //---------------------------------------------------------------------------
@@ -0,0 +1,222 @@
+//---------------------------------------------------------------------------
+
+#include "latency_histogram.h"
+#include "bit.h"
+#include "console.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+Latency Latency::instance;
+
+static constexpr const char *STAGE_NAMES[] = {
+    "button_update", //
+    "processor",     //
+    "segment_build", //
+    "conversion",    //
+    "emission",      //
+    "suggestions",   //
+    "flash_write",   //
+};
+
+static_assert(sizeof(STAGE_NAMES) / sizeof(*STAGE_NAMES) ==
+              (size_t)LatencyStage::COUNT);
+
+//---------------------------------------------------------------------------
+
+size_t LatencyHistogram::GetBucketIndex(uint32_t value) {
+  if (value < 2 * SUB_BUCKET_COUNT) {
+    return value;
+  }
+  if (value >= (1u << VALUE_BITS)) {
+    return BUCKET_COUNT - 1;
+  }
+
+  const size_t shift =
+      31 - Bit<4>::CountLeadingZeros(value) - SUB_BUCKET_BITS;
+  return (shift + 1) * SUB_BUCKET_COUNT +
+         ((value >> shift) & (SUB_BUCKET_COUNT - 1));
+}
+
+uint32_t LatencyHistogram::GetBucketMaximum(size_t index) {
+  if (index < 2 * SUB_BUCKET_COUNT) {
+    return index;
+  }
+  const size_t shift = index / SUB_BUCKET_COUNT - 1;
+  const uint32_t subBucket = index & (SUB_BUCKET_COUNT - 1);
+  return ((SUB_BUCKET_COUNT + subBucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Add(uint32_t value) {
+  if (count == 0 || value < minimum) {
+    minimum = value;
+  }
+  if (value > maximum) {
+    maximum = value;
+  }
+  ++count;
+  total += value;
+  ++buckets[GetBucketIndex(value)];
+}
+
+void LatencyHistogram::Reset() { memset(this, 0, sizeof(*this)); }
+
+uint32_t LatencyHistogram::GetValueAtPerMille(uint32_t perMille) const {
+  if (count == 0) {
+    return 0;
+  }
+
+  // Rank of the requested sample, rounded up, in the range [1, count].
+  uint32_t rank = uint32_t((uint64_t(count) * perMille + 999) / 1000);
+  if (rank == 0) {
+    rank = 1;
+  }
+
+  uint32_t seen = 0;
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      const uint32_t value = GetBucketMaximum(i);
+      return value < maximum ? value : maximum;
+    }
+  }
+  return maximum;
+}
+
+//---------------------------------------------------------------------------
+
+void Latency::Record(LatencyStage stage, uint32_t startTime) {
+  const uint32_t duration = Clock::GetMicroseconds() - startTime;
+  instance.histograms[(size_t)stage].Add(duration);
+
+  if (Console::IsEventEnabled(ConsoleEvent::LATENCY)) {
+    Console::Printf("EV e: l\ns: %s\nt: %u\n\n", STAGE_NAMES[(size_t)stage],
+                    duration);
+  }
+}
+
+void Latency::Reset() {
+  for (LatencyHistogram &histogram : instance.histograms) {
+    histogram.Reset();
+  }
+}
+
+void Latency::PrintLatency() {
+  Console::Printf("[");
+  for (size_t i = 0; i < (size_t)LatencyStage::COUNT; ++i) {
+    const LatencyHistogram &histogram = instance.histograms[i];
+    Console::Print(i == 0 ? "\n" : ",\n");
+    Console::Printf("\t{\"stage\":\"%s\",\"count\":%u,\"min\":%u,\"mean\":%u,"
+                    "\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u}",
+                    STAGE_NAMES[i], histogram.GetCount(),
+                    histogram.GetMinimum(), histogram.GetMean(),
+                    histogram.GetValueAtPerMille(500),
+                    histogram.GetValueAtPerMille(900),
+                    histogram.GetValueAtPerMille(990),
+                    histogram.GetMaximum());
+  }
+  Console::Printf("\n]\n\n");
+}
+
+//---------------------------------------------------------------------------
+
+void Latency::EnableLatencyTracking_Binding(void *context,
+                                            const char *commandLine) {
+  Enable();
+  Console::SendOk();
+}
+
+void Latency::DisableLatencyTracking_Binding(void *context,
+                                             const char *commandLine) {
+  Disable();
+  Console::SendOk();
+}
+
+void Latency::PrintLatency_Binding(void *context, const char *commandLine) {
+  PrintLatency();
+}
+
+void Latency::ResetLatency_Binding(void *context, const char *commandLine) {
+  Reset();
+  Console::SendOk();
+}
+
+void Latency::AddConsoleCommands(Console &console) {
+  console.RegisterCommand("enable_latency_tracking",
+                          "Starts recording processing latencies",
+                          &EnableLatencyTracking_Binding, nullptr);
+  console.RegisterCommand("disable_latency_tracking",
+                          "Stops recording processing latencies",
+                          &DisableLatencyTracking_Binding, nullptr);
+  console.RegisterCommand("print_latency",
+                          "Prints latency statistics for each stage",
+                          &PrintLatency_Binding, nullptr);
+  console.RegisterCommand("reset_latency", "Clears latency statistics",
+                          &ResetLatency_Binding, nullptr);
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "unit_test.h"
+
+TEST_BEGIN("LatencyHistogram: Bucket boundaries are contiguous") {
+  for (uint32_t value = 0; value < 100000; ++value) {
+    const size_t index = LatencyHistogram::GetBucketIndex(value);
+    assert(value <= LatencyHistogram::GetBucketMaximum(index));
+    if (index != 0) {
+      assert(value > LatencyHistogram::GetBucketMaximum(index - 1));
+    }
+  }
+  assert(LatencyHistogram::GetBucketIndex(0xffffffff) ==
+         LatencyHistogram::BUCKET_COUNT - 1);
+  assert(LatencyHistogram::GetBucketIndex((1 << 24) - 1) ==
+         LatencyHistogram::BUCKET_COUNT - 1);
+}
+TEST_END
+
+TEST_BEGIN("LatencyHistogram: Percentiles are within bucket precision") {
+  LatencyHistogram histogram;
+  histogram.Reset();
+  for (uint32_t value = 1; value <= 1000; ++value) {
+    histogram.Add(value);
+  }
+
+  assert(histogram.GetCount() == 1000);
+  assert(histogram.GetMinimum() == 1);
+  assert(histogram.GetMaximum() == 1000);
+  assert(histogram.GetMean() == 500);
+
+  const uint32_t p50 = histogram.GetValueAtPerMille(500);
+  assert(500 <= p50 && p50 <= 500 * 9 / 8);
+  const uint32_t p99 = histogram.GetValueAtPerMille(990);
+  assert(990 <= p99 && p99 <= 1000);
+  assert(histogram.GetValueAtPerMille(1000) == 1000);
+  assert(histogram.GetValueAtPerMille(0) == 1);
+}
+TEST_END
+
+TEST_BEGIN("Latency: Sentry records only when enabled") {
+  Latency::Reset();
+  {
+    LatencySentry sentry(LatencyStage::CONVERSION);
+    Clock::AdvanceMicroseconds(100);
+  }
+  assert(Latency::GetHistogram(LatencyStage::CONVERSION).GetCount() == 0);
+
+  Latency::Enable();
+  {
+    LatencySentry sentry(LatencyStage::CONVERSION);
+    Clock::AdvanceMicroseconds(100);
+  }
+  Latency::Disable();
+
+  const LatencyHistogram &histogram =
+      Latency::GetHistogram(LatencyStage::CONVERSION);
+  assert(histogram.GetCount() == 1);
+  assert(histogram.GetMaximum() == 100);
+  Latency::Reset();
+}
+TEST_END
+
+//---------------------------------------------------------------------------
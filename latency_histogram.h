@@ -0,0 +1,140 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "clock.h"
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+class Console;
+
+//---------------------------------------------------------------------------
+
+enum class LatencyStage : uint8_t {
+  BUTTON_UPDATE,
+  PROCESSOR,
+  SEGMENT_BUILD,
+  CONVERSION,
+  EMISSION,
+  SUGGESTIONS,
+  FLASH_WRITE,
+
+  COUNT,
+};
+
+//---------------------------------------------------------------------------
+
+// Log-linear histogram of microsecond durations.
+//
+// Values below 16 have their own bucket. Above that, each power of two is
+// split into 8 buckets, so that reported values are within 12.5%. Values of
+// 2^24 us (~16s) and above share the last bucket.
+class LatencyHistogram {
+public:
+  void Add(uint32_t value);
+  void Reset();
+
+  uint32_t GetCount() const { return count; }
+  uint32_t GetMinimum() const { return count ? minimum : 0; }
+  uint32_t GetMaximum() const { return maximum; }
+  uint32_t GetMean() const { return count ? uint32_t(total / count) : 0; }
+
+  // Returns the upper bound of the bucket containing the value at perMille,
+  // e.g. 990 for p99. The result is capped at the maximum seen.
+  uint32_t GetValueAtPerMille(uint32_t perMille) const;
+
+  static size_t GetBucketIndex(uint32_t value);
+  static uint32_t GetBucketMaximum(size_t index);
+
+  static constexpr size_t SUB_BUCKET_BITS = 3;
+  static constexpr size_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+  static constexpr size_t VALUE_BITS = 24;
+  static constexpr size_t BUCKET_COUNT =
+      (VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+private:
+  uint32_t count;
+  uint32_t minimum;
+  uint32_t maximum;
+  uint64_t total;
+  uint32_t buckets[BUCKET_COUNT];
+};
+
+//---------------------------------------------------------------------------
+
+// Runtime latency telemetry for the main processing stages.
+//
+// Recording is disabled by default and is enabled with the
+// enable_latency_tracking console command. When the latency console event is
+// enabled, each sample is also sent as an event.
+class Latency {
+public:
+  static bool IsEnabled() { return instance.isEnabled; }
+  static void Enable() { instance.isEnabled = true; }
+  static void Disable() { instance.isEnabled = false; }
+
+  static void Record(LatencyStage stage, uint32_t startTime);
+  static void Reset();
+
+  static const LatencyHistogram &GetHistogram(LatencyStage stage) {
+    return instance.histograms[(size_t)stage];
+  }
+
+  static void PrintLatency();
+
+  static void AddConsoleCommands(Console &console);
+
+private:
+  bool isEnabled;
+  LatencyHistogram histograms[(size_t)LatencyStage::COUNT];
+
+  static Latency instance;
+
+  static void EnableLatencyTracking_Binding(void *context,
+                                            const char *commandLine);
+  static void DisableLatencyTracking_Binding(void *context,
+                                             const char *commandLine);
+  static void PrintLatency_Binding(void *context, const char *commandLine);
+  static void ResetLatency_Binding(void *context, const char *commandLine);
+};
+
+// Records the time from construction to destruction against a stage.
+class LatencySentry {
+public:
+  LatencySentry(LatencyStage stage)
+      : stage(stage), isActive(Latency::IsEnabled()),
+        startTime(isActive ? Clock::GetMicroseconds() : 0) {}
+  ~LatencySentry() {
+    if (isActive) [[unlikely]] {
+      Latency::Record(stage, startTime);
+    }
+  }
+
+private:
+  const LatencyStage stage;
+  const bool isActive;
+  const uint32_t startTime;
+};
+
+// Records consecutive stages within a function, each timed from the previous
+// Lap.
+class LatencyStopwatch {
+public:
+  LatencyStopwatch()
+      : isActive(Latency::IsEnabled()),
+        lapTime(isActive ? Clock::GetMicroseconds() : 0) {}
+
+  void Lap(LatencyStage stage) {
+    if (isActive) [[unlikely]] {
+      Latency::Record(stage, lapTime);
+      lapTime = Clock::GetMicroseconds();
+    }
+  }
+
+private:
+  const bool isActive;
+  uint32_t lapTime;
+};
+
+//---------------------------------------------------------------------------
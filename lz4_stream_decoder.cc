@@ -0,0 +1,196 @@
+//---------------------------------------------------------------------------
+
+#include "lz4_stream_decoder.h"
+
+//---------------------------------------------------------------------------
+
+void Lz4StreamDecoder::Reset() {
+  state = State::TOKEN;
+  outputLength = 0;
+}
+
+bool Lz4StreamDecoder::AddMatch(Output &output) {
+  if (offset > outputLength) {
+    return false;
+  }
+  if (!output.AddMatch(offset, length)) {
+    return false;
+  }
+  outputLength += length;
+  state = State::TOKEN;
+  return true;
+}
+
+bool Lz4StreamDecoder::Decode(Output &output, const uint8_t *data,
+                              size_t dataLength) {
+  const uint8_t *const end = data + dataLength;
+  while (data < end) {
+    switch (state) {
+    case State::TOKEN:
+      token = *data++;
+      length = token >> 4;
+      state = length == 15  ? State::LITERAL_LENGTH
+              : length != 0 ? State::LITERALS
+                            : State::OFFSET_LOW;
+      break;
+
+    case State::LITERAL_LENGTH: {
+      const uint8_t c = *data++;
+      length += c;
+      if (c != 255) {
+        state = State::LITERALS;
+      }
+    } break;
+
+    case State::LITERALS: {
+      const size_t available = end - data;
+      const size_t count = length < available ? length : available;
+      output.AddLiterals(data, count);
+      outputLength += count;
+      data += count;
+      length -= count;
+      if (length == 0) {
+        state = State::OFFSET_LOW;
+      }
+    } break;
+
+    case State::OFFSET_LOW:
+      offset = *data++;
+      state = State::OFFSET_HIGH;
+      break;
+
+    case State::OFFSET_HIGH:
+      offset |= *data++ << 8;
+      if (offset == 0) {
+        return false;
+      }
+      length = (token & 15) + 4;
+      if ((token & 15) == 15) {
+        state = State::MATCH_LENGTH;
+      } else if (!AddMatch(output)) {
+        return false;
+      }
+      break;
+
+    case State::MATCH_LENGTH: {
+      const uint8_t c = *data++;
+      length += c;
+      if (c != 255 && !AddMatch(output)) {
+        return false;
+      }
+    } break;
+    }
+  }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "unit_test.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+class Lz4TestOutput final : public Lz4StreamDecoder::Output {
+public:
+  uint8_t data[1024];
+  size_t length = 0;
+
+  void AddLiterals(const uint8_t *literals, size_t count) final {
+    memcpy(data + length, literals, count);
+    length += count;
+  }
+
+  bool AddMatch(size_t distance, size_t count) final {
+    for (size_t i = 0; i < count; ++i) {
+      data[length] = data[length - distance];
+      ++length;
+    }
+    return true;
+  }
+};
+
+// "abcabcabcabcabcabcabc" followed by 300 'x', then "end".
+static constexpr uint8_t LZ4_TEST_BLOCK[] = {
+    // 3 literals, match of 18 at distance 3.
+    0x3e, 'a', 'b', 'c', 0x03, 0x00,
+    // 1 literal, match of 299 at distance 1: 15 + 255 + 25 + 4.
+    0x1f, 'x', 0x01, 0x00, 0xff, 0x19,
+    // Last literals.
+    0x30, 'e', 'n', 'd'};
+
+static void VerifyLz4TestOutput(const Lz4TestOutput &output) {
+  assert(output.length == 21 + 300 + 3);
+  for (size_t i = 0; i < 21; ++i) {
+    assert(output.data[i] == "abc"[i % 3]);
+  }
+  for (size_t i = 21; i < 321; ++i) {
+    assert(output.data[i] == 'x');
+  }
+  assert(memcmp(output.data + 321, "end", 3) == 0);
+}
+
+TEST_BEGIN("Lz4StreamDecoder: Decodes a whole block") {
+  Lz4StreamDecoder decoder;
+  Lz4TestOutput output;
+  assert(decoder.Decode(output, LZ4_TEST_BLOCK, sizeof(LZ4_TEST_BLOCK)));
+  assert(decoder.IsComplete());
+  assert(decoder.GetOutputLength() == 324);
+  VerifyLz4TestOutput(output);
+}
+TEST_END
+
+TEST_BEGIN("Lz4StreamDecoder: Decodes a block one byte at a time") {
+  Lz4StreamDecoder decoder;
+  Lz4TestOutput output;
+  for (size_t i = 0; i < sizeof(LZ4_TEST_BLOCK); ++i) {
+    assert(decoder.Decode(output, LZ4_TEST_BLOCK + i, 1));
+
+    // Complete after each sequence's literals, since any of them could be
+    // the last, but never after a match.
+    const bool isComplete =
+        i == 3 || i == 7 || i == sizeof(LZ4_TEST_BLOCK) - 1;
+    assert(decoder.IsComplete() == isComplete);
+  }
+  VerifyLz4TestOutput(output);
+}
+TEST_END
+
+TEST_BEGIN("Lz4StreamDecoder: Requires a final literal run") {
+  static constexpr uint8_t EMPTY_BLOCK[] = {0x00};
+  static constexpr uint8_t ENDS_WITH_MATCH[] = {0x10, 'a', 0x01, 0x00};
+  static constexpr uint8_t ENDS_WITH_EMPTY_LITERALS[] = {0x10, 'a', 0x01,
+                                                         0x00, 0x00};
+
+  Lz4StreamDecoder decoder;
+  Lz4TestOutput output;
+  assert(decoder.IsComplete());
+  assert(decoder.Decode(output, EMPTY_BLOCK, sizeof(EMPTY_BLOCK)));
+  assert(decoder.IsComplete());
+
+  decoder.Reset();
+  assert(decoder.Decode(output, ENDS_WITH_MATCH, sizeof(ENDS_WITH_MATCH)));
+  assert(!decoder.IsComplete());
+
+  decoder.Reset();
+  assert(decoder.Decode(output, ENDS_WITH_EMPTY_LITERALS,
+                        sizeof(ENDS_WITH_EMPTY_LITERALS)));
+  assert(!decoder.IsComplete());
+}
+TEST_END
+
+TEST_BEGIN("Lz4StreamDecoder: Rejects invalid offsets") {
+  static constexpr uint8_t ZERO_OFFSET[] = {0x10, 'a', 0x00, 0x00};
+  static constexpr uint8_t LONG_OFFSET[] = {0x10, 'a', 0x02, 0x00};
+
+  Lz4StreamDecoder decoder;
+  Lz4TestOutput output;
+  assert(!decoder.Decode(output, ZERO_OFFSET, sizeof(ZERO_OFFSET)));
+
+  decoder.Reset();
+  assert(!decoder.Decode(output, LONG_OFFSET, sizeof(LONG_OFFSET)));
+}
+TEST_END
+
+//---------------------------------------------------------------------------
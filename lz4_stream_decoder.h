@@ -0,0 +1,62 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+// Decodes LZ4 block format data that arrives in arbitrarily sized pieces.
+//
+// Output is passed to an Output implementation rather than a buffer, so
+// that matches can be resolved against data that has already been written,
+// e.g. to flash.
+class Lz4StreamDecoder {
+public:
+  class Output {
+  public:
+    virtual void AddLiterals(const uint8_t *data, size_t length) = 0;
+
+    // Appends length bytes starting distance bytes before the end of the
+    // output. distance may be less than length, in which case the copy
+    // repeats.
+    virtual bool AddMatch(size_t distance, size_t length) = 0;
+  };
+
+  void Reset();
+
+  // Returns false if the data is malformed.
+  bool Decode(Output &output, const uint8_t *data, size_t length);
+
+  // Returns true if nothing has been decoded, or the data decoded so far
+  // ends with a literal run that could be the last sequence of a block.
+  bool IsComplete() const {
+    if (state == State::TOKEN) {
+      return outputLength == 0;
+    }
+    return state == State::OFFSET_LOW &&
+           ((token >> 4) != 0 || outputLength == 0);
+  }
+
+  size_t GetOutputLength() const { return outputLength; }
+
+private:
+  enum class State : uint8_t {
+    TOKEN,
+    LITERAL_LENGTH,
+    LITERALS,
+    OFFSET_LOW,
+    OFFSET_HIGH,
+    MATCH_LENGTH,
+  };
+
+  State state = State::TOKEN;
+  uint8_t token;
+  uint16_t offset;
+  size_t length;
+  size_t outputLength = 0;
+
+  bool AddMatch(Output &output);
+};
+
+//---------------------------------------------------------------------------
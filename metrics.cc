@@ -0,0 +1,164 @@
+//---------------------------------------------------------------------------
+
+#include "metrics.h"
+#include "console.h"
+#include "str.h"
+#include <assert.h>
+
+//---------------------------------------------------------------------------
+
+Metrics Metrics::instance;
+
+//---------------------------------------------------------------------------
+
+void Metrics::Register(const Metric &metric) {
+  assert(instance.metricCount < MAX_METRIC_COUNT);
+  if (instance.metricCount >= MAX_METRIC_COUNT) {
+    return;
+  }
+  instance.metrics[instance.metricCount++] = metric;
+}
+
+void Metrics::Register(const char *group, const char *name, MetricType type,
+                       size_t (*getValue)(const void *context),
+                       const void *context) {
+  Register(Metric{
+      .group = group,
+      .name = name,
+      .type = type,
+      .getValue = getValue,
+      .context = context,
+  });
+}
+
+//---------------------------------------------------------------------------
+
+void Metrics::PrintSnapshot() {
+  const Metric *const metrics = instance.metrics;
+  const size_t metricCount = instance.metricCount;
+
+  Console::Print("{");
+  bool isFirstGroup = true;
+  for (size_t i = 0; i < metricCount; ++i) {
+    const char *group = metrics[i].group;
+
+    bool isNewGroup = true;
+    for (size_t j = 0; j < i; ++j) {
+      if (Str::Eq(metrics[j].group, group)) {
+        isNewGroup = false;
+        break;
+      }
+    }
+    if (!isNewGroup) {
+      continue;
+    }
+
+    Console::Printf(isFirstGroup ? "\"%s\":{" : ",\"%s\":{", group);
+    isFirstGroup = false;
+
+    bool isFirstMetric = true;
+    for (size_t j = i; j < metricCount; ++j) {
+      const Metric &metric = metrics[j];
+      if (!Str::Eq(metric.group, group)) {
+        continue;
+      }
+      Console::Printf(isFirstMetric ? "\"%s\":%zu" : ",\"%s\":%zu", metric.name,
+                      metric.getValue(metric.context));
+      isFirstMetric = false;
+    }
+    Console::Print("}");
+  }
+  Console::Printf("}\n\n");
+}
+
+void Metrics::PrintDescriptions() {
+  Console::Print("[");
+  for (size_t i = 0; i < instance.metricCount; ++i) {
+    const Metric &metric = instance.metrics[i];
+    Console::Printf(i == 0 ? "{\"name\":\"%s.%s\",\"type\":\"%s\"}"
+                           : ",{\"name\":\"%s.%s\",\"type\":\"%s\"}",
+                    metric.group, metric.name,
+                    metric.type == MetricType::COUNTER ? "counter" : "gauge");
+  }
+  Console::Printf("]\n\n");
+}
+
+//---------------------------------------------------------------------------
+
+void Metrics::GetMetrics_Binding(void *context, const char *commandLine) {
+  PrintSnapshot();
+}
+
+void Metrics::ListMetrics_Binding(void *context, const char *commandLine) {
+  PrintDescriptions();
+}
+
+void Metrics::AddConsoleCommands(Console &console) {
+  console.RegisterCommand("get_metrics",
+                          "Prints the value of all registered metrics",
+                          &GetMetrics_Binding, nullptr);
+  console.RegisterCommand("list_metrics",
+                          "Lists registered metrics and their types",
+                          &ListMetrics_Binding, nullptr);
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "unit_test.h"
+
+//---------------------------------------------------------------------------
+
+class MetricsTest {
+public:
+  static void Reset() { Metrics::instance.metricCount = 0; }
+};
+
+static size_t GetDoubledValue(const void *context) {
+  return 2 * *(const uint32_t *)context;
+}
+
+TEST_BEGIN("Metrics: Snapshot groups metrics") {
+  MetricsTest::Reset();
+
+  const size_t strokeCount = 12;
+  const uint16_t timerCount = 3;
+  const uint32_t programmedBytes = 4096;
+  Metrics::Register("engine", "strokes", MetricType::COUNTER, &strokeCount);
+  Metrics::Register("flash", "programmedBytes", MetricType::COUNTER,
+                    &programmedBytes);
+  Metrics::Register("timers", "count", MetricType::GAUGE, &timerCount);
+  Metrics::Register("flash", "doubled", MetricType::GAUGE, &GetDoubledValue,
+                    &programmedBytes);
+
+  Metrics::PrintSnapshot();
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(),
+                 "{\"engine\":{\"strokes\":12},"
+                 "\"flash\":{\"programmedBytes\":4096,\"doubled\":8192},"
+                 "\"timers\":{\"count\":3}}\n\n"));
+  Console::history.clear();
+
+  Metrics::PrintDescriptions();
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(),
+                 "[{\"name\":\"engine.strokes\",\"type\":\"counter\"},"
+                 "{\"name\":\"flash.programmedBytes\",\"type\":\"counter\"},"
+                 "{\"name\":\"timers.count\",\"type\":\"gauge\"},"
+                 "{\"name\":\"flash.doubled\",\"type\":\"gauge\"}]\n\n"));
+  Console::history.clear();
+
+  MetricsTest::Reset();
+}
+TEST_END
+
+TEST_BEGIN("Metrics: Empty snapshot") {
+  MetricsTest::Reset();
+  Metrics::PrintSnapshot();
+  Console::history.push_back(0);
+  assert(Str::Eq(&Console::history.front(), "{}\n\n"));
+  Console::history.clear();
+}
+TEST_END
+
+//---------------------------------------------------------------------------
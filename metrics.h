@@ -0,0 +1,77 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+class Console;
+
+//---------------------------------------------------------------------------
+
+enum class MetricType : uint8_t {
+  // Only increases during a session, e.g. bytes programmed.
+  COUNTER,
+
+  // Current value, e.g. active timer count.
+  GAUGE,
+};
+
+struct Metric {
+  const char *group;
+  const char *name;
+  MetricType type;
+  size_t (*getValue)(const void *context);
+  const void *context;
+};
+
+//---------------------------------------------------------------------------
+
+// Registry of counters and gauges that subsystems register from their
+// AddConsoleCommands, so that monitoring tools can poll all of them with a
+// single get_metrics command.
+//
+// Values are read when the snapshot is printed, so registering a metric
+// adds no cost to the code that updates it.
+class Metrics {
+public:
+  static void Register(const Metric &metric);
+  static void Register(const char *group, const char *name, MetricType type,
+                       size_t (*getValue)(const void *context),
+                       const void *context);
+
+  template <typename T>
+  static void Register(const char *group, const char *name, MetricType type,
+                       const T *value) {
+    Register(group, name, type, &GetValue<T>, value);
+  }
+
+  // Prints {"group":{"name":value,...},...}, with groups in the order they
+  // were first registered.
+  static void PrintSnapshot();
+
+  // Prints [{"name":"group.name","type":"counter"},...].
+  static void PrintDescriptions();
+
+  static void AddConsoleCommands(Console &console);
+
+private:
+  static constexpr size_t MAX_METRIC_COUNT = 48;
+
+  size_t metricCount;
+  Metric metrics[MAX_METRIC_COUNT];
+
+  static Metrics instance;
+
+  template <typename T> static size_t GetValue(const void *context) {
+    return size_t(*(const T *)context);
+  }
+
+  static void GetMetrics_Binding(void *context, const char *commandLine);
+  static void ListMetrics_Binding(void *context, const char *commandLine);
+
+  friend class MetricsTest;
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,271 @@
+//---------------------------------------------------------------------------
+//
+// Format strings that are parsed and checked against their arguments at
+// compile time, e.g.
+//
+//   Console::Printf<"EV e: p\no: %t\nu: %zu\n\n">(&stroke, undoCount);
+//
+// The format is reduced to a list of PrintfOps, so IWriter does no parsing
+// at runtime. Conversions are the same as IWriter::Printf.
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+//---------------------------------------------------------------------------
+
+class StenoStroke;
+
+//---------------------------------------------------------------------------
+
+struct PrintfArgument {
+  uint64_t value;
+
+  int32_t GetInt32() const { return int32_t(value); }
+  uint32_t GetUint32() const { return uint32_t(value); }
+  int64_t GetInt64() const { return int64_t(value); }
+  uint64_t GetUint64() const { return value; }
+  size_t GetSize() const { return size_t(value); }
+  template <typename T> T *GetPointer() const { return (T *)uintptr_t(value); }
+
+  template <typename T> static PrintfArgument Create(T v) {
+    if constexpr (std::is_pointer_v<T>) {
+      return {uint64_t(uintptr_t(v))};
+    } else if constexpr (std::is_signed_v<T>) {
+      return {uint64_t(int64_t(v))};
+    } else {
+      return {uint64_t(v)};
+    }
+  }
+};
+
+// Either literal text, or a conversion that consumes one or two arguments.
+struct PrintfOp {
+  static constexpr uint8_t FLAG_FILL_ZERO = 1;
+  static constexpr uint8_t FLAG_LENGTH_64_BIT = 2;
+
+  // 'l' or 'z' was used, so the argument may be 64-bit on hosts.
+  static constexpr uint8_t FLAG_LENGTH_WIDE = 4;
+
+  // Integer conversions with any of these flags use all 64 bits of the
+  // argument. Wide conversions are 64-bit where size_t is.
+  static constexpr uint8_t FLAGS_64_BIT =
+      FLAG_LENGTH_64_BIT | (sizeof(size_t) == 8 ? FLAG_LENGTH_WIDE : 0);
+
+  uint16_t offset = 0;
+  uint16_t length = 0;
+
+  // '\0' for literal text.
+  char conversion = '\0';
+  uint8_t flags = 0;
+  uint8_t width = 0;
+};
+
+enum class PrintfArgumentKind : uint8_t {
+  INTEGER,
+  INTEGER_64,
+  STRING,
+  STROKES,
+  POINTER,
+  INVALID,
+};
+
+template <typename T> consteval PrintfArgumentKind GetPrintfArgumentKind() {
+  if constexpr (std::is_pointer_v<T>) {
+    using P = std::remove_cv_t<std::remove_pointer_t<T>>;
+    if constexpr (std::is_same_v<P, char>) {
+      return PrintfArgumentKind::STRING;
+    } else if constexpr (std::is_same_v<P, StenoStroke>) {
+      return PrintfArgumentKind::STROKES;
+    } else {
+      return PrintfArgumentKind::POINTER;
+    }
+  } else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+    return sizeof(T) == 8 ? PrintfArgumentKind::INTEGER_64
+                          : PrintfArgumentKind::INTEGER;
+  } else {
+    return PrintfArgumentKind::INVALID;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+template <size_t N> struct PrintfFormat {
+  char text[N];
+
+  consteval PrintfFormat(const char (&format)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+      text[i] = format[i];
+    }
+  }
+
+  consteval size_t GetOpCount() const {
+    size_t count = 0;
+    PrintfOp op;
+    for (size_t offset = 0; offset < N - 1; offset = ParseOp(offset, op)) {
+      ++count;
+    }
+    return count;
+  }
+
+  // Parses the op at offset, returning the offset of the next op.
+  consteval size_t ParseOp(size_t offset, PrintfOp &op) const {
+    op = {};
+    if (text[offset] != '%') {
+      size_t end = offset;
+      while (end < N - 1 && text[end] != '%') {
+        ++end;
+      }
+      op.offset = offset;
+      op.length = end - offset;
+      return end;
+    }
+
+    size_t p = offset + 1;
+    if (text[p] == '0') {
+      op.flags |= PrintfOp::FLAG_FILL_ZERO;
+      ++p;
+    } else if (text[p] == ' ') {
+      ++p;
+    }
+    while ('0' <= text[p] && text[p] <= '9') {
+      op.width = 10 * op.width + text[p++] - '0';
+    }
+    if (text[p] == 'l') {
+      ++p;
+      if (text[p] == 'l') {
+        op.flags |= PrintfOp::FLAG_LENGTH_64_BIT;
+        ++p;
+      } else {
+        op.flags |= PrintfOp::FLAG_LENGTH_WIDE;
+      }
+    } else if (text[p] == 'h') {
+      ++p;
+    } else if (text[p] == 'z') {
+      op.flags |= PrintfOp::FLAG_LENGTH_WIDE;
+      ++p;
+    }
+
+    if (text[p] == '%') {
+      op.offset = p;
+      op.length = 1;
+      return p + 1;
+    }
+
+    // A missing conversion is reported by IsValid().
+    op.conversion = text[p] ? text[p] : '?';
+    return text[p] ? p + 1 : p;
+  }
+
+  template <typename... T> consteval bool IsValid() const {
+    constexpr PrintfArgumentKind kinds[] = {GetPrintfArgumentKind<T>()...,
+                                            PrintfArgumentKind::INVALID};
+    constexpr size_t argumentCount = sizeof...(T);
+
+    size_t index = 0;
+    PrintfOp op;
+    for (size_t offset = 0; offset < N - 1;) {
+      offset = ParseOp(offset, op);
+      if (op.conversion == '\0' || op.conversion == 'Z') {
+        continue;
+      }
+      if (index >= argumentCount) {
+        return false;
+      }
+
+      const PrintfArgumentKind kind = kinds[index++];
+      switch (op.conversion) {
+      case 'd':
+      case 'i':
+      case 'u':
+      case 'x':
+      case 'X':
+        if (op.flags & PrintfOp::FLAG_LENGTH_64_BIT) {
+          if (kind != PrintfArgumentKind::INTEGER_64) {
+            return false;
+          }
+        } else if (kind != PrintfArgumentKind::INTEGER &&
+                   (kind != PrintfArgumentKind::INTEGER_64 ||
+                    (op.flags & PrintfOp::FLAG_LENGTH_WIDE) == 0)) {
+          return false;
+        }
+        break;
+
+      case 'B':
+      case 'c':
+      case 'C':
+        if (kind != PrintfArgumentKind::INTEGER) {
+          return false;
+        }
+        break;
+
+      case 's':
+      case 'J':
+      case 'Y':
+        if (kind != PrintfArgumentKind::STRING) {
+          return false;
+        }
+        break;
+
+      case 'p':
+        if (kind != PrintfArgumentKind::STRING &&
+            kind != PrintfArgumentKind::STROKES &&
+            kind != PrintfArgumentKind::POINTER) {
+          return false;
+        }
+        break;
+
+      case 't':
+        if (kind != PrintfArgumentKind::STROKES) {
+          return false;
+        }
+        break;
+
+      case 'T':
+      case 'O':
+      case 'b':
+      case 'D':
+        if (op.conversion == 'T' || op.conversion == 'O'
+                ? kind != PrintfArgumentKind::STROKES
+                : kind != PrintfArgumentKind::STRING &&
+                      kind != PrintfArgumentKind::POINTER) {
+          return false;
+        }
+        if (index >= argumentCount ||
+            (kinds[index] != PrintfArgumentKind::INTEGER &&
+             kinds[index] != PrintfArgumentKind::INTEGER_64)) {
+          return false;
+        }
+        ++index;
+        break;
+
+      default:
+        return false;
+      }
+    }
+    return index == argumentCount;
+  }
+};
+
+template <PrintfFormat F> struct PrintfProgram {
+  static constexpr size_t OP_COUNT = F.GetOpCount();
+
+  struct Ops {
+    PrintfOp ops[OP_COUNT + 1];
+
+    consteval Ops() : ops() {
+      size_t offset = 0;
+      for (size_t i = 0; i < OP_COUNT; ++i) {
+        offset = F.ParseOp(offset, ops[i]);
+      }
+    }
+  };
+
+  static constexpr const char *TEXT = F.text;
+  static constexpr Ops OPS = {};
+};
+
+//---------------------------------------------------------------------------
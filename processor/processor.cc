@@ -1,6 +1,7 @@
 //---------------------------------------------------------------------------
 
 #include "processor.h"
+#include "../latency_histogram.h"
 
 //---------------------------------------------------------------------------
 
@@ -12,11 +13,13 @@ bool StenoProcessorElement::ProcessScanCode(uint32_t scanCodeAndModifiers,
 //---------------------------------------------------------------------------
 
 void StenoProcessor::Process(StenoKey key, bool isPress) {
+  const LatencySentry latencySentry(LatencyStage::PROCESSOR);
   state.Process(key, isPress);
   next.Process(state, isPress ? StenoAction::PRESS : StenoAction::RELEASE);
 }
 
 void StenoProcessor::Process(const StenoKeyState &newState) {
+  const LatencySentry latencySentry(LatencyStage::PROCESSOR);
   const StenoKeyState pressed = newState & ~state;
   if (pressed.IsNotEmpty()) {
     next.Process(state | newState, StenoAction::PRESS);
@@ -2,9 +2,12 @@
 
 #include "script.h"
 #include "console.h"
+#include "container/list.h"
 #include "mem.h"
+#include "script_verifier.h"
 
 #include <assert.h>
+#include <stdlib.h>
 
 //---------------------------------------------------------------------------
 
@@ -44,6 +47,199 @@ void Script::ExecuteScript(size_t offset, const intptr_t *parameters,
   assert(stackTop == start);
 }
 
+//---------------------------------------------------------------------------
+
+#if USE_SCRIPT_SUPER_INSTRUCTIONS
+
+static const size_t INSTRUCTION_START = 1;
+static const size_t FUSED_INSTRUCTION = 2;
+
+// Marks all instructions reachable from the script entry points and direct
+// calls. Offsets reached through CALL_VALUE and JUMP_VALUE are not followed,
+// and will execute without superinstructions.
+static void MarkInstructionStarts(const ScriptByteCode *byteCode,
+                                  size_t length, uint8_t *flags) {
+  using BC = StenoScriptByteCode;
+
+  const uint8_t *const data = (const uint8_t *)byteCode;
+
+  List<size_t> pending;
+  const size_t scriptCount = byteCode->GetScriptOffsetCount();
+  for (size_t i = 0; i < scriptCount; ++i) {
+    const size_t offset = byteCode->scriptOffsets[i];
+    if (offset != 0) {
+      pending.Add(offset);
+    }
+  }
+
+  while (pending.IsNotEmpty()) {
+    size_t offset = pending.Back();
+    pending.Pop();
+
+    for (;;) {
+      if (offset >= length || (flags[offset] & INSTRUCTION_START)) {
+        break;
+      }
+      const uint32_t c = data[offset];
+      const size_t instructionLength = BC::GetInstructionLength(c);
+      if (instructionLength == 0 || offset + instructionLength > length) {
+        break;
+      }
+      flags[offset] |= INSTRUCTION_START;
+
+      const size_t next = offset + instructionLength;
+      const size_t longTarget =
+          instructionLength == 3 ? data[offset + 1] + (data[offset + 2] << 8)
+                                 : 0;
+
+      if (c == BC::RETURN || c == BC::JUMP_VALUE) {
+        break;
+      } else if (c == BC::JUMP_LONG) {
+        offset = longTarget;
+        continue;
+      } else if (c == BC::CALL || c == BC::JUMP_IF_ZERO_LONG ||
+                 c == BC::JUMP_IF_NOT_ZERO_LONG) {
+        pending.Add(longTarget);
+      } else if (BC::JUMP_SHORT_BEGIN <= c && c <= BC::JUMP_SHORT_END) {
+        offset = next + c + 1 - BC::JUMP_SHORT_BEGIN;
+        continue;
+      } else if (BC::JUMP_IF_ZERO_SHORT_BEGIN <= c &&
+                 c <= BC::JUMP_IF_NOT_ZERO_SHORT_END &&
+                 c != BC::JUMP_IF_ZERO_LONG) {
+        pending.Add(next + ((c - BC::JUMP_IF_ZERO_SHORT_BEGIN) & 0x1f) + 1);
+      }
+      offset = next;
+    }
+  }
+}
+
+static bool IsPushConstant(uint32_t c) {
+  return c <= StenoScriptByteCode::PUSH_CONSTANT_END;
+}
+
+static bool IsLoadLocal(uint32_t c) {
+  return StenoScriptByteCode::LOAD_LOCAL_BEGIN <= c &&
+         c <= StenoScriptByteCode::LOAD_LOCAL_END;
+}
+
+static bool IsLoadGlobal(uint32_t c) {
+  return StenoScriptByteCode::LOAD_GLOBAL_BEGIN <= c &&
+         c <= StenoScriptByteCode::LOAD_GLOBAL_END;
+}
+
+static bool IsAddSubtract(uint32_t c) {
+  using BC = StenoScriptByteCode;
+  using OP = StenoScriptOperator;
+  return c == BC::OPERATOR_START + (int)OP::ADD ||
+         c == BC::OPERATOR_START + (int)OP::SUBTRACT;
+}
+
+static bool IsCompare(uint32_t c) {
+  using BC = StenoScriptByteCode;
+  using OP = StenoScriptOperator;
+  return BC::OPERATOR_START + (int)OP::EQUALS <= c &&
+         c <= BC::OPERATOR_START + (int)OP::GREATER_THAN_OR_EQUAL_TO;
+}
+
+static bool IsJumpIfZeroShort(uint32_t c) {
+  return StenoScriptByteCode::JUMP_IF_ZERO_SHORT_BEGIN <= c &&
+         c <= StenoScriptByteCode::JUMP_IF_ZERO_SHORT_END;
+}
+
+// Returns the superinstruction for the sequence at offset, and sets
+// fusedLength to the number of bytes it covers, or returns 0.
+// All fused instructions other than the last are single byte and do not
+// branch, so the whole sequence is always reachable from the first.
+static uint32_t FindSuperInstruction(const uint8_t *data, size_t offset,
+                                     size_t length, size_t &fusedLength) {
+  using BC = StenoScriptByteCode;
+
+  const size_t available = length - offset;
+  const uint8_t *p = data + offset;
+
+  if (available >= 4 && IsPushConstant(p[1]) && IsCompare(p[2]) &&
+      IsJumpIfZeroShort(p[3])) {
+    fusedLength = 4;
+    if (IsLoadLocal(p[0])) {
+      return BC::LOAD_LOCAL_PUSH_CONSTANT_COMPARE_JUMP_IF_ZERO;
+    }
+    if (IsLoadGlobal(p[0])) {
+      return BC::LOAD_GLOBAL_PUSH_CONSTANT_COMPARE_JUMP_IF_ZERO;
+    }
+  }
+  if (available >= 3 && IsLoadLocal(p[0]) && IsPushConstant(p[1]) &&
+      IsAddSubtract(p[2])) {
+    fusedLength = 3;
+    return BC::LOAD_LOCAL_PUSH_CONSTANT_OPERATOR;
+  }
+  if (available >= 2 && IsCompare(p[0]) && IsJumpIfZeroShort(p[1])) {
+    fusedLength = 2;
+    return BC::COMPARE_JUMP_IF_ZERO;
+  }
+  if (available >= 2 && IsPushConstant(p[0]) && IsAddSubtract(p[1])) {
+    fusedLength = 2;
+    return BC::PUSH_CONSTANT_OPERATOR;
+  }
+  return 0;
+}
+
+#endif
+
+void Script::PrepareSuperInstructions() {
+#if USE_SCRIPT_SUPER_INSTRUCTIONS
+  ReleaseSuperInstructions();
+
+  // Superinstructions skip the checks of the individual instructions, so are
+  // only used for byte code that has been verified.
+  if (!ScriptVerifier::IsVerified(byteCode, functionCount,
+                                  functionSignatures)) {
+    return;
+  }
+
+  const uint8_t *const data = (const uint8_t *)byteCode;
+  const size_t length = byteCode->GetLength();
+
+  uint8_t *flags = (uint8_t *)malloc(length);
+  Mem::Clear(flags, length);
+  MarkInstructionStarts(byteCode, length, flags);
+
+  uint8_t *code = (uint8_t *)malloc(length);
+  Mem::Copy(code, data, length);
+
+  for (size_t offset = 0; offset < length; ++offset) {
+    if (flags[offset] != INSTRUCTION_START) {
+      continue;
+    }
+
+    size_t fusedLength;
+    const uint32_t superInstruction =
+        FindSuperInstruction(data, offset, length, fusedLength);
+    if (superInstruction == 0) {
+      continue;
+    }
+
+    // The remaining bytes are left intact so that they can be used as
+    // operands, and can still be the target of jumps.
+    code[offset] = superInstruction;
+    for (size_t i = 1; i < fusedLength; ++i) {
+      flags[offset + i] |= FUSED_INSTRUCTION;
+    }
+  }
+
+  free(flags);
+  superInstructions = code;
+#endif
+}
+
+void Script::ReleaseSuperInstructions() {
+#if USE_SCRIPT_SUPER_INSTRUCTIONS
+  free(superInstructions);
+  superInstructions = nullptr;
+#endif
+}
+
+//---------------------------------------------------------------------------
+
 void Script::PrintScriptGlobals() const {
   Base64Writer base64Data(ConsoleWriter::instance.GetActiveWriter());
   base64Data.WriteIntList((const int32_t *)globals, 256);
@@ -127,6 +323,8 @@ public:
   uint32_t ReadU8() { return *p++; }
   void Advance(intptr_t offset) { p += offset; }
 
+  const uint8_t *GetPointer() const { return p; }
+  uint32_t GetU8(size_t offset) const { return p[offset]; }
   uint32_t GetU16() const { return p[0] + (p[1] << 8); }
 
   uint32_t ReadU16() {
@@ -161,12 +359,50 @@ private:
   const uint8_t *p;
 };
 
+#if USE_SCRIPT_COMPUTED_GOTO
+#define REPEAT_2(x) x, x
+#define REPEAT_4(x) REPEAT_2(x), REPEAT_2(x)
+#define REPEAT_8(x) REPEAT_4(x), REPEAT_4(x)
+#define REPEAT_16(x) REPEAT_8(x), REPEAT_8(x)
+#define REPEAT_31(x)                                                           \
+  REPEAT_16(x), REPEAT_8(x), REPEAT_4(x), REPEAT_2(x), x
+#endif
+
+// Superinstruction helpers. These avoid a second indirect branch on the
+// fused operator.
+static bool EvaluateCompare(uint32_t op, intptr_t a, intptr_t b) {
+  // Bit 0: less than, bit 1: equal to, bit 2: greater than.
+  static constexpr uint8_t COMPARE_MASKS[] = {
+      2, // EQUALS
+      5, // NOT_EQUALS
+      1, // LESS_THAN
+      3, // LESS_THAN_OR_EQUAL_TO
+      4, // GREATER_THAN
+      6, // GREATER_THAN_OR_EQUAL_TO
+  };
+  const uint32_t relation = (a < b) | ((a == b) << 1) | ((a > b) << 2);
+  return relation &
+         COMPARE_MASKS[op - (uint32_t)StenoScriptOperator::EQUALS];
+}
+
+static intptr_t EvaluateAddSubtract(uint32_t op, intptr_t a, intptr_t b) {
+  return op == (uint32_t)StenoScriptOperator::ADD ? a + b : a - b;
+}
+
 [[gnu::weak]] void Script::Run(size_t offset, const ScriptByteCode *bc) {
   using BC = StenoScriptByteCode;
-  using OP = StenoScriptOperator;
 
   const uint8_t *const byteCode = (const uint8_t *)bc;
 
+  // Instructions are read from code, data is read from byteCode.
+#if USE_SCRIPT_SUPER_INSTRUCTIONS
+  const uint8_t *const code = (superInstructions && bc == this->byteCode)
+                                  ? superInstructions
+                                  : byteCode;
+#else
+  const uint8_t *const code = byteCode;
+#endif
+
 #if RUN_TESTS
   intptr_t *locals = stackTop;
 #else
@@ -182,18 +418,128 @@ private:
 
   void (*const *const functionTable)(Script &, const ScriptByteCode *) =
       this->functionTable;
-  ProgramCounter p = byteCode + offset;
+  ProgramCounter p = code + offset;
+  uint32_t c;
+
+#if USE_SCRIPT_COMPUTED_GOTO
+  static const void *const DISPATCH_TABLE[] = {
+      // 0x00-0x3f
+      REPEAT_16(&&PUSH_CONSTANT),
+      REPEAT_16(&&PUSH_CONSTANT),
+      REPEAT_16(&&PUSH_CONSTANT),
+      REPEAT_8(&&PUSH_CONSTANT),
+      REPEAT_4(&&PUSH_CONSTANT),
+      &&PUSH_BYTES_1U,
+      &&PUSH_BYTES_2S,
+      &&PUSH_BYTES_3S,
+      &&PUSH_BYTES_4,
+
+      // 0x40-0x4f
+      REPEAT_4(&&LOAD_GLOBAL),
+      REPEAT_2(&&LOAD_GLOBAL),
+      &&LOAD_GLOBAL_VALUE,
+      &&LOAD_GLOBAL_INDEX,
+      REPEAT_4(&&STORE_GLOBAL),
+      REPEAT_2(&&STORE_GLOBAL),
+      &&STORE_GLOBAL_VALUE,
+      &&STORE_GLOBAL_INDEX,
+
+      // 0x50-0x6f
+      REPEAT_8(&&LOAD_LOCAL),
+      REPEAT_4(&&LOAD_LOCAL),
+      REPEAT_2(&&LOAD_LOCAL),
+      &&LOAD_LOCAL_VALUE,
+      &&LOAD_LOCAL_INDEX,
+      REPEAT_8(&&STORE_LOCAL),
+      REPEAT_4(&&STORE_LOCAL),
+      REPEAT_2(&&STORE_LOCAL),
+      &&STORE_LOCAL_VALUE,
+      &&STORE_LOCAL_INDEX,
+
+      // 0x70-0x8f
+      &&NOT,
+      &&NEGATIVE,
+      &&MULTIPLY,
+      &&QUOTIENT,
+      &&REMAINDER,
+      &&ADD,
+      &&SUBTRACT,
+      &&EQUALS,
+      &&NOT_EQUALS,
+      &&LESS_THAN,
+      &&LESS_THAN_OR_EQUAL_TO,
+      &&GREATER_THAN,
+      &&GREATER_THAN_OR_EQUAL_TO,
+      &&BITWISE_AND,
+      &&BITWISE_OR,
+      &&BITWISE_XOR,
+      &&AND,
+      &&OR,
+      &&SHIFT_LEFT,
+      &&ARITHMETIC_SHIFT_RIGHT,
+      &&LOGICAL_SHIFT_RIGHT,
+      &&READ_BYTE_INDEX,
+      &&READ_WORD_INDEX,
+      &&INCREMENT,
+      &&DECREMENT,
+      &&READ_HALF_WORD_INDEX,
+      &&WRITE_BYTE_INDEX,
+      &&WRITE_HALF_WORD_INDEX,
+      &&WRITE_WORD_INDEX,
+      REPEAT_2(&&INVALID),
+      &&INVALID,
+
+      // 0x90-0x9f
+      &&CALL_INTERNAL,
+      &&CALL,
+      &&RETURN,
+      &&POP,
+      &&ENTER_FUNCTION,
+      &&CALL_VALUE,
+      &&JUMP_VALUE,
+      &&RETURN_IF_ZERO,
+      &&RETURN_IF_NOT_ZERO,
+      &&DUP,
+      &&LOAD_LOCAL_PUSH_CONSTANT_COMPARE_JUMP_IF_ZERO,
+      &&LOAD_GLOBAL_PUSH_CONSTANT_COMPARE_JUMP_IF_ZERO,
+      &&COMPARE_JUMP_IF_ZERO,
+      &&LOAD_LOCAL_PUSH_CONSTANT_OPERATOR,
+      &&PUSH_CONSTANT_OPERATOR,
+      &&NOP,
+
+      // 0xa0-0xff
+      REPEAT_31(&&JUMP_SHORT),
+      &&JUMP_LONG,
+      REPEAT_31(&&JUMP_IF_ZERO_SHORT),
+      &&JUMP_IF_ZERO_LONG,
+      REPEAT_31(&&JUMP_IF_NOT_ZERO_SHORT),
+      &&JUMP_IF_NOT_ZERO_LONG,
+  };
+  static_assert(sizeof(DISPATCH_TABLE) / sizeof(*DISPATCH_TABLE) == 256);
+
+#define CONTINUE                                                               \
+  c = p.ReadU8();                                                              \
+  goto *DISPATCH_TABLE[c];
+#define OPCODE(value, label) label:
+
+  CONTINUE;
+  {
+#else
+  // Only the switch dispatch uses the opcode values.
+  using OP = StenoScriptOperator;
 
 #define CONTINUE goto next;
+#define OPCODE(value, label) case value:
 
 next:
-  uint32_t c = p.ReadU8();
+  c = p.ReadU8();
 
   switch (c) {
-  case BC::PUSH_CONSTANT_START... BC::PUSH_CONSTANT_END:
+#endif
+  OPCODE(BC::PUSH_CONSTANT_START... BC::PUSH_CONSTANT_END, PUSH_CONSTANT)
     stack.Push(c);
     CONTINUE;
-  case BC::PUSH_BYTES_1U: {
+  OPCODE(BC::PUSH_BYTES_1U, PUSH_BYTES_1U) {
     int value = p.ReadU8();
     if (value < 0x3c) {
       value -= 0x3c;
@@ -201,193 +547,198 @@ next:
     stack.Push(value);
     CONTINUE;
   }
-  case BC::PUSH_BYTES_2S:
+  OPCODE(BC::PUSH_BYTES_2S, PUSH_BYTES_2S)
     stack.Push(p.ReadS16());
     CONTINUE;
-  case BC::PUSH_BYTES_3S:
+  OPCODE(BC::PUSH_BYTES_3S, PUSH_BYTES_3S)
     stack.Push(p.ReadS24());
     CONTINUE;
-  case BC::PUSH_BYTES_4:
+  OPCODE(BC::PUSH_BYTES_4, PUSH_BYTES_4)
     stack.Push(p.ReadS32());
     CONTINUE;
-  case BC::LOAD_GLOBAL_BEGIN... BC::LOAD_GLOBAL_END:
+  OPCODE(BC::LOAD_GLOBAL_BEGIN... BC::LOAD_GLOBAL_END, LOAD_GLOBAL)
     stack.Push(globals[c - BC::LOAD_GLOBAL_BEGIN]);
     CONTINUE;
-  case BC::LOAD_GLOBAL_VALUE: {
+  OPCODE(BC::LOAD_GLOBAL_VALUE, LOAD_GLOBAL_VALUE) {
     const int globalIndex = p.ReadU8();
     stack.Push(globals[globalIndex]);
     CONTINUE;
   }
-  case BC::LOAD_GLOBAL_INDEX: {
+  OPCODE(BC::LOAD_GLOBAL_INDEX, LOAD_GLOBAL_INDEX) {
     const intptr_t globalBaseIndex = p.ReadU8();
     const intptr_t index = stack.Pop();
     stack.Push(globals[globalBaseIndex + index]);
     CONTINUE;
   }
-  case BC::STORE_GLOBAL_BEGIN... BC::STORE_GLOBAL_END:
+  OPCODE(BC::STORE_GLOBAL_BEGIN... BC::STORE_GLOBAL_END, STORE_GLOBAL)
     globals[c - BC::STORE_GLOBAL_BEGIN] = stack.Pop();
     CONTINUE;
-  case BC::STORE_GLOBAL_VALUE: {
+  OPCODE(BC::STORE_GLOBAL_VALUE, STORE_GLOBAL_VALUE) {
     const int globalIndex = p.ReadU8();
     globals[globalIndex] = stack.Pop();
     CONTINUE;
   }
-  case BC::STORE_GLOBAL_INDEX: {
+  OPCODE(BC::STORE_GLOBAL_INDEX, STORE_GLOBAL_INDEX) {
     const int globalBaseIndex = p.ReadU8();
     stack.TwoParam([&, globalBaseIndex](intptr_t index, intptr_t value) {
       globals[globalBaseIndex + index] = value;
     });
     CONTINUE;
   }
-  case BC::LOAD_LOCAL_BEGIN... BC::LOAD_LOCAL_END:
+  OPCODE(BC::LOAD_LOCAL_BEGIN... BC::LOAD_LOCAL_END, LOAD_LOCAL)
     stack.Push(locals[c - BC::LOAD_LOCAL_BEGIN]);
     CONTINUE;
-  case BC::LOAD_LOCAL_VALUE: {
+  OPCODE(BC::LOAD_LOCAL_VALUE, LOAD_LOCAL_VALUE) {
     const int localIndex = p.ReadU8();
     stack.Push(locals[localIndex]);
     CONTINUE;
   }
-  case BC::LOAD_LOCAL_INDEX: {
+  OPCODE(BC::LOAD_LOCAL_INDEX, LOAD_LOCAL_INDEX) {
     const int localBaseIndex = p.ReadU8();
     const intptr_t index = stack.Pop();
     stack.Push(locals[localBaseIndex + index]);
     CONTINUE;
   }
-  case BC::STORE_LOCAL_BEGIN... BC::STORE_LOCAL_END:
+  OPCODE(BC::STORE_LOCAL_BEGIN... BC::STORE_LOCAL_END, STORE_LOCAL)
     locals[c - BC::STORE_LOCAL_BEGIN] = stack.Pop();
     CONTINUE;
-  case BC::STORE_LOCAL_VALUE: {
+  OPCODE(BC::STORE_LOCAL_VALUE, STORE_LOCAL_VALUE) {
     const int localIndex = p.ReadU8();
     locals[localIndex] = stack.Pop();
     CONTINUE;
   }
-  case BC::STORE_LOCAL_INDEX: {
+  OPCODE(BC::STORE_LOCAL_INDEX, STORE_LOCAL_INDEX) {
     const int localBaseIndex = p.ReadU8();
     stack.TwoParam([=](intptr_t index, intptr_t value) {
       locals[localBaseIndex + index] = value;
     });
     CONTINUE;
   }
-  case BC::OPERATOR_START + (int)OP::NOT:
+  OPCODE(BC::OPERATOR_START + (int)OP::NOT, NOT)
     stack.UnaryOp([](intptr_t a) { return (intptr_t)!a; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::NEGATIVE:
+  OPCODE(BC::OPERATOR_START + (int)OP::NEGATIVE, NEGATIVE)
     stack.UnaryOp([](intptr_t a) { return -a; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::MULTIPLY:
+  OPCODE(BC::OPERATOR_START + (int)OP::MULTIPLY, MULTIPLY)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a * b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::QUOTIENT:
+  OPCODE(BC::OPERATOR_START + (int)OP::QUOTIENT, QUOTIENT)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a / b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::REMAINDER:
+  OPCODE(BC::OPERATOR_START + (int)OP::REMAINDER, REMAINDER)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a % b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::ADD:
+  OPCODE(BC::OPERATOR_START + (int)OP::ADD, ADD)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a + b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::SUBTRACT:
+  OPCODE(BC::OPERATOR_START + (int)OP::SUBTRACT, SUBTRACT)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a - b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::EQUALS:
+  OPCODE(BC::OPERATOR_START + (int)OP::EQUALS, EQUALS)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a == b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::NOT_EQUALS:
+  OPCODE(BC::OPERATOR_START + (int)OP::NOT_EQUALS, NOT_EQUALS)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a != b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::LESS_THAN:
+  OPCODE(BC::OPERATOR_START + (int)OP::LESS_THAN, LESS_THAN)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a < b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::GREATER_THAN:
+  OPCODE(BC::OPERATOR_START + (int)OP::GREATER_THAN, GREATER_THAN)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a > b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::LESS_THAN_OR_EQUAL_TO:
+  OPCODE(BC::OPERATOR_START + (int)OP::LESS_THAN_OR_EQUAL_TO,
+         LESS_THAN_OR_EQUAL_TO)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a <= b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::GREATER_THAN_OR_EQUAL_TO:
+  OPCODE(BC::OPERATOR_START + (int)OP::GREATER_THAN_OR_EQUAL_TO,
+         GREATER_THAN_OR_EQUAL_TO)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a >= b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::BITWISE_AND:
+  OPCODE(BC::OPERATOR_START + (int)OP::BITWISE_AND, BITWISE_AND)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a & b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::BITWISE_OR:
+  OPCODE(BC::OPERATOR_START + (int)OP::BITWISE_OR, BITWISE_OR)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a | b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::BITWISE_XOR:
+  OPCODE(BC::OPERATOR_START + (int)OP::BITWISE_XOR, BITWISE_XOR)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a ^ b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::AND:
+  OPCODE(BC::OPERATOR_START + (int)OP::AND, AND)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a && b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::OR:
+  OPCODE(BC::OPERATOR_START + (int)OP::OR, OR)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a || b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::SHIFT_LEFT:
+  OPCODE(BC::OPERATOR_START + (int)OP::SHIFT_LEFT, SHIFT_LEFT)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a << b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::ARITHMETIC_SHIFT_RIGHT:
+  OPCODE(BC::OPERATOR_START + (int)OP::ARITHMETIC_SHIFT_RIGHT,
+         ARITHMETIC_SHIFT_RIGHT)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return a >> b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::LOGICAL_SHIFT_RIGHT:
+  OPCODE(BC::OPERATOR_START + (int)OP::LOGICAL_SHIFT_RIGHT, LOGICAL_SHIFT_RIGHT)
     stack.BinaryOp([](intptr_t a, intptr_t b) { return uintptr_t(a) >> b; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::READ_BYTE_INDEX:
+  OPCODE(BC::OPERATOR_START + (int)OP::READ_BYTE_INDEX, READ_BYTE_INDEX)
     stack.BinaryOp([=](intptr_t offset, intptr_t index) {
       const uint8_t *data = byteCode + offset;
       return data[index];
     });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::READ_WORD_INDEX:
+  OPCODE(BC::OPERATOR_START + (int)OP::READ_WORD_INDEX, READ_WORD_INDEX)
     stack.BinaryOp([=](intptr_t offset, intptr_t index) {
       const intptr_t *data = (const intptr_t *)(byteCode + offset);
       return data[index];
     });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::INCREMENT:
+  OPCODE(BC::OPERATOR_START + (int)OP::INCREMENT, INCREMENT)
     stack.UnaryOp([](intptr_t a) { return a + 1; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::DECREMENT:
+  OPCODE(BC::OPERATOR_START + (int)OP::DECREMENT, DECREMENT)
     stack.UnaryOp([](intptr_t a) { return a - 1; });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::READ_HALF_WORD_INDEX:
+  OPCODE(BC::OPERATOR_START + (int)OP::READ_HALF_WORD_INDEX,
+         READ_HALF_WORD_INDEX)
     stack.BinaryOp([=](intptr_t offset, intptr_t index) {
       const uint16_t *data = (const uint16_t *)(byteCode + offset);
       return data[index];
     });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::WRITE_BYTE_INDEX:
+  OPCODE(BC::OPERATOR_START + (int)OP::WRITE_BYTE_INDEX, WRITE_BYTE_INDEX)
     stack.TernaryVoidOp([=](intptr_t offset, intptr_t index, intptr_t value) {
       uint8_t *data = (uint8_t *)(byteCode + offset);
       data[index] = value;
     });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::WRITE_HALF_WORD_INDEX:
+  OPCODE(BC::OPERATOR_START + (int)OP::WRITE_HALF_WORD_INDEX,
+         WRITE_HALF_WORD_INDEX)
     stack.TernaryVoidOp([=](intptr_t offset, intptr_t index, intptr_t value) {
       uint16_t *data = (uint16_t *)(byteCode + offset);
       data[index] = value;
     });
     CONTINUE;
-  case BC::OPERATOR_START + (int)OP::WRITE_WORD_INDEX:
+  OPCODE(BC::OPERATOR_START + (int)OP::WRITE_WORD_INDEX, WRITE_WORD_INDEX)
     stack.TernaryVoidOp([=](intptr_t offset, intptr_t index, intptr_t value) {
       uint32_t *data = (uint32_t *)(byteCode + offset);
       data[index] = (uint32_t)value;
     });
     CONTINUE;
-  case BC::CALL_INTERNAL: {
+  OPCODE(BC::CALL_INTERNAL, CALL_INTERNAL) {
     stack.WriteBack(*this);
     const uint8_t function = p.ReadU8();
     (*functionTable[function])(*this, (const ScriptByteCode *)byteCode);
     stack.Load(*this);
     CONTINUE;
   }
-  case BC::CALL: {
+  OPCODE(BC::CALL, CALL) {
     const size_t offset = p.ReadU16();
     stack.WriteBack(*this);
     Run(offset, (const ScriptByteCode *)byteCode);
     stack.Load(*this);
     CONTINUE;
   }
-  case BC::RETURN:
+  OPCODE(BC::RETURN, RETURN)
   exit: {
     intptr_t *p = base;
     while (frame != stack.GetStackTop()) {
@@ -396,10 +747,10 @@ next:
     stackTop = p;
     return;
   }
-  case BC::POP:
+  OPCODE(BC::POP, POP)
     stack.Pop();
     CONTINUE;
-  case BC::ENTER_FUNCTION: {
+  OPCODE(BC::ENTER_FUNCTION, ENTER_FUNCTION) {
     const size_t parameterCount = p.ReadU8();
     const size_t localsCount = p.ReadU8();
 
@@ -415,7 +766,7 @@ next:
     stack.SetStackTop(frame);
     CONTINUE;
   }
-  case BC::CALL_VALUE: {
+  OPCODE(BC::CALL_VALUE, CALL_VALUE) {
     const size_t offset = stack.Pop();
     if (offset != 0) {
       stack.WriteBack(*this);
@@ -424,66 +775,268 @@ next:
     }
     CONTINUE;
   }
-  case BC::JUMP_VALUE: {
+  OPCODE(BC::JUMP_VALUE, JUMP_VALUE) {
     const size_t offset = stack.Pop();
     if (offset == 0) {
       stackTop = base;
       return;
     }
-    p = byteCode + offset;
+    p = code + offset;
     CONTINUE;
   }
-  case BC::RETURN_IF_ZERO:
+  OPCODE(BC::RETURN_IF_ZERO, RETURN_IF_ZERO)
     if (!stack.Pop()) {
       goto exit;
     }
     CONTINUE;
-  case BC::RETURN_IF_NOT_ZERO:
+  OPCODE(BC::RETURN_IF_NOT_ZERO, RETURN_IF_NOT_ZERO)
     if (stack.Pop()) {
       goto exit;
     }
     CONTINUE;
-  case BC::DUP:
+  OPCODE(BC::DUP, DUP)
     stack.Push(stack.Peek());
     CONTINUE;
-  case BC::NOP:
+  OPCODE(BC::NOP, NOP)
     CONTINUE;
-  case BC::JUMP_SHORT_BEGIN... BC::JUMP_SHORT_END: {
+  OPCODE(BC::JUMP_SHORT_BEGIN... BC::JUMP_SHORT_END, JUMP_SHORT) {
     const int offset = c + 1 - BC::JUMP_SHORT_BEGIN;
     p.Advance(offset);
     CONTINUE;
   }
-  case BC::JUMP_LONG:
-    p = byteCode + p.GetU16();
+  OPCODE(BC::JUMP_LONG, JUMP_LONG)
+    p = code + p.GetU16();
     CONTINUE;
-  case BC::JUMP_IF_ZERO_SHORT_BEGIN... BC::JUMP_IF_ZERO_SHORT_END:
+  OPCODE(BC::JUMP_IF_ZERO_SHORT_BEGIN... BC::JUMP_IF_ZERO_SHORT_END,
+         JUMP_IF_ZERO_SHORT)
     if (!stack.Pop()) {
       const int offset = c + 1 - BC::JUMP_IF_ZERO_SHORT_BEGIN;
       p.Advance(offset);
     }
     CONTINUE;
-  case BC::JUMP_IF_ZERO_LONG: {
+  OPCODE(BC::JUMP_IF_ZERO_LONG, JUMP_IF_ZERO_LONG) {
     const size_t offset = p.ReadU16();
     if (!stack.Pop()) {
-      p = byteCode + offset;
+      p = code + offset;
     }
     CONTINUE;
   }
-  case BC::JUMP_IF_NOT_ZERO_SHORT_BEGIN... BC::JUMP_IF_NOT_ZERO_SHORT_END:
+  OPCODE(BC::JUMP_IF_NOT_ZERO_SHORT_BEGIN... BC::JUMP_IF_NOT_ZERO_SHORT_END,
+         JUMP_IF_NOT_ZERO_SHORT)
     if (stack.Pop()) {
       const int offset = c + 1 - BC::JUMP_IF_NOT_ZERO_SHORT_BEGIN;
       p.Advance(offset);
     }
     CONTINUE;
-  case BC::JUMP_IF_NOT_ZERO_LONG: {
+  OPCODE(BC::JUMP_IF_NOT_ZERO_LONG, JUMP_IF_NOT_ZERO_LONG) {
     const size_t offset = p.ReadU16();
     if (stack.Pop()) {
-      p = byteCode + offset;
+      p = code + offset;
     }
     CONTINUE;
   }
+
+  // The first byte of a superinstruction replaces an instruction whose value
+  // is still available in byteCode. The following bytes are unmodified.
+  OPCODE(BC::LOAD_LOCAL_PUSH_CONSTANT_COMPARE_JUMP_IF_ZERO,
+         LOAD_LOCAL_PUSH_CONSTANT_COMPARE_JUMP_IF_ZERO) {
+    const size_t localIndex =
+        byteCode[p.GetPointer() - 1 - code] - BC::LOAD_LOCAL_BEGIN;
+    const intptr_t constant = p.GetU8(0);
+    const uint32_t op = p.GetU8(1) - BC::OPERATOR_START;
+    const int offset = p.GetU8(2) + 4 - BC::JUMP_IF_ZERO_SHORT_BEGIN;
+    if (!EvaluateCompare(op, locals[localIndex], constant)) {
+      p.Advance(offset);
+    } else {
+      p.Advance(3);
+    }
+    CONTINUE;
+  }
+  OPCODE(BC::LOAD_GLOBAL_PUSH_CONSTANT_COMPARE_JUMP_IF_ZERO,
+         LOAD_GLOBAL_PUSH_CONSTANT_COMPARE_JUMP_IF_ZERO) {
+    const size_t globalIndex =
+        byteCode[p.GetPointer() - 1 - code] - BC::LOAD_GLOBAL_BEGIN;
+    const intptr_t constant = p.GetU8(0);
+    const uint32_t op = p.GetU8(1) - BC::OPERATOR_START;
+    const int offset = p.GetU8(2) + 4 - BC::JUMP_IF_ZERO_SHORT_BEGIN;
+    if (!EvaluateCompare(op, globals[globalIndex], constant)) {
+      p.Advance(offset);
+    } else {
+      p.Advance(3);
+    }
+    CONTINUE;
+  }
+  OPCODE(BC::COMPARE_JUMP_IF_ZERO, COMPARE_JUMP_IF_ZERO) {
+    const uint32_t op =
+        byteCode[p.GetPointer() - 1 - code] - BC::OPERATOR_START;
+    const int offset = p.GetU8(0) + 2 - BC::JUMP_IF_ZERO_SHORT_BEGIN;
+    const intptr_t b = stack.Pop();
+    const intptr_t a = stack.Pop();
+    if (!EvaluateCompare(op, a, b)) {
+      p.Advance(offset);
+    } else {
+      p.Advance(1);
+    }
+    CONTINUE;
+  }
+  OPCODE(BC::LOAD_LOCAL_PUSH_CONSTANT_OPERATOR,
+         LOAD_LOCAL_PUSH_CONSTANT_OPERATOR) {
+    const size_t localIndex =
+        byteCode[p.GetPointer() - 1 - code] - BC::LOAD_LOCAL_BEGIN;
+    const intptr_t constant = p.GetU8(0);
+    const uint32_t op = p.GetU8(1) - BC::OPERATOR_START;
+    p.Advance(2);
+    stack.Push(EvaluateAddSubtract(op, locals[localIndex], constant));
+    CONTINUE;
+  }
+  OPCODE(BC::PUSH_CONSTANT_OPERATOR, PUSH_CONSTANT_OPERATOR) {
+    const intptr_t constant = byteCode[p.GetPointer() - 1 - code];
+    const uint32_t op = p.ReadU8() - BC::OPERATOR_START;
+    stack.Push(EvaluateAddSubtract(op, stack.Pop(), constant));
+    CONTINUE;
+  }
+
+#if USE_SCRIPT_COMPUTED_GOTO
+  INVALID:
+    return;
+#endif
   }
 }
 
+#undef CONTINUE
+#undef OPCODE
+
 //---------------------------------------------------------------------------
 //---------------------------------------------------------------------------
+
+#include "unit_test.h"
+
+#define DO_PROFILE_TEST 0
+
+//---------------------------------------------------------------------------
+
+// Hand assembled loop that exercises each superinstruction:
+//
+// func main() {
+//   var i = 0;
+//   var sum = 0;
+//   while (i < 50) {
+//     sum = sum + i * 3;
+//     if (g0 > 7) sum = sum - 1;
+//     if (i == sum) g1 = g1 + 1;
+//     i = i + 1;
+//     g0++;
+//   }
+//   g2 = sum;
+// }
+alignas(4) static const uint8_t LOOP_BYTE_CODE[] = {
+    0x4a, 0x53, 0x53, 0x34, // Magic
+    0x3a, 0x00,             // String hash table offset
+    0x08, 0x00,             // Script offsets
+    0x94, 0x00, 0x02,       // 8: ENTER_FUNCTION 0, 2
+    0x00, 0x60,             // 11: i = 0
+    0x00, 0x61,             // 13: sum = 0
+    0x50, 0x32, 0x79, 0xc0, // 15: if (!(i < 50)) goto 20
+    0xa2,                   // 19: goto 23
+    0xbf, 0x37, 0x00,       // 20: goto 55
+    0x51, 0x50, 0x03, 0x72, // 23: sum = sum + i * 3
+    0x75, 0x61,             //
+    0x40, 0x07, 0x7b, 0xc3, // 29: if (!(g0 > 7)) goto 37
+    0x51, 0x01, 0x76, 0x61, // 33: sum = sum - 1
+    0x50, 0x51, 0x77, 0xc3, // 37: if (!(i == sum)) goto 45
+    0x41, 0x01, 0x75, 0x49, // 41: g1 = g1 + 1
+    0x50, 0x01, 0x75, 0x60, // 45: i = i + 1
+    0x40, 0x87, 0x48,       // 49: g0++
+    0xbf, 0x0f, 0x00,       // 52: goto 15
+    0x51, 0x4a,             // 55: g2 = sum
+    0x92,                   // 57: return
+    0x01, 0x00, 0x00, 0x00, // 58: String hash table
+};
+
+static void VerifyLoopGlobals(const Script &script) {
+  intptr_t g0 = 0;
+  intptr_t g1 = 0;
+  intptr_t sum = 0;
+  for (intptr_t i = 0; i < 50; ++i) {
+    sum = sum + i * 3;
+    if (g0 > 7) {
+      sum = sum - 1;
+    }
+    if (i == sum) {
+      g1 = g1 + 1;
+    }
+    ++g0;
+  }
+
+  assert(script.GetGlobal(0) == g0);
+  assert(script.GetGlobal(1) == g1);
+  assert(script.GetGlobal(2) == sum);
+}
+
+TEST_BEGIN("Script: Superinstructions produce the same results") {
+  Script script(LOOP_BYTE_CODE, nullptr, 0);
+  assert(script.IsValid());
+  assert(ScriptVerifier::IsVerified((const ScriptByteCode *)LOOP_BYTE_CODE, 0));
+
+  script.Reset();
+  script.ExecuteScriptIndex(0);
+  VerifyLoopGlobals(script);
+
+  script.Reset();
+  script.PrepareSuperInstructions();
+#if USE_SCRIPT_SUPER_INSTRUCTIONS
+  using BC = StenoScriptByteCode;
+  const uint8_t *code = script.GetSuperInstructions();
+  assert(code != nullptr);
+  assert(code[15] == BC::LOAD_LOCAL_PUSH_CONSTANT_COMPARE_JUMP_IF_ZERO);
+  assert(code[29] == BC::LOAD_GLOBAL_PUSH_CONSTANT_COMPARE_JUMP_IF_ZERO);
+  assert(code[33] == BC::LOAD_LOCAL_PUSH_CONSTANT_OPERATOR);
+  assert(code[39] == BC::COMPARE_JUMP_IF_ZERO);
+  assert(code[42] == BC::PUSH_CONSTANT_OPERATOR);
+  assert(code[45] == BC::LOAD_LOCAL_PUSH_CONSTANT_OPERATOR);
+#endif
+  script.ExecuteScriptIndex(0);
+  VerifyLoopGlobals(script);
+
+  // Reset() keeps the prepared instructions.
+  script.Reset();
+#if USE_SCRIPT_SUPER_INSTRUCTIONS
+  assert(script.GetSuperInstructions() == code);
+#endif
+  script.ExecuteScriptIndex(0);
+  VerifyLoopGlobals(script);
+}
+TEST_END
+
+TEST_BEGIN("Script: Dispatch throughput") {
+  // Build with -DUSE_SCRIPT_COMPUTED_GOTO=0 to compare against switch
+  // dispatch.
+#if DO_PROFILE_TEST
+  const size_t iterationCount = 100'000;
+#else
+  const size_t iterationCount = 10;
+#endif
+
+  Script script(LOOP_BYTE_CODE, nullptr, 0);
+  for (int i = 0; i < 2; ++i) {
+    script.Reset();
+    if (i == 1) {
+      script.PrepareSuperInstructions();
+    }
+
+    const ProfileTimer timer;
+    for (size_t j = 0; j < iterationCount; ++j) {
+      script.SetGlobal(0, 0);
+      script.SetGlobal(1, 0);
+      script.ExecuteScriptIndex(0);
+    }
+#if DO_PROFILE_TEST
+    timer.PrintRate(i == 0 ? "Script loop" : "Script loop (superinstructions)",
+                    iterationCount, "runs");
+#endif
+    VerifyLoopGlobals(script);
+  }
+}
+TEST_END
+
+//---------------------------------------------------------------------------
@@ -6,14 +6,47 @@
 #include <stddef.h>
 #include <stdint.h>
 
+// Superinstructions need a RAM copy of the script instructions, so are
+// only enabled on hosts by default.
+#if !defined(USE_SCRIPT_SUPER_INSTRUCTIONS)
+#if JAVELIN_PLATFORM_PICO_SDK || JAVELIN_PLATFORM_NRF5_SDK
+#define USE_SCRIPT_SUPER_INSTRUCTIONS 0
+#else
+#define USE_SCRIPT_SUPER_INSTRUCTIONS 1
+#endif
+#endif
+
+// Computed goto dispatches each instruction with a single indirect branch
+// instead of the bounds check and table lookup of a switch. It requires the
+// GCC labels as values extension, and can be disabled with
+// -DUSE_SCRIPT_COMPUTED_GOTO=0.
+#if !defined(USE_SCRIPT_COMPUTED_GOTO)
+#if defined(__GNUC__)
+#define USE_SCRIPT_COMPUTED_GOTO 1
+#else
+#define USE_SCRIPT_COMPUTED_GOTO 0
+#endif
+#endif
+
 //---------------------------------------------------------------------------
 
 class Script {
 public:
   Script(const uint8_t *byteCode,
-         void (*const *functionTable)(Script &, const ScriptByteCode *byteCode))
+         void (*const *functionTable)(Script &, const ScriptByteCode *byteCode),
+         size_t functionCount,
+         const ScriptFunctionSignature *functionSignatures = nullptr)
       : byteCode((const ScriptByteCode *)byteCode),
-        functionTable(functionTable) {}
+        functionTable(functionTable), functionCount(functionCount),
+        functionSignatures(functionSignatures) {}
+
+#if USE_SCRIPT_SUPER_INSTRUCTIONS
+  ~Script() { ReleaseSuperInstructions(); }
+
+  // superInstructions is owned by this instance.
+  Script(const Script &) = delete;
+  Script &operator=(const Script &) = delete;
+#endif
 
   void Push(intptr_t value) {
     assert(stackTop < stack + MAX_STACK_SIZE);
@@ -68,6 +101,18 @@ public:
     return byteCode == this->byteCode;
   }
 
+  // Creates a copy of the inbuilt byte code instructions with common
+  // instruction sequences fused into superinstructions.
+  //
+  // This verifies the byte code, so should be called once when a script is
+  // loaded, rather than on every Reset().
+  void PrepareSuperInstructions();
+  void ReleaseSuperInstructions();
+
+#if USE_SCRIPT_SUPER_INSTRUCTIONS
+  const uint8_t *GetSuperInstructions() const { return superInstructions; }
+#endif
+
 protected:
   // Executes at offset with no stack and offset checks.
   void Run(size_t offset, const ScriptByteCode *byteCode);
@@ -80,7 +125,10 @@ protected:
     return byteCode->GetScriptData<uint8_t>(offset);
   }
 
-  void SetScript(const ScriptByteCode *byteCode) { this->byteCode = byteCode; }
+  void SetScript(const ScriptByteCode *byteCode) {
+    this->byteCode = byteCode;
+    PrepareSuperInstructions();
+  }
 
 private:
   class StackPointer;
@@ -89,8 +137,13 @@ private:
   static constexpr size_t MAX_STACK_SIZE = 256;
 
   const ScriptByteCode *byteCode;
+#if USE_SCRIPT_SUPER_INSTRUCTIONS
+  uint8_t *superInstructions = nullptr;
+#endif
   intptr_t *stackTop = stack;
   void (*const *const functionTable)(Script &, const ScriptByteCode *byteCode);
+  const size_t functionCount;
+  const ScriptFunctionSignature *const functionSignatures;
   intptr_t globals[256];
   intptr_t stack[MAX_STACK_SIZE];
 };
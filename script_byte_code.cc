@@ -6,6 +6,62 @@
 
 //---------------------------------------------------------------------------
 
+size_t StenoScriptByteCode::GetInstructionLength(uint32_t opCode) {
+  switch (opCode) {
+  case PUSH_BYTES_1U:
+  case LOAD_GLOBAL_VALUE:
+  case LOAD_GLOBAL_INDEX:
+  case STORE_GLOBAL_VALUE:
+  case STORE_GLOBAL_INDEX:
+  case LOAD_LOCAL_VALUE:
+  case LOAD_LOCAL_INDEX:
+  case STORE_LOCAL_VALUE:
+  case STORE_LOCAL_INDEX:
+  case CALL_INTERNAL:
+    return 2;
+
+  case PUSH_BYTES_2S:
+  case CALL:
+  case ENTER_FUNCTION:
+  case JUMP_LONG:
+  case JUMP_IF_ZERO_LONG:
+  case JUMP_IF_NOT_ZERO_LONG:
+    return 3;
+
+  case PUSH_BYTES_3S:
+    return 4;
+
+  case PUSH_BYTES_4:
+    return 5;
+
+  case OPERATOR_START + (int)StenoScriptOperator::WRITE_WORD_INDEX + 1 ...
+      OPERATOR_END:
+  case DUP + 1 ... NOP - 1:
+    return 0;
+
+  default:
+    return 1;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+size_t ScriptByteCode::GetScriptOffsetCount() const {
+  const uint8_t *const base = (const uint8_t *)this;
+  size_t tableEnd = stringHashTableOffset;
+  size_t count = 0;
+  while (size_t((const uint8_t *)&scriptOffsets[count + 1] - base) <=
+         tableEnd) {
+    const size_t offset = scriptOffsets[count++];
+    if (offset != 0 && offset < tableEnd) {
+      tableEnd = offset;
+    }
+  }
+  return count;
+}
+
+//---------------------------------------------------------------------------
+
 const char *
 ScriptByteCode::FindStringOrReturnOriginal(const char *string) const {
   const StenoScriptHashTable *hashTable = GetHashTable();
@@ -57,6 +57,16 @@ public:
     RETURN_IF_NOT_ZERO = 0x98,
     DUP = 0x99,
 
+    // Superinstructions are never present in stored byte code. They are
+    // only generated by Script::PrepareSuperInstructions() in a RAM copy of
+    // the instructions, and the fused instructions that follow the first
+    // byte are left intact.
+    LOAD_LOCAL_PUSH_CONSTANT_COMPARE_JUMP_IF_ZERO = 0x9a,
+    LOAD_GLOBAL_PUSH_CONSTANT_COMPARE_JUMP_IF_ZERO = 0x9b,
+    COMPARE_JUMP_IF_ZERO = 0x9c,
+    LOAD_LOCAL_PUSH_CONSTANT_OPERATOR = 0x9d,
+    PUSH_CONSTANT_OPERATOR = 0x9e,
+
     NOP = 0x9f,
 
     JUMP_SHORT_BEGIN = 0xa0,
@@ -71,6 +81,10 @@ public:
     JUMP_IF_NOT_ZERO_SHORT_END = 0xfe,
     JUMP_IF_NOT_ZERO_LONG = 0xff,
   };
+
+  // Returns the length of the instruction, including operands, or 0 if the
+  // op code is not valid.
+  static size_t GetInstructionLength(uint32_t opCode);
 };
 
 enum class StenoScriptOperator : uint8_t {
@@ -144,8 +158,21 @@ struct ScriptByteCode {
 
   uint32_t Crc() const { return Crc32::Hash(this, GetLength()); }
 
+  // Scripts immediately follow the offset table, so the count is determined
+  // by the lowest script offset.
+  size_t GetScriptOffsetCount() const;
+
 private:
   const char *FindStringOrReturnOriginal(const char *string) const;
 };
 
 //---------------------------------------------------------------------------
+
+// The number of values an internal function pops and pushes. CALL_INTERNAL
+// does not encode these, so they are provided with the function table.
+struct ScriptFunctionSignature {
+  uint8_t parameterCount;
+  uint8_t returnCount;
+};
+
+//---------------------------------------------------------------------------
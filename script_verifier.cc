@@ -0,0 +1,823 @@
+//---------------------------------------------------------------------------
+
+#include "script_verifier.h"
+#include "mem.h"
+
+#include <stdlib.h>
+
+//---------------------------------------------------------------------------
+
+using BC = StenoScriptByteCode;
+using OP = StenoScriptOperator;
+
+static constexpr int16_t UNVISITED = INT16_MIN;
+
+//---------------------------------------------------------------------------
+
+ScriptVerifier::ScriptVerifier(
+    const ScriptByteCode *byteCode, size_t functionCount,
+    const ScriptFunctionSignature *functionSignatures)
+    : byteCode(byteCode), data((const uint8_t *)byteCode),
+      functionCount(functionCount), functionSignatures(functionSignatures) {}
+
+ScriptVerifier::~ScriptVerifier() { free(flags); }
+
+bool ScriptVerifier::Verify() {
+  if (!VerifyHeader() || !DecodeInstructions() || !AnalyzeStack()) {
+    return false;
+  }
+
+  ComputeMaxStackDepth();
+  if (maxStackDepth != UNBOUNDED_STACK_DEPTH &&
+      maxStackDepth > MAX_STACK_DEPTH) {
+    return SetError(0, "Stack overflow");
+  }
+  return true;
+}
+
+bool ScriptVerifier::VerifyHeader() {
+  if (!byteCode->IsValid()) {
+    return SetError(0, "Invalid magic");
+  }
+
+  const size_t scriptCount = byteCode->GetScriptOffsetCount();
+  codeStart = size_t((const uint8_t *)&byteCode->scriptOffsets[scriptCount] -
+                     data);
+  codeEnd = byteCode->stringHashTableOffset;
+  if (codeEnd < codeStart) {
+    return SetError(0, "Invalid string hash table offset");
+  }
+
+  for (size_t i = 0; i < scriptCount; ++i) {
+    const size_t offset = byteCode->scriptOffsets[i];
+    if (offset != 0 && !IsInCode(offset)) {
+      return SetError(offset, "Script offset outside code");
+    }
+  }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+// Decodes all reachable instructions, and marks the offsets where stack
+// states need to be merged.
+bool ScriptVerifier::DecodeInstructions() {
+  flags = (uint8_t *)malloc(codeEnd);
+  if (flags == nullptr) {
+    return SetError(0, "Out of memory");
+  }
+  Mem::Clear(flags, codeEnd);
+
+  List<size_t> pending;
+  const size_t scriptCount = byteCode->GetScriptOffsetCount();
+  for (size_t i = 0; i < scriptCount; ++i) {
+    const size_t offset = byteCode->scriptOffsets[i];
+    if (offset != 0 && (flags[offset] & FUNCTION_ENTRY) == 0) {
+      flags[offset] |= FUNCTION_ENTRY | LEADER;
+      functions.Add(FunctionInfo{
+          .offset = offset,
+          .maxStackDepth = 0,
+          .minReturnCount = NO_RETURN,
+      });
+      pending.Add(offset);
+    }
+  }
+
+  while (pending.IsNotEmpty()) {
+    size_t offset = pending.Back();
+    pending.Pop();
+
+    for (;;) {
+      if (!IsInCode(offset)) {
+        return SetError(offset, "Execution outside code");
+      }
+      if (flags[offset] & INSTRUCTION_OPERAND) {
+        return SetError(offset, "Jump into instruction");
+      }
+      if (flags[offset] & INSTRUCTION_START) {
+        break;
+      }
+
+      const uint32_t c = data[offset];
+      const size_t length = BC::GetInstructionLength(c);
+      if (length == 0) {
+        return SetError(offset, "Invalid instruction");
+      }
+      if (offset + length > codeEnd) {
+        return SetError(offset, "Instruction overruns code");
+      }
+      flags[offset] |= INSTRUCTION_START;
+      for (size_t i = 1; i < length; ++i) {
+        if (flags[offset + i] & INSTRUCTION_START) {
+          return SetError(offset + i, "Overlapping instructions");
+        }
+        flags[offset + i] |= INSTRUCTION_OPERAND;
+      }
+
+      const size_t next = offset + length;
+      size_t target;
+      switch (c) {
+      case BC::RETURN:
+      case BC::JUMP_VALUE:
+        goto done;
+
+      case BC::CALL_INTERNAL:
+        if (data[offset + 1] >= functionCount) {
+          return SetError(offset, "Invalid internal function");
+        }
+        break;
+
+      case BC::CALL_VALUE:
+        hasDynamicCall = true;
+        break;
+
+      case BC::CALL:
+        target = GetLongTarget(offset);
+        if (!IsInCode(target)) {
+          return SetError(offset, "Call outside code");
+        }
+        if ((flags[target] & FUNCTION_ENTRY) == 0) {
+          flags[target] |= FUNCTION_ENTRY | LEADER;
+          functions.Add(FunctionInfo{
+              .offset = target,
+              .maxStackDepth = 0,
+              .minReturnCount = NO_RETURN,
+          });
+          pending.Add(target);
+        }
+        break;
+
+      case BC::JUMP_SHORT_BEGIN... BC::JUMP_SHORT_END:
+      case BC::JUMP_LONG:
+        target = c == BC::JUMP_LONG ? GetLongTarget(offset)
+                                    : next + c + 1 - BC::JUMP_SHORT_BEGIN;
+        if (!IsInCode(target)) {
+          return SetError(offset, "Jump outside code");
+        }
+        flags[target] |= LEADER;
+        offset = target;
+        continue;
+
+      case BC::JUMP_IF_ZERO_SHORT_BEGIN... BC::JUMP_IF_ZERO_SHORT_END:
+      case BC::JUMP_IF_NOT_ZERO_SHORT_BEGIN... BC::JUMP_IF_NOT_ZERO_SHORT_END:
+        target = next + ((c - BC::JUMP_IF_ZERO_SHORT_BEGIN) & 0x1f) + 1;
+        goto conditionalJump;
+
+      case BC::JUMP_IF_ZERO_LONG:
+      case BC::JUMP_IF_NOT_ZERO_LONG:
+        target = GetLongTarget(offset);
+      conditionalJump:
+        if (!IsInCode(target)) {
+          return SetError(offset, "Jump outside code");
+        }
+        flags[target] |= LEADER;
+        pending.Add(target);
+        break;
+      }
+
+      offset = next;
+    }
+  done:;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+bool ScriptVerifier::State::Merge(const State &incoming) {
+  bool changed = false;
+  if (incoming.depth > depth) {
+    depth = incoming.depth;
+    changed = true;
+  }
+  if (incoming.minDepth < minDepth) {
+    minDepth = incoming.minDepth;
+    changed = true;
+  }
+  if (incoming.frameTop > frameTop) {
+    frameTop = incoming.frameTop;
+    changed = true;
+  }
+  if (incoming.frameSize < frameSize) {
+    frameSize = incoming.frameSize;
+    changed = true;
+  }
+  return changed;
+}
+
+ScriptVerifier::Leader *ScriptVerifier::FindLeader(size_t offset) {
+  size_t left = 0;
+  size_t right = leaders.GetCount();
+  while (left < right) {
+    const size_t mid = (left + right) / 2;
+    if (leaders[mid].offset < offset) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  assert(left < leaders.GetCount() && leaders[left].offset == offset);
+  return &leaders[left];
+}
+
+size_t ScriptVerifier::FindFunctionIndex(size_t offset) const {
+  for (size_t i = 0; i < functions.GetCount(); ++i) {
+    if (functions[i].offset == offset) {
+      return i;
+    }
+  }
+  return (size_t)-1;
+}
+
+void ScriptVerifier::MergeIntoLeader(size_t offset, const State &state) {
+  Leader *leader = FindLeader(offset);
+  if (leader->state.depth == UNVISITED) {
+    leader->state = state;
+  } else if (!leader->state.Merge(state)) {
+    return;
+  }
+  QueueLeader(leader - &leaders[0]);
+}
+
+void ScriptVerifier::QueueLeader(size_t leaderIndex) {
+  State &state = leaders[leaderIndex].state;
+  if (!state.isQueued) {
+    state.isQueued = true;
+    pendingLeaders.Add(leaderIndex);
+  }
+}
+
+void ScriptVerifier::AddCall(const Call &call) {
+  for (const Call &existing : calls) {
+    if (existing.leader == call.leader && existing.callee == call.callee &&
+        existing.depth == call.depth) {
+      return;
+    }
+  }
+  calls.Add(call);
+}
+
+// Lowers the return count of the state's function, and revisits the callers
+// so that they see the new lower bound.
+void ScriptVerifier::AddReturn(const State &state) {
+  int returnCount = state.minDepth - state.frameTop;
+  if (returnCount < 0) {
+    returnCount = 0;
+  }
+
+  FunctionInfo &function = functions[state.function];
+  if (returnCount >= function.minReturnCount) {
+    return;
+  }
+  function.minReturnCount = (int16_t)returnCount;
+
+  for (const Call &call : calls) {
+    if (call.callee == state.function) {
+      QueueLeader(call.leader);
+    }
+  }
+}
+
+bool ScriptVerifier::AnalyzeStack() {
+  for (size_t offset = codeStart; offset < codeEnd; ++offset) {
+    if (flags[offset] & LEADER) {
+      leaders.Add(Leader{
+          .offset = offset,
+          .state =
+              State{
+                  .depth = UNVISITED,
+                  .minDepth = UNVISITED,
+                  .frameTop = 0,
+                  .frameSize = NO_FRAME,
+                  .function = 0,
+                  .isQueued = false,
+              },
+      });
+    }
+  }
+
+  for (size_t i = 0; i < leaders.GetCount(); ++i) {
+    Leader &leader = leaders[i];
+    if ((flags[leader.offset] & FUNCTION_ENTRY) == 0) {
+      continue;
+    }
+    leader.state = State{
+        .depth = 0,
+        .minDepth = 0,
+        .frameTop = 0,
+        .frameSize = NO_FRAME,
+        .function = (uint16_t)FindFunctionIndex(leader.offset),
+        .isQueued = true,
+    };
+    pendingLeaders.Add(i);
+  }
+
+  // Leaders are revisited whenever a merge changes their state, or a callee
+  // returns fewer values. Depths are capped, and return counts only
+  // decrease, so this terminates.
+  while (pendingLeaders.IsNotEmpty()) {
+    const size_t leaderIndex = pendingLeaders.Back();
+    pendingLeaders.Pop();
+    leaders[leaderIndex].state.isQueued = false;
+    if (!AnalyzeLeader(leaderIndex)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Walks the instructions from a leader until the next leader, updating the
+// stack state.
+bool ScriptVerifier::AnalyzeLeader(size_t leaderIndex) {
+  size_t offset = leaders[leaderIndex].offset;
+  State state = leaders[leaderIndex].state;
+  state.isQueued = false;
+  FunctionInfo &function = functions[state.function];
+
+  for (;;) {
+    const uint32_t c = data[offset];
+    const size_t length = BC::GetInstructionLength(c);
+    const size_t next = offset + length;
+
+    int pops = 0;
+    int pushes = 0;
+    int minPops = -1;
+    int minPushes = 0;
+    int localIndex = -1;
+    size_t target = 0;
+    bool isConditionalJump = false;
+    bool isConditionalReturn = false;
+
+    switch (c) {
+    case BC::PUSH_CONSTANT_START... BC::PUSH_BYTES_4:
+    case BC::LOAD_GLOBAL_BEGIN... BC::LOAD_GLOBAL_VALUE:
+      pushes = 1;
+      break;
+    case BC::DUP:
+      pops = 1;
+      pushes = 2;
+      break;
+    case BC::LOAD_GLOBAL_INDEX:
+      pops = 1;
+      pushes = 1;
+      break;
+    case BC::STORE_GLOBAL_BEGIN... BC::STORE_GLOBAL_VALUE:
+    case BC::POP:
+      pops = 1;
+      break;
+    case BC::RETURN_IF_ZERO:
+    case BC::RETURN_IF_NOT_ZERO:
+      isConditionalReturn = true;
+      pops = 1;
+      break;
+    case BC::STORE_GLOBAL_INDEX:
+      pops = 2;
+      break;
+    case BC::LOAD_LOCAL_BEGIN... BC::LOAD_LOCAL_END:
+      localIndex = c - BC::LOAD_LOCAL_BEGIN;
+      pushes = 1;
+      break;
+    case BC::LOAD_LOCAL_VALUE:
+      localIndex = data[offset + 1];
+      pushes = 1;
+      break;
+    case BC::LOAD_LOCAL_INDEX:
+      localIndex = data[offset + 1];
+      pops = 1;
+      pushes = 1;
+      break;
+    case BC::STORE_LOCAL_BEGIN... BC::STORE_LOCAL_END:
+      localIndex = c - BC::STORE_LOCAL_BEGIN;
+      pops = 1;
+      break;
+    case BC::STORE_LOCAL_VALUE:
+      localIndex = data[offset + 1];
+      pops = 1;
+      break;
+    case BC::STORE_LOCAL_INDEX:
+      localIndex = data[offset + 1];
+      pops = 2;
+      break;
+    case BC::OPERATOR_START + (int)OP::NOT:
+    case BC::OPERATOR_START + (int)OP::NEGATIVE:
+    case BC::OPERATOR_START + (int)OP::INCREMENT:
+    case BC::OPERATOR_START + (int)OP::DECREMENT:
+      pops = 1;
+      pushes = 1;
+      break;
+    case BC::OPERATOR_START + (int)OP::WRITE_BYTE_INDEX:
+    case BC::OPERATOR_START + (int)OP::WRITE_HALF_WORD_INDEX:
+    case BC::OPERATOR_START + (int)OP::WRITE_WORD_INDEX:
+      pops = 3;
+      break;
+    case BC::OPERATOR_START + (int)OP::MULTIPLY... BC::OPERATOR_START +
+        (int)OP::READ_WORD_INDEX:
+    case BC::OPERATOR_START + (int)OP::READ_HALF_WORD_INDEX:
+      pops = 2;
+      pushes = 1;
+      break;
+    case BC::CALL_INTERNAL:
+      if (functionSignatures) {
+        const ScriptFunctionSignature &signature =
+            functionSignatures[data[offset + 1]];
+        pops = signature.parameterCount;
+        pushes = signature.returnCount;
+        break;
+      }
+      [[fallthrough]];
+    case BC::CALL_VALUE:
+      // Arguments are unknown, so for the upper bound assume nothing is
+      // popped, and for the lower bound that all evaluation values are.
+      pushes = 1;
+      minPops = state.minDepth - state.frameTop;
+      break;
+    case BC::CALL: {
+      target = GetLongTarget(offset);
+      const size_t callee = FindFunctionIndex(target);
+      AddCall(Call{
+          .caller = state.function,
+          .callee = callee,
+          .depth = (size_t)state.depth,
+          .leader = leaderIndex,
+      });
+
+      // Execution continues once the callee has a reachable return, which
+      // revisits this leader.
+      const int16_t returnCount = functions[callee].minReturnCount;
+      if (returnCount == NO_RETURN) {
+        return true;
+      }
+      pushes = 1;
+      minPops = data[target] == BC::ENTER_FUNCTION ? data[target + 1] : 0;
+      minPushes = returnCount;
+      break;
+    }
+    case BC::ENTER_FUNCTION: {
+      const size_t parameterCount = data[offset + 1];
+      const size_t localsCount = data[offset + 2];
+      state.depth += localsCount;
+      state.minDepth += localsCount;
+      state.frameTop = state.depth;
+      state.frameSize = int16_t(parameterCount + localsCount);
+      break;
+    }
+    case BC::RETURN:
+      AddReturn(state);
+      return true;
+    case BC::JUMP_VALUE:
+      // Either returns with no values, or is a tail call.
+      state.minDepth = state.frameTop;
+      AddReturn(state);
+      return true;
+    case BC::NOP:
+      break;
+    case BC::JUMP_SHORT_BEGIN... BC::JUMP_SHORT_END:
+      MergeIntoLeader(next + c + 1 - BC::JUMP_SHORT_BEGIN, state);
+      return true;
+    case BC::JUMP_LONG:
+      MergeIntoLeader(GetLongTarget(offset), state);
+      return true;
+    case BC::JUMP_IF_ZERO_SHORT_BEGIN... BC::JUMP_IF_ZERO_SHORT_END:
+    case BC::JUMP_IF_NOT_ZERO_SHORT_BEGIN... BC::JUMP_IF_NOT_ZERO_SHORT_END:
+      target = next + ((c - BC::JUMP_IF_ZERO_SHORT_BEGIN) & 0x1f) + 1;
+      isConditionalJump = true;
+      pops = 1;
+      break;
+    case BC::JUMP_IF_ZERO_LONG:
+    case BC::JUMP_IF_NOT_ZERO_LONG:
+      target = GetLongTarget(offset);
+      isConditionalJump = true;
+      pops = 1;
+      break;
+    }
+
+    if (localIndex >= 0 &&
+        (state.frameSize == NO_FRAME || localIndex >= state.frameSize)) {
+      return SetError(offset, "Invalid local index");
+    }
+
+    if (minPops < 0) {
+      minPops = pops;
+      minPushes = pushes;
+    }
+    if (state.frameSize != NO_FRAME &&
+        state.minDepth - minPops < state.frameTop) {
+      return SetError(offset, "Stack underflow");
+    }
+
+    int minDepth = state.minDepth - minPops;
+    if (minDepth < 0) {
+      minDepth = 0;
+    }
+    minDepth += minPushes;
+
+    int depth = state.depth - pops;
+    if (depth < 0) {
+      depth = 0;
+    }
+    depth += pushes;
+    if (depth < minDepth) {
+      depth = minDepth;
+    }
+
+    // Cap the depth so that loops that grow the stack terminate.
+    if (depth > (int)MAX_STACK_DEPTH) {
+      function.maxStackDepth = UNBOUNDED_STACK_DEPTH;
+      depth = MAX_STACK_DEPTH + 1;
+    } else if (function.maxStackDepth != UNBOUNDED_STACK_DEPTH &&
+               (size_t)depth > function.maxStackDepth) {
+      function.maxStackDepth = depth;
+    }
+    state.depth = (int16_t)depth;
+    state.minDepth = (int16_t)(minDepth < depth ? minDepth : depth);
+
+    if (isConditionalReturn) {
+      AddReturn(state);
+    }
+    if (isConditionalJump) {
+      MergeIntoLeader(target, state);
+    }
+
+    if (flags[next] & LEADER) {
+      MergeIntoLeader(next, state);
+      return true;
+    }
+    offset = next;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+class ScriptVerifier::StackDepthContext {
+public:
+  StackDepthContext(const ScriptVerifier &verifier) : verifier(verifier) {
+    const size_t count = verifier.functions.GetCount();
+    totals = (size_t *)malloc(count * sizeof(size_t));
+    states = (uint8_t *)malloc(count);
+    Mem::Clear(states, count);
+  }
+  ~StackDepthContext() {
+    free(totals);
+    free(states);
+  }
+
+  size_t GetTotal(size_t function) {
+    if (states[function] == DONE) {
+      return totals[function];
+    }
+    if (states[function] == IN_PROGRESS) {
+      // Recursion.
+      return UNBOUNDED_STACK_DEPTH;
+    }
+    states[function] = IN_PROGRESS;
+
+    size_t total = verifier.functions[function].maxStackDepth;
+    for (const Call &call : verifier.calls) {
+      if (total == UNBOUNDED_STACK_DEPTH) {
+        break;
+      }
+      if (call.caller != function) {
+        continue;
+      }
+      const size_t calleeTotal = GetTotal(call.callee);
+      if (calleeTotal == UNBOUNDED_STACK_DEPTH) {
+        total = UNBOUNDED_STACK_DEPTH;
+      } else if (call.depth + calleeTotal > total) {
+        total = call.depth + calleeTotal;
+      }
+    }
+
+    states[function] = DONE;
+    totals[function] = total;
+    return total;
+  }
+
+private:
+  static constexpr uint8_t IN_PROGRESS = 1;
+  static constexpr uint8_t DONE = 2;
+
+  const ScriptVerifier &verifier;
+  size_t *totals;
+  uint8_t *states;
+};
+
+void ScriptVerifier::ComputeMaxStackDepth() {
+  if (hasDynamicCall) {
+    maxStackDepth = UNBOUNDED_STACK_DEPTH;
+    return;
+  }
+
+  StackDepthContext context(*this);
+  maxStackDepth = 0;
+  for (size_t i = 0; i < functions.GetCount(); ++i) {
+    const size_t total = context.GetTotal(i);
+    if (total == UNBOUNDED_STACK_DEPTH) {
+      maxStackDepth = UNBOUNDED_STACK_DEPTH;
+      return;
+    }
+    if (total > maxStackDepth) {
+      maxStackDepth = total;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+
+bool ScriptVerifier::IsVerified(
+    const ScriptByteCode *byteCode, size_t functionCount,
+    const ScriptFunctionSignature *functionSignatures) {
+  struct VerifiedScript {
+    uint32_t crc;
+    uint32_t functionCount;
+    const ScriptFunctionSignature *functionSignatures;
+    bool isVerified;
+  };
+  static constexpr size_t CACHE_SIZE = 4;
+  static VerifiedScript cache[CACHE_SIZE];
+  static size_t cacheCount = 0;
+
+  // Crc() requires a valid string hash table offset.
+  if (!byteCode->IsValid() ||
+      byteCode->stringHashTableOffset < sizeof(ScriptByteCode)) {
+    return false;
+  }
+
+  const uint32_t crc = byteCode->Crc();
+  const size_t count =
+      cacheCount < CACHE_SIZE ? cacheCount : CACHE_SIZE;
+  for (size_t i = 0; i < count; ++i) {
+    if (cache[i].crc == crc && cache[i].functionCount == functionCount &&
+        cache[i].functionSignatures == functionSignatures) {
+      return cache[i].isVerified;
+    }
+  }
+
+  ScriptVerifier verifier(byteCode, functionCount, functionSignatures);
+  const bool isVerified = verifier.Verify();
+  cache[cacheCount++ % CACHE_SIZE] = VerifiedScript{
+      .crc = crc,
+      .functionCount = (uint32_t)functionCount,
+      .functionSignatures = functionSignatures,
+      .isVerified = isVerified,
+  };
+  return isVerified;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "unit_test.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+// func main() {
+//   var x = add1(5);
+//   g0 = x;
+// }
+// func add1(v) { return v + 1; }
+alignas(4) static const uint8_t CALL_BYTE_CODE[] = {
+    0x4a, 0x53, 0x53, 0x34, // Magic
+    0x1c, 0x00,             // String hash table offset
+    0x0a, 0x00, 0x00, 0x00, // Script offsets
+    0x94, 0x00, 0x01,       // 10: ENTER_FUNCTION 0, 1
+    0x05,                   // 13: push 5
+    0x91, 0x15, 0x00,       // 14: CALL 21
+    0x60,                   // 17: x = pop
+    0x50,                   // 18: push x
+    0x48,                   // 19: g0 = pop
+    0x92,                   // 20: return
+    0x94, 0x01, 0x00,       // 21: ENTER_FUNCTION 1, 0
+    0x50, 0x01, 0x75,       // 24: push v + 1
+    0x92,                   // 27: return
+    0x00, 0x00,             // 28: String hash table
+};
+
+TEST_BEGIN("ScriptVerifier: Accepts valid byte code") {
+  ScriptVerifier verifier((const ScriptByteCode *)CALL_BYTE_CODE, 0);
+  assert(verifier.Verify());
+
+  const List<ScriptVerifier::FunctionInfo> &functions =
+      verifier.GetFunctions();
+  assert(functions.GetCount() == 2);
+  assert(functions[0].offset == 10);
+  assert(functions[0].maxStackDepth == 3);
+  assert(functions[1].offset == 21);
+  assert(functions[1].maxStackDepth == 2);
+  assert(functions[1].minReturnCount == 1);
+  assert(verifier.GetMaxStackDepth() == 4);
+}
+TEST_END
+
+TEST_BEGIN("ScriptVerifier: Rejects stack underflow after a call") {
+  alignas(4) uint8_t byteCode[sizeof(CALL_BYTE_CODE)];
+  memcpy(byteCode, CALL_BYTE_CODE, sizeof(byteCode));
+  byteCode[24] = 0x9f; // add1 returns nothing
+  byteCode[25] = 0x9f;
+  byteCode[26] = 0x9f;
+
+  ScriptVerifier verifier((const ScriptByteCode *)byteCode, 0);
+  assert(!verifier.Verify());
+  assert(verifier.GetErrorOffset() == 17);
+  assert(strcmp(verifier.GetErrorMessage(), "Stack underflow") == 0);
+}
+TEST_END
+
+TEST_BEGIN("ScriptVerifier: Rejects invalid byte code") {
+  struct Patch {
+    size_t offset;
+    uint8_t bytes[3];
+    size_t length;
+    const char *errorMessage;
+  };
+  static const Patch PATCHES[] = {
+      {13, {0x8d}, 1, "Invalid instruction"},
+      {15, {0x40}, 1, "Call outside code"},
+      {17, {0x61}, 1, "Invalid local index"},
+      {24, {0x93}, 1, "Stack underflow"},
+      {18, {0xbf, 0x0f, 0x00}, 3, "Jump into instruction"},
+      {18, {0xbf, 0x1c, 0x00}, 3, "Jump outside code"},
+      {14, {0x90, 0x00, 0x9f}, 3, "Invalid internal function"},
+  };
+
+  for (const Patch &patch : PATCHES) {
+    alignas(4) uint8_t byteCode[sizeof(CALL_BYTE_CODE)];
+    memcpy(byteCode, CALL_BYTE_CODE, sizeof(byteCode));
+    memcpy(byteCode + patch.offset, patch.bytes, patch.length);
+
+    ScriptVerifier verifier((const ScriptByteCode *)byteCode, 0);
+    assert(!verifier.Verify());
+    assert(strcmp(verifier.GetErrorMessage(), patch.errorMessage) == 0);
+  }
+}
+TEST_END
+
+TEST_BEGIN("ScriptVerifier: Checks internal function count") {
+  alignas(4) uint8_t byteCode[sizeof(CALL_BYTE_CODE)];
+  memcpy(byteCode, CALL_BYTE_CODE, sizeof(byteCode));
+  byteCode[14] = 0x90; // CALL_INTERNAL 0
+  byteCode[15] = 0x00;
+  byteCode[16] = 0x9f; // NOP
+  byteCode[17] = 0x9f; // The internal function may consume the 5.
+
+  const ScriptByteCode *script = (const ScriptByteCode *)byteCode;
+  assert(!ScriptVerifier::IsVerified(script, 0));
+  assert(ScriptVerifier::IsVerified(script, 1));
+
+  // Cached results are keyed by both the Crc and the function count.
+  assert(!ScriptVerifier::IsVerified(script, 0));
+  assert(ScriptVerifier::IsVerified(script, 1));
+}
+TEST_END
+
+TEST_BEGIN("ScriptVerifier: Internal call results can be used in a frame") {
+  alignas(4) uint8_t byteCode[sizeof(CALL_BYTE_CODE)];
+  memcpy(byteCode, CALL_BYTE_CODE, sizeof(byteCode));
+  byteCode[14] = 0x90; // x = CALL_INTERNAL 0 (5)
+  byteCode[15] = 0x00;
+  byteCode[16] = 0x9f; // NOP
+
+  // Without a signature, the internal function may consume the 5, so
+  // storing x is an underflow.
+  ScriptVerifier unknownVerifier((const ScriptByteCode *)byteCode, 1);
+  assert(!unknownVerifier.Verify());
+  assert(unknownVerifier.GetErrorOffset() == 17);
+
+  static const ScriptFunctionSignature ADD1_SIGNATURE[] = {{1, 1}};
+  ScriptVerifier verifier((const ScriptByteCode *)byteCode, 1,
+                          ADD1_SIGNATURE);
+  assert(verifier.Verify());
+  assert(verifier.GetFunctions()[0].maxStackDepth == 2);
+
+  static const ScriptFunctionSignature NO_RETURN_SIGNATURE[] = {{1, 0}};
+  ScriptVerifier noReturnVerifier((const ScriptByteCode *)byteCode, 1,
+                                  NO_RETURN_SIGNATURE);
+  assert(!noReturnVerifier.Verify());
+  assert(noReturnVerifier.GetErrorOffset() == 17);
+  assert(strcmp(noReturnVerifier.GetErrorMessage(), "Stack underflow") == 0);
+}
+TEST_END
+
+TEST_BEGIN("ScriptVerifier: Recursion has unbounded stack depth") {
+  alignas(4) uint8_t byteCode[sizeof(CALL_BYTE_CODE)];
+  memcpy(byteCode, CALL_BYTE_CODE, sizeof(byteCode));
+  byteCode[15] = 0x0a; // CALL 10
+
+  ScriptVerifier verifier((const ScriptByteCode *)byteCode, 0);
+  assert(verifier.Verify());
+  assert(verifier.GetMaxStackDepth() == ScriptVerifier::UNBOUNDED_STACK_DEPTH);
+}
+TEST_END
+
+TEST_BEGIN("ScriptVerifier: Rejects empty script header") {
+  alignas(4) static const uint8_t EMPTY_SCRIPT[] = {
+      0x4a, 0x53, 0x53, 0x34, // Magic
+      0x00, 0x00,             // String hash table offset
+      0x00, 0x00, 0x00, 0x00,
+  };
+  assert(!ScriptVerifier::IsVerified((const ScriptByteCode *)EMPTY_SCRIPT, 0));
+}
+TEST_END
+
+//---------------------------------------------------------------------------
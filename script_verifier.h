@@ -0,0 +1,144 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "container/list.h"
+#include "script_byte_code.h"
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+// Checks at load time that script byte code is safe to run without stack and
+// offset checks. For all instructions reachable from the script entry points
+// and direct calls, it verifies that:
+//  - Instructions are valid and lie entirely within the code.
+//  - Jump and call targets are within the code, and do not land inside
+//    another instruction.
+//  - Local variable indices are within the frame set up by ENTER_FUNCTION,
+//    and evaluation never pops into the frame.
+//  - CALL_INTERNAL function indices are within the function table.
+//
+// Global indices are always in range, since they are encoded as a byte.
+//
+// The stack depth is tracked as a lower and an upper bound. A call to a
+// script function pops the callee's parameters, and pushes at least as many
+// values as any reachable return of the callee leaves. An internal call pops
+// and pushes the counts in its function signature. Dynamic calls, and
+// internal calls without signatures, are assumed to consume any evaluation
+// values, but not the frame, and to push at most one value.
+//
+// The maximum stack depth of each function is also computed from the upper
+// bounds.
+class ScriptVerifier {
+public:
+  ScriptVerifier(const ScriptByteCode *byteCode, size_t functionCount,
+                 const ScriptFunctionSignature *functionSignatures = nullptr);
+  ~ScriptVerifier();
+
+  bool Verify();
+
+  size_t GetErrorOffset() const { return errorOffset; }
+  const char *GetErrorMessage() const { return errorMessage; }
+
+  struct FunctionInfo {
+    size_t offset;
+    size_t maxStackDepth;
+
+    // Lower bound on the number of values returned, or NO_RETURN if no
+    // return has been reached.
+    int16_t minReturnCount;
+  };
+  const List<FunctionInfo> &GetFunctions() const { return functions; }
+
+  // Returns the maximum stack depth, including nested calls, or
+  // UNBOUNDED_STACK_DEPTH if there is recursion or a dynamic call.
+  size_t GetMaxStackDepth() const { return maxStackDepth; }
+
+  // Returns whether the byte code verifies. Results are cached by Crc so that
+  // reloading the same script does not verify it again.
+  static bool
+  IsVerified(const ScriptByteCode *byteCode, size_t functionCount,
+             const ScriptFunctionSignature *functionSignatures = nullptr);
+
+  static constexpr size_t MAX_STACK_DEPTH = 256;
+  static constexpr size_t UNBOUNDED_STACK_DEPTH = (size_t)-1;
+  static constexpr int16_t NO_RETURN = INT16_MAX;
+
+private:
+  class StackDepthContext;
+
+  struct State {
+    int16_t depth;
+    int16_t minDepth;
+    int16_t frameTop;
+    int16_t frameSize;
+    uint16_t function;
+    bool isQueued;
+
+    bool Merge(const State &incoming);
+  };
+
+  struct Leader {
+    size_t offset;
+    State state;
+  };
+
+  struct Call {
+    size_t caller;
+    size_t callee;
+    size_t depth;
+    size_t leader;
+  };
+
+  static constexpr uint8_t INSTRUCTION_START = 1;
+  static constexpr uint8_t INSTRUCTION_OPERAND = 2;
+  static constexpr uint8_t LEADER = 4;
+  static constexpr uint8_t FUNCTION_ENTRY = 8;
+
+  static constexpr int16_t NO_FRAME = -1;
+
+  const ScriptByteCode *const byteCode;
+  const uint8_t *const data;
+  const size_t functionCount;
+  const ScriptFunctionSignature *const functionSignatures;
+  size_t codeStart;
+  size_t codeEnd;
+  uint8_t *flags = nullptr;
+
+  size_t errorOffset = 0;
+  const char *errorMessage = nullptr;
+  size_t maxStackDepth = 0;
+  bool hasDynamicCall = false;
+
+  List<Leader> leaders;
+  List<FunctionInfo> functions;
+  List<Call> calls;
+  List<size_t> pendingLeaders;
+
+  bool VerifyHeader();
+  bool DecodeInstructions();
+  bool AnalyzeStack();
+  bool AnalyzeLeader(size_t leaderIndex);
+  void ComputeMaxStackDepth();
+
+  bool SetError(size_t offset, const char *message) {
+    errorOffset = offset;
+    errorMessage = message;
+    return false;
+  }
+
+  bool IsInCode(size_t offset) const {
+    return codeStart <= offset && offset < codeEnd;
+  }
+  size_t GetLongTarget(size_t offset) const {
+    return data[offset + 1] + (data[offset + 2] << 8);
+  }
+  Leader *FindLeader(size_t offset);
+  size_t FindFunctionIndex(size_t offset) const;
+  void MergeIntoLeader(size_t offset, const State &state);
+  void QueueLeader(size_t leaderIndex);
+  void AddCall(const Call &call);
+  void AddReturn(const State &state);
+};
+
+//---------------------------------------------------------------------------
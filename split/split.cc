@@ -99,6 +99,65 @@ uint8_t *TxBuffer::Add(SplitHandlerId id, size_t length) {
   return result;
 }
 
+bool TxBuffer::Add(SplitHandlerId id, const SplitTxSpan *spans,
+                   size_t spanCount) {
+  size_t length = 0;
+  for (size_t i = 0; i < spanCount; ++i) {
+    length += spans[i].length;
+  }
+
+  uint8_t *target = Add(id, length);
+  if (!target) {
+    return false;
+  }
+
+  for (size_t i = 0; i < spanCount; ++i) {
+    memcpy(target, spans[i].data, spans[i].length);
+    target += spans[i].length;
+  }
+  return true;
+}
+
+size_t TxBuffer::GetAvailablePacketLength() const {
+  // One word is needed for the block header.
+  const size_t availableWords =
+      JAVELIN_SPLIT_TX_RX_BUFFER_SIZE - header.wordCount;
+  if (availableWords <= 1) {
+    return 0;
+  }
+  const size_t length = (availableWords - 1) * sizeof(uint32_t);
+
+  // Block lengths are 16 bits.
+  return length > 0xffff ? 0xffff : length;
+}
+
+void SplitTxGatherHandler::UpdateBuffer(TxBuffer &buffer) {
+  SplitTxSpan spans[MAXIMUM_SPAN_COUNT];
+  size_t spanCount = GetSpans(spans);
+  if (spanCount == 0) [[likely]] {
+    return;
+  }
+
+  // Trim the spans to what fits.
+  size_t remaining = buffer.GetAvailablePacketLength();
+  size_t length = 0;
+  for (size_t i = 0; i < spanCount; ++i) {
+    if (spans[i].length >= remaining) {
+      spans[i].length = remaining;
+      spanCount = i + 1;
+    }
+    remaining -= spans[i].length;
+    length += spans[i].length;
+  }
+  if (length == 0) {
+    return;
+  }
+
+  if (buffer.Add(GetHandlerId(), spans, spanCount)) {
+    OnSpansSent(length);
+  }
+}
+
 void TxBuffer::Handlers::OnConnect() const {
   for (SplitTxHandler *handler : *this) {
     handler->OnTransmitConnected();
@@ -111,6 +170,12 @@ void TxBuffer::Handlers::OnConnectionReset() const {
   }
 }
 
+void TxBuffer::Handlers::OnAcknowledged() const {
+  for (SplitTxHandler *handler : *this) {
+    handler->OnTransmitAcknowledged();
+  }
+}
+
 //---------------------------------------------------------------------------
 
 RxBufferValidateResult RxBuffer::Validate(size_t totalWordsReceived,
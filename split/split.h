@@ -68,6 +68,11 @@ struct TxRxHeader {
 class SplitTxHandler;
 class SplitRxHandler;
 
+struct SplitTxSpan {
+  const void *data;
+  size_t length;
+};
+
 class TxBuffer {
 public:
   TxBuffer() { header.magic = TxRxHeader::MAGIC; }
@@ -75,6 +80,12 @@ public:
   void Reset() { header.wordCount = 0; }
   bool Add(SplitHandlerId id, const void *data, size_t length);
   uint8_t *Add(SplitHandlerId id, size_t length);
+
+  // Adds a single packet gathered from spans.
+  bool Add(SplitHandlerId id, const SplitTxSpan *spans, size_t spanCount);
+
+  // Returns the largest packet length that can be added.
+  size_t GetAvailablePacketLength() const;
   uint8_t *Reserve(size_t length);
   void Build(bool updateHash);
   void BuildEmpty();
@@ -88,11 +99,15 @@ public:
   static void OnConnectionReset() { handlers.OnConnectionReset(); }
   static void OnConnect() { handlers.OnConnect(); }
 
+  // Called when the pair has validated the last transmitted buffer.
+  static void OnAcknowledged() { handlers.OnAcknowledged(); }
+
   struct Handlers
       : public FastIterableStaticList<SplitTxHandler *,
                                       (size_t)SplitHandlerId::COUNT> {
     void OnConnect() const;
     void OnConnectionReset() const;
+    void OnAcknowledged() const;
   };
 
   static Handlers handlers;
@@ -129,9 +144,31 @@ class SplitTxHandler {
 public:
   virtual void OnTransmitConnected() {}
   virtual void OnTransmitConnectionReset() {}
+  virtual void OnTransmitAcknowledged() {}
   virtual void UpdateBuffer(TxBuffer &buffer) = 0;
 };
 
+// A tx handler whose pending data is exposed as spans, which are copied
+// straight into the TxBuffer without intermediate buffering. When the
+// TxBuffer is nearly full, only the data that fits is sent, and the
+// remainder is sent in the next exchange.
+class SplitTxGatherHandler : public SplitTxHandler {
+public:
+  void UpdateBuffer(TxBuffer &buffer) final;
+
+protected:
+  static constexpr size_t MAXIMUM_SPAN_COUNT = 4;
+
+  virtual SplitHandlerId GetHandlerId() const = 0;
+
+  // Returns the number of spans of pending data.
+  virtual size_t GetSpans(SplitTxSpan *spans) = 0;
+
+  // Called after byteCount bytes from the front of the spans have been
+  // added to the TxBuffer.
+  virtual void OnSpansSent(size_t byteCount) = 0;
+};
+
 class SplitRxHandler {
 public:
   virtual void OnReceiveConnected() {}
@@ -0,0 +1,273 @@
+//---------------------------------------------------------------------------
+
+#include "split_delta.h"
+
+//---------------------------------------------------------------------------
+
+size_t SplitDelta::Encode(uint8_t *target, size_t capacity,
+                          const uint8_t *data, const uint8_t *reference,
+                          size_t length) {
+  size_t targetLength = 0;
+  size_t offset = 0;
+
+  for (;;) {
+    // Find the next changed byte.
+    size_t start = offset;
+    while (offset < length && data[offset] == reference[offset]) {
+      ++offset;
+    }
+    if (offset == length) {
+      // Trailing unchanged bytes are implicit.
+      return targetLength;
+    }
+
+    while (offset - start > 128) {
+      if (targetLength >= capacity) {
+        return 0;
+      }
+      target[targetLength++] = 0x7f;
+      start += 128;
+    }
+    if (offset != start) {
+      if (targetLength >= capacity) {
+        return 0;
+      }
+      target[targetLength++] = offset - start - 1;
+    }
+
+    // Collect changed bytes. Single unchanged bytes are included in the
+    // literal, since a skip would cost the same and break the run.
+    start = offset;
+    size_t end = offset;
+    while (end < length && end - start < 128) {
+      if (data[end] != reference[end]) {
+        ++end;
+      } else if (end + 1 < length && end - start + 1 < 128 &&
+                 data[end + 1] != reference[end + 1]) {
+        end += 2;
+      } else {
+        break;
+      }
+    }
+
+    const size_t literalLength = end - start;
+    if (targetLength + 1 + literalLength > capacity) {
+      return 0;
+    }
+    target[targetLength++] = 0x7f + literalLength;
+    for (size_t i = start; i < end; ++i) {
+      target[targetLength++] = data[i] ^ reference[i];
+    }
+    offset = end;
+  }
+}
+
+bool SplitDelta::Apply(uint8_t *data, size_t length, const uint8_t *delta,
+                       size_t deltaLength) {
+  size_t offset = 0;
+  const uint8_t *const deltaEnd = delta + deltaLength;
+  while (delta < deltaEnd) {
+    const uint8_t control = *delta++;
+    if (control < 0x80) {
+      offset += control + 1;
+      if (offset > length) {
+        return false;
+      }
+      continue;
+    }
+
+    const size_t literalLength = control - 0x7f;
+    if (offset + literalLength > length ||
+        literalLength > size_t(deltaEnd - delta)) {
+      return false;
+    }
+    for (size_t i = 0; i < literalLength; ++i) {
+      data[offset++] ^= *delta++;
+    }
+  }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "../unit_test.h"
+#include <stdio.h>
+
+#define DO_PROFILE_TEST 0
+
+//---------------------------------------------------------------------------
+
+TEST_BEGIN("SplitDelta: Encode and apply round trip") {
+  uint8_t reference[300];
+  uint8_t data[300];
+  for (size_t i = 0; i < sizeof(data); ++i) {
+    reference[i] = i * 7;
+    data[i] = reference[i];
+  }
+  data[0] ^= 1;
+  data[2] ^= 2;
+  data[200] ^= 3;
+  for (size_t i = 250; i < 290; ++i) {
+    data[i] = 0x55;
+  }
+
+  uint8_t delta[sizeof(data)];
+  const size_t deltaLength =
+      SplitDelta::Encode(delta, sizeof(delta), data, reference, sizeof(data));
+  assert(deltaLength != 0 && deltaLength < 60);
+
+  assert(SplitDelta::Apply(reference, sizeof(reference), delta, deltaLength));
+  assert(memcmp(reference, data, sizeof(data)) == 0);
+
+  // Too small a buffer fails instead of overrunning.
+  uint8_t original[300];
+  memset(original, 0, sizeof(original));
+  assert(SplitDelta::Encode(delta, 10, data, original, sizeof(data)) == 0);
+}
+TEST_END
+
+// Loops a 128x32 monochrome display buffer and a 64 LED RGB array through
+// the encoder and decoder, with a sprite moving across the display and a
+// single LED chasing along the strip.
+TEST_BEGIN("SplitDelta: Loopback bytes per frame") {
+  constexpr size_t DISPLAY_SIZE = 128 * 32 / 8;
+  constexpr size_t RGB_SIZE = 64 * 3;
+  constexpr size_t FRAME_COUNT = 1000;
+
+  static SplitDeltaEncoder<DISPLAY_SIZE> displayEncoder;
+  static SplitDeltaDecoder<DISPLAY_SIZE> displayDecoder;
+  static SplitDeltaEncoder<RGB_SIZE> rgbEncoder;
+  static SplitDeltaDecoder<RGB_SIZE> rgbDecoder;
+
+  uint8_t display[DISPLAY_SIZE];
+  uint8_t rgb[RGB_SIZE];
+  uint8_t packet[SplitDeltaEncoder<DISPLAY_SIZE>::MAX_PACKET_SIZE];
+
+  size_t totalBytes = 0;
+  for (size_t frame = 0; frame < FRAME_COUNT; ++frame) {
+    memset(display, 0, sizeof(display));
+    for (size_t x = 0; x < 64; ++x) {
+      display[x] = x * 13; // Static text on the first page.
+    }
+    const size_t spriteX = frame % 120;
+    memset(display + 2 * 128 + spriteX, 0xff, 8);
+
+    memset(rgb, 0x10, sizeof(rgb));
+    memset(rgb + 3 * (frame % 64), 0xff, 3);
+
+    size_t length = displayEncoder.Encode(packet, display);
+    totalBytes += length;
+    if (length != 0) {
+      assert(displayDecoder.Process(packet, length));
+    }
+    assert(memcmp(displayDecoder.GetFrame(), display, sizeof(display)) == 0);
+
+    length = rgbEncoder.Encode(packet, rgb);
+    totalBytes += length;
+    if (length != 0) {
+      assert(rgbDecoder.Process(packet, length));
+    }
+    assert(memcmp(rgbDecoder.GetFrame(), rgb, sizeof(rgb)) == 0);
+
+    // Every tenth exchange is not acknowledged, which forces full frames.
+    if (frame % 10 != 9) {
+      displayEncoder.Acknowledge();
+      rgbEncoder.Acknowledge();
+    }
+  }
+
+  const size_t fullBytes = FRAME_COUNT * (DISPLAY_SIZE + RGB_SIZE);
+#if DO_PROFILE_TEST
+  printf("[PROFILE] Split frames: full %zu bytes/frame, delta %zu "
+         "bytes/frame\n",
+         fullBytes / FRAME_COUNT, totalBytes / FRAME_COUNT);
+#endif
+  assert(totalBytes < fullBytes / 4);
+}
+TEST_END
+
+TEST_BEGIN("SplitDelta: Unchanged frames are resent periodically") {
+  constexpr size_t SIZE = 32;
+  constexpr size_t INTERVAL = SplitDeltaEncoder<SIZE>::FULL_FRAME_INTERVAL;
+  SplitDeltaEncoder<SIZE> encoder;
+  const uint8_t data[SIZE] = {};
+  uint8_t packet[SplitDeltaEncoder<SIZE>::MAX_PACKET_SIZE];
+
+  size_t fullFrameCount = 0;
+  for (size_t i = 0; i < 2 * INTERVAL; ++i) {
+    const size_t length = encoder.Encode(packet, data);
+    if (length != 0) {
+      assert(length == SplitDeltaEncoder<SIZE>::MAX_PACKET_SIZE);
+      ++fullFrameCount;
+      encoder.Acknowledge();
+    }
+  }
+
+  // The first frame, then one every interval.
+  assert(fullFrameCount == 3);
+}
+TEST_END
+
+TEST_BEGIN("SplitDelta: Decoder rejects deltas against a different frame") {
+  constexpr size_t SIZE = 32;
+  SplitDeltaEncoder<SIZE> encoder;
+  SplitDeltaDecoder<SIZE> decoder;
+  uint8_t data[SIZE] = {};
+  uint8_t packet[SplitDeltaEncoder<SIZE>::MAX_PACKET_SIZE];
+
+  size_t length = encoder.Encode(packet, data);
+  assert(length == SplitDeltaEncoder<SIZE>::MAX_PACKET_SIZE);
+  assert(decoder.Process(packet, length));
+  encoder.Acknowledge();
+
+  // A lost delta means the next delta's base does not match.
+  data[1] = 1;
+  length = encoder.Encode(packet, data);
+  assert(length < SplitDeltaEncoder<SIZE>::MAX_PACKET_SIZE);
+  encoder.Acknowledge();
+  data[2] = 2;
+  length = encoder.Encode(packet, data);
+  assert(!decoder.Process(packet, length));
+  assert(!decoder.HasFrame());
+
+  // After a reset, the next frame is full.
+  encoder.Reset();
+  length = encoder.Encode(packet, data);
+  assert(length == SplitDeltaEncoder<SIZE>::MAX_PACKET_SIZE);
+  assert(decoder.Process(packet, length));
+  assert(memcmp(decoder.GetFrame(), data, SIZE) == 0);
+}
+TEST_END
+
+TEST_BEGIN("SplitDelta: Rejected deltas are followed by a full frame") {
+  constexpr size_t SIZE = 32;
+  SplitDeltaEncoder<SIZE> encoder;
+  uint8_t data[SIZE] = {};
+  uint8_t packet[SplitDeltaEncoder<SIZE>::MAX_PACKET_SIZE];
+
+  assert(encoder.Encode(packet, data) ==
+         SplitDeltaEncoder<SIZE>::MAX_PACKET_SIZE);
+  encoder.Acknowledge();
+
+  data[1] = 1;
+  assert(encoder.Encode(packet, data) <
+         SplitDeltaEncoder<SIZE>::MAX_PACKET_SIZE);
+  encoder.Acknowledge();
+  const uint8_t rejectedSequence = ((SplitDeltaHeader *)packet)->sequence;
+
+  encoder.Reject(rejectedSequence);
+  data[2] = 2;
+  assert(encoder.Encode(packet, data) ==
+         SplitDeltaEncoder<SIZE>::MAX_PACKET_SIZE);
+  encoder.Acknowledge();
+
+  // A rejection of a frame sent before the full frame is stale.
+  encoder.Reject(rejectedSequence);
+  data[3] = 3;
+  assert(encoder.Encode(packet, data) <
+         SplitDeltaEncoder<SIZE>::MAX_PACKET_SIZE);
+}
+TEST_END
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,275 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "split.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+// XOR + run-length coding of a buffer against a reference buffer.
+//
+// The encoded data is a sequence of runs, each starting with a control byte:
+//  - 0x00-0x7f: Skip control + 1 unchanged bytes.
+//  - 0x80-0xff: control - 0x7f bytes follow, which are XORed into the data.
+// Bytes after the last run are unchanged.
+class SplitDelta {
+public:
+  // Returns the encoded length, or 0 if the encoding would not fit in
+  // capacity.
+  static size_t Encode(uint8_t *target, size_t capacity, const uint8_t *data,
+                       const uint8_t *reference, size_t length);
+
+  // Returns false if the encoding is malformed, in which case data may be
+  // partially updated.
+  static bool Apply(uint8_t *data, size_t length, const uint8_t *delta,
+                    size_t deltaLength);
+};
+
+//---------------------------------------------------------------------------
+
+struct SplitDeltaHeader {
+  enum class Format : uint8_t {
+    FULL,
+    DELTA,
+  };
+
+  Format format;
+  uint8_t sequence;
+
+  // For deltas, the sequence of the frame the delta applies to.
+  uint8_t baseSequence;
+  uint8_t reserved;
+};
+
+// Sends fixed size frames, such as display buffers or RGB arrays, as deltas
+// against the last frame the pair acknowledged. Full frames are sent
+// after a connection reset, whenever the previous frame was not
+// acknowledged, after the pair rejects a delta, when a delta would be
+// larger, and every FULL_FRAME_INTERVAL frames, whether or not they changed,
+// so that a receiver that missed a frame recovers.
+template <size_t SIZE> class SplitDeltaEncoder {
+public:
+  static constexpr size_t MAX_PACKET_SIZE = sizeof(SplitDeltaHeader) + SIZE;
+  static constexpr size_t FULL_FRAME_INTERVAL = 64;
+
+  // Writes a packet for data to target, returning the packet length, or 0
+  // if the data is unchanged since the acknowledged frame.
+  size_t Encode(uint8_t *target, const void *data) {
+    const bool isFullFrameDue = ++framesSinceFullFrame >= FULL_FRAME_INTERVAL;
+    if (!isFullFrameDue && hasReference && !hasPendingFrame &&
+        memcmp(data, reference, SIZE) == 0) {
+      return 0;
+    }
+
+    SplitDeltaHeader &header = *(SplitDeltaHeader *)target;
+    uint8_t *payload = target + sizeof(SplitDeltaHeader);
+    header.sequence = ++sequence;
+    header.reserved = 0;
+
+    size_t payloadLength = 0;
+    if (isFullFrameDue) {
+      framesSinceFullFrame = 0;
+    } else if (hasReference && !hasPendingFrame) {
+      payloadLength = SplitDelta::Encode(payload, SIZE - 1,
+                                         (const uint8_t *)data, reference,
+                                         SIZE);
+    }
+    if (payloadLength != 0) {
+      header.format = SplitDeltaHeader::Format::DELTA;
+      header.baseSequence = referenceSequence;
+    } else {
+      header.format = SplitDeltaHeader::Format::FULL;
+      header.baseSequence = 0;
+      memcpy(payload, data, SIZE);
+      payloadLength = SIZE;
+      fullFrameSequence = sequence;
+    }
+
+    memcpy(pending, data, SIZE);
+    hasPendingFrame = true;
+    return sizeof(SplitDeltaHeader) + payloadLength;
+  }
+
+  bool Add(TxBuffer &buffer, SplitHandlerId id, const void *data) {
+    uint8_t *target = buffer.Reserve(MAX_PACKET_SIZE);
+    if (!target) {
+      return false;
+    }
+    const size_t length = Encode(target, data);
+    if (length != 0) {
+      buffer.Add(id, length);
+    }
+    return true;
+  }
+
+  // Called when the pair has received the last encoded frame.
+  void Acknowledge() {
+    if (!hasPendingFrame) {
+      return;
+    }
+    memcpy(reference, pending, SIZE);
+    referenceSequence = sequence;
+    hasReference = true;
+    hasPendingFrame = false;
+  }
+
+  // Forces the next frame to be sent in full.
+  void Reset() {
+    hasReference = false;
+    hasPendingFrame = false;
+  }
+
+  // Called when the pair could not apply the frame with rejectedSequence.
+  // Rejections of frames sent before the last full frame are stale, and
+  // are ignored.
+  void Reject(uint8_t rejectedSequence) {
+    if (int8_t(rejectedSequence - fullFrameSequence) > 0) {
+      Reset();
+    }
+  }
+
+private:
+  bool hasReference = false;
+  bool hasPendingFrame = false;
+  uint8_t sequence = 0;
+  uint8_t fullFrameSequence = 0;
+  uint8_t referenceSequence = 0;
+  uint8_t framesSinceFullFrame = 0;
+  uint8_t reference[SIZE];
+  uint8_t pending[SIZE];
+};
+
+template <size_t SIZE> class SplitDeltaDecoder {
+public:
+  // Returns true if the frame was updated.
+  bool Process(const void *packet, size_t length) {
+    if (length < sizeof(SplitDeltaHeader)) {
+      return false;
+    }
+    const SplitDeltaHeader &header = *(const SplitDeltaHeader *)packet;
+    const uint8_t *payload = (const uint8_t *)packet + sizeof(header);
+    const size_t payloadLength = length - sizeof(header);
+
+    switch (header.format) {
+    case SplitDeltaHeader::Format::FULL:
+      if (payloadLength != SIZE) {
+        return false;
+      }
+      memcpy(frame, payload, SIZE);
+      break;
+
+    case SplitDeltaHeader::Format::DELTA:
+      if (!hasFrame || header.baseSequence != sequence ||
+          !SplitDelta::Apply(frame, SIZE, payload, payloadLength)) {
+        // Wait for the next full frame.
+        hasFrame = false;
+        return false;
+      }
+      break;
+
+    default:
+      return false;
+    }
+
+    sequence = header.sequence;
+    hasFrame = true;
+    return true;
+  }
+
+  void Reset() { hasFrame = false; }
+
+  bool HasFrame() const { return hasFrame; }
+  const uint8_t *GetFrame() const { return frame; }
+
+private:
+  bool hasFrame = false;
+  uint8_t sequence = 0;
+  uint8_t frame[SIZE];
+};
+
+//---------------------------------------------------------------------------
+
+// Split handlers for frames sent through SplitDeltaEncoder, which the display
+// and RGB handlers derive from. The transport reports acknowledged buffers
+// and connection resets through TxBuffer.
+//
+// A buffer can be acknowledged even though the receiver rejected a frame in
+// it, e.g. a delta against a frame it no longer has. The receiver reports
+// the rejected sequence in a packet with the same handler id, so each side
+// registers its handler for both directions with RegisterHandlers().
+template <size_t SIZE>
+class SplitDeltaTxHandler : public SplitTxHandler, public SplitRxHandler {
+public:
+  void RegisterHandlers() {
+    Split::RegisterTxHandler(this);
+    Split::RegisterRxHandler(GetHandlerId(), this);
+  }
+
+  void OnTransmitConnectionReset() override { encoder.Reset(); }
+  void OnTransmitAcknowledged() override { encoder.Acknowledge(); }
+
+  void OnDataReceived(const void *data, size_t length) override {
+    if (length != 0) {
+      encoder.Reject(*(const uint8_t *)data);
+    }
+  }
+
+  void UpdateBuffer(TxBuffer &buffer) override {
+    const void *frame = GetFrame();
+    if (frame != nullptr) {
+      encoder.Add(buffer, GetHandlerId(), frame);
+    }
+  }
+
+protected:
+  virtual SplitHandlerId GetHandlerId() const = 0;
+
+  // Returns the frame to send, or nullptr if there is none.
+  virtual const void *GetFrame() = 0;
+
+private:
+  SplitDeltaEncoder<SIZE> encoder;
+};
+
+template <size_t SIZE>
+class SplitDeltaRxHandler : public SplitRxHandler, public SplitTxHandler {
+public:
+  void RegisterHandlers() {
+    Split::RegisterTxHandler(this);
+    Split::RegisterRxHandler(GetHandlerId(), this);
+  }
+
+  void OnReceiveConnectionReset() override {
+    decoder.Reset();
+    hasRejectedFrame = false;
+  }
+
+  void OnDataReceived(const void *data, size_t length) override {
+    if (decoder.Process(data, length)) {
+      OnFrameReceived(decoder.GetFrame());
+    } else if (length >= sizeof(SplitDeltaHeader)) {
+      rejectedSequence = ((const SplitDeltaHeader *)data)->sequence;
+      hasRejectedFrame = true;
+    }
+  }
+
+  void UpdateBuffer(TxBuffer &buffer) override {
+    if (hasRejectedFrame &&
+        buffer.Add(GetHandlerId(), &rejectedSequence, sizeof(uint8_t))) {
+      hasRejectedFrame = false;
+    }
+  }
+
+protected:
+  virtual SplitHandlerId GetHandlerId() const = 0;
+  virtual void OnFrameReceived(const uint8_t *frame) = 0;
+
+private:
+  bool hasRejectedFrame = false;
+  uint8_t rejectedSequence = 0;
+  SplitDeltaDecoder<SIZE> decoder;
+};
+
+//---------------------------------------------------------------------------
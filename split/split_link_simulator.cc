@@ -0,0 +1,458 @@
+//---------------------------------------------------------------------------
+
+#include "split_link_simulator.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+#if USE_SPLIT_LINK_SIMULATOR
+
+//---------------------------------------------------------------------------
+
+SplitLinkSimulator::SplitLinkSimulator(const Config &config)
+    : config(config), randomState(config.seed ? config.seed : 1) {}
+
+// xorshift32, so that runs are reproducible for a given seed.
+uint32_t SplitLinkSimulator::NextRandom() {
+  uint32_t x = randomState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  randomState = x;
+  return x;
+}
+
+size_t SplitLinkSimulator::Transfer(const TxBuffer &tx, RxBuffer &rx) {
+  const size_t byteCount = tx.GetByteCount();
+  rx.header = tx.header;
+  memcpy(rx.buffer, tx.buffer, tx.header.wordCount * sizeof(uint32_t));
+
+  if (config.corruptionPpm != 0 &&
+      NextRandom() % 1'000'000 < config.corruptionPpm) {
+    const size_t bitIndex = NextRandom() % (byteCount * 8);
+    uint8_t *p = bitIndex < 8 * sizeof(TxRxHeader)
+                     ? (uint8_t *)&rx.header
+                     : (uint8_t *)rx.buffer - sizeof(TxRxHeader);
+    p[bitIndex / 8] ^= 1 << (bitIndex % 8);
+  }
+
+  // 8N1 framing: 10 bits per byte.
+  transferredByteCount += byteCount;
+  timeMicroseconds += byteCount * 10 * 1'000'000ull / config.baudRate;
+  if (config.jitterMicroseconds != 0) {
+    timeMicroseconds += NextRandom() % (config.jitterMicroseconds + 1);
+  }
+
+  return byteCount / sizeof(uint32_t);
+}
+
+SplitLinkSimulator::ExchangeResult
+SplitLinkSimulator::Exchange(TxBuffer &masterTx, RxBuffer &slaveRx,
+                             TxBuffer &slaveTx, RxBuffer &masterRx,
+                             bool processBuffers) {
+  ExchangeResult result = {};
+  const uint64_t startTime = timeMicroseconds;
+  masterTx.header.transferId = ++transferId;
+
+  while (result.attemptCount < config.maximumAttempts) {
+    ++result.attemptCount;
+
+    size_t wordCount = Transfer(masterTx, slaveRx);
+    if (slaveRx.Validate(wordCount, slaveMetrics, true) !=
+        RxBufferValidateResult::OK) {
+      timeMicroseconds += config.timeoutMicroseconds;
+      ++masterMetrics[SplitMetricId::TIMEOUT_COUNT];
+      continue;
+    }
+
+    if (slaveRx.header.transferId == lastSlaveTransferId) {
+      // The slave response was lost, so the master retransmitted.
+      ++slaveMetrics[SplitMetricId::REPEAT_DATA_COUNT];
+    } else {
+      lastSlaveTransferId = slaveRx.header.transferId;
+      if (processBuffers) {
+        slaveRx.Process();
+      }
+    }
+
+    slaveTx.header.transferId = slaveRx.header.transferId;
+    wordCount = Transfer(slaveTx, masterRx);
+    if (masterRx.Validate(wordCount, masterMetrics, true) !=
+        RxBufferValidateResult::OK) {
+      timeMicroseconds += config.timeoutMicroseconds;
+      ++masterMetrics[SplitMetricId::TIMEOUT_COUNT];
+      continue;
+    }
+
+    if (processBuffers) {
+      masterRx.Process();
+    }
+    result.isAcknowledged = true;
+    break;
+  }
+
+  if (!result.isAcknowledged) {
+    ++masterMetrics[SplitMetricId::RESET_COUNT];
+  }
+  if (processBuffers) {
+    if (result.isAcknowledged) {
+      TxBuffer::OnAcknowledged();
+    } else {
+      TxBuffer::OnConnectionReset();
+    }
+  }
+  result.latencyMicroseconds = timeMicroseconds - startTime;
+  return result;
+}
+
+//---------------------------------------------------------------------------
+
+#endif // USE_SPLIT_LINK_SIMULATOR
+
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "../unit_test.h"
+
+#if USE_SPLIT_LINK_SIMULATOR
+
+#include "split_delta.h"
+#include <stdio.h>
+
+#define DO_PROFILE_TEST 0
+
+//---------------------------------------------------------------------------
+
+static TxBuffer masterTx;
+static TxBuffer slaveTx;
+static RxBuffer masterRx;
+static RxBuffer slaveRx;
+
+static void BuildTestBuffer(TxBuffer &buffer, size_t length) {
+  uint8_t data[512];
+  for (size_t i = 0; i < sizeof(data); ++i) {
+    data[i] = i;
+  }
+  buffer.Reset();
+  buffer.Add(SplitHandlerId::DISPLAY_DATA, data, length);
+  buffer.UpdateHash();
+}
+
+TEST_BEGIN("SplitLinkSimulator: Clean link latency") {
+  SplitLinkSimulator::Config config;
+  config.baudRate = 1'000'000;
+  SplitLinkSimulator link(config);
+
+  BuildTestBuffer(masterTx, 92);
+  BuildTestBuffer(slaveTx, 12);
+
+  const SplitLinkSimulator::ExchangeResult result =
+      link.Exchange(masterTx, slaveRx, slaveTx, masterRx);
+  assert(result.isAcknowledged);
+  assert(result.attemptCount == 1);
+
+  // 8 byte header + 4 byte block header + payload, 10 us per byte.
+  assert(result.latencyMicroseconds == (8 + 4 + 92) * 10 + (8 + 4 + 12) * 10);
+  for (const size_t metric : link.masterMetrics) {
+    assert(metric == 0);
+  }
+}
+TEST_END
+
+TEST_BEGIN("SplitLinkSimulator: Corrupted transfers are retransmitted") {
+  SplitLinkSimulator::Config config;
+  config.jitterMicroseconds = 50;
+  config.corruptionPpm = 100'000;
+  SplitLinkSimulator link(config);
+
+  BuildTestBuffer(masterTx, 256);
+  BuildTestBuffer(slaveTx, 16);
+
+  constexpr size_t EXCHANGE_COUNT = 1000;
+  for (size_t i = 0; i < EXCHANGE_COUNT; ++i) {
+    const SplitLinkSimulator::ExchangeResult result =
+        link.Exchange(masterTx, slaveRx, slaveTx, masterRx);
+    assert(result.isAcknowledged);
+  }
+
+  assert(link.masterMetrics[SplitMetricId::TIMEOUT_COUNT] != 0);
+  assert(link.slaveMetrics[SplitMetricId::REPEAT_DATA_COUNT] != 0);
+  assert(link.masterMetrics[SplitMetricId::RESET_COUNT] == 0);
+}
+TEST_END
+
+// Sends an animated 128x32 display buffer each exchange over a 1 Mbaud link
+// with 1% of transfers corrupted, with and without delta encoding.
+TEST_BEGIN("SplitLinkSimulator: Display animation benchmark") {
+  constexpr size_t DISPLAY_SIZE = 128 * 32 / 8;
+#if DO_PROFILE_TEST
+  constexpr size_t EXCHANGE_COUNT = 100'000;
+#else
+  constexpr size_t EXCHANGE_COUNT = 1000;
+#endif
+
+  uint64_t elapsed[2];
+  for (int useDelta = 0; useDelta < 2; ++useDelta) {
+    SplitLinkSimulator::Config config;
+    config.jitterMicroseconds = 20;
+    config.corruptionPpm = 10'000;
+    SplitLinkSimulator link(config);
+    static SplitDeltaEncoder<DISPLAY_SIZE> encoder;
+    encoder.Reset();
+
+    BuildTestBuffer(slaveTx, 4);
+
+    uint64_t maximumLatency = 0;
+    uint8_t display[DISPLAY_SIZE];
+    for (size_t i = 0; i < EXCHANGE_COUNT; ++i) {
+      memset(display, 0, sizeof(display));
+      memset(display + 256 + i % 120, 0xff, 8);
+
+      masterTx.Reset();
+      if (useDelta) {
+        encoder.Add(masterTx, SplitHandlerId::DISPLAY_DATA, display);
+      } else {
+        masterTx.Add(SplitHandlerId::DISPLAY_DATA, display, sizeof(display));
+      }
+      masterTx.UpdateHash();
+
+      const SplitLinkSimulator::ExchangeResult result =
+          link.Exchange(masterTx, slaveRx, slaveTx, masterRx);
+      assert(result.isAcknowledged);
+      if (result.latencyMicroseconds > maximumLatency) {
+        maximumLatency = result.latencyMicroseconds;
+      }
+      if (useDelta) {
+        encoder.Acknowledge();
+      }
+    }
+
+    elapsed[useDelta] = link.GetTimeMicroseconds();
+#if DO_PROFILE_TEST
+    printf("[PROFILE] Split link (%s): %.1f us/exchange, max %llu us, "
+           "%zu timeouts, %zu repeats, %zu hash failures, %.1f KB/s\n",
+           useDelta ? "delta" : "full",
+           double(link.GetTimeMicroseconds()) / EXCHANGE_COUNT,
+           (unsigned long long)maximumLatency,
+           link.masterMetrics[SplitMetricId::TIMEOUT_COUNT],
+           link.slaveMetrics[SplitMetricId::REPEAT_DATA_COUNT],
+           link.masterMetrics[SplitMetricId::HASH_FAILURE_COUNT] +
+               link.slaveMetrics[SplitMetricId::HASH_FAILURE_COUNT],
+           link.GetTransferredByteCount() * 1000.0 /
+               link.GetTimeMicroseconds());
+#endif
+  }
+
+  assert(elapsed[1] < elapsed[0] / 2);
+}
+TEST_END
+
+// Sends a display that changes every 100 exchanges through delta handlers
+// over a link with 1% of transfers corrupted.
+TEST_BEGIN("SplitLinkSimulator: Delta handlers follow acknowledgements") {
+  constexpr size_t DISPLAY_SIZE = 128 * 32 / 8;
+  constexpr size_t EXCHANGE_COUNT = 1000;
+  static uint8_t display[DISPLAY_SIZE];
+
+  class TestTxHandler final : public SplitDeltaTxHandler<DISPLAY_SIZE> {
+    SplitHandlerId GetHandlerId() const final {
+      return SplitHandlerId::DISPLAY_DATA;
+    }
+    const void *GetFrame() final { return display; }
+  };
+
+  class TestRxHandler final : public SplitDeltaRxHandler<DISPLAY_SIZE> {
+  public:
+    size_t frameCount = 0;
+    uint8_t frame[DISPLAY_SIZE];
+
+    SplitHandlerId GetHandlerId() const final {
+      return SplitHandlerId::DISPLAY_DATA;
+    }
+    void OnFrameReceived(const uint8_t *data) final {
+      memcpy(frame, data, DISPLAY_SIZE);
+      ++frameCount;
+    }
+  };
+
+  static TestTxHandler txHandler;
+  static TestRxHandler rxHandler;
+  Split::RegisterTxHandler(&txHandler);
+  Split::RegisterRxHandler(SplitHandlerId::DISPLAY_DATA, &rxHandler);
+
+  SplitLinkSimulator::Config config;
+  config.corruptionPpm = 10'000;
+  SplitLinkSimulator link(config);
+  slaveTx.Reset();
+  slaveTx.UpdateHash();
+
+  for (size_t i = 0; i < EXCHANGE_COUNT; ++i) {
+    if (i % 100 == 0) {
+      memset(display, 0, sizeof(display));
+      memset(display + 256 + i / 10, 0xff, 8);
+    }
+
+    masterTx.Build(true);
+    assert(link.Exchange(masterTx, slaveRx, slaveTx, masterRx, true)
+               .isAcknowledged);
+    assert(memcmp(rxHandler.frame, display, sizeof(display)) == 0);
+  }
+
+  // Changes and periodic full frames only.
+  assert(rxHandler.frameCount < EXCHANGE_COUNT / 10);
+  Split::RegisterRxHandler(SplitHandlerId::DISPLAY_DATA, nullptr);
+}
+TEST_END
+
+// The slave loses its frame without a connection reset, so the master's
+// next delta is rejected even though the exchange is acknowledged.
+TEST_BEGIN("SplitLinkSimulator: Rejected delta resynchronizes the frame") {
+  constexpr size_t DISPLAY_SIZE = 64;
+  constexpr size_t FULL_PACKET_SIZE =
+      SplitDeltaEncoder<DISPLAY_SIZE>::MAX_PACKET_SIZE;
+  static uint8_t display[DISPLAY_SIZE];
+
+  class TestTxHandler final : public SplitDeltaTxHandler<DISPLAY_SIZE> {
+    SplitHandlerId GetHandlerId() const final {
+      return SplitHandlerId::DISPLAY_DATA;
+    }
+    const void *GetFrame() final { return display; }
+  };
+
+  class TestRxHandler final : public SplitDeltaRxHandler<DISPLAY_SIZE> {
+  public:
+    size_t frameCount = 0;
+    uint8_t frame[DISPLAY_SIZE];
+
+    SplitHandlerId GetHandlerId() const final {
+      return SplitHandlerId::DISPLAY_DATA;
+    }
+    void OnFrameReceived(const uint8_t *data) final {
+      memcpy(frame, data, DISPLAY_SIZE);
+      ++frameCount;
+    }
+  };
+
+  static TestTxHandler masterHandler;
+  static TestRxHandler slaveHandler;
+  SplitLinkSimulator link(SplitLinkSimulator::Config{});
+
+  // Both halves share the handler registrations in this process, so the
+  // buffers are built and processed with each side's handlers directly.
+  // Returns the length of the master's packet.
+  auto exchange = [&]() -> size_t {
+    masterTx.Reset();
+    masterHandler.UpdateBuffer(masterTx);
+    masterTx.UpdateHash();
+    slaveTx.Reset();
+    slaveHandler.UpdateBuffer(slaveTx);
+    slaveTx.UpdateHash();
+
+    assert(link.Exchange(masterTx, slaveRx, slaveTx, masterRx, false)
+               .isAcknowledged);
+    Split::RegisterRxHandler(SplitHandlerId::DISPLAY_DATA, &slaveHandler);
+    slaveRx.Process();
+    Split::RegisterRxHandler(SplitHandlerId::DISPLAY_DATA, &masterHandler);
+    masterRx.Process();
+    masterHandler.OnTransmitAcknowledged();
+    return masterTx.header.wordCount == 0 ? 0 : masterTx.buffer[0] & 0xffff;
+  };
+
+  assert(exchange() == FULL_PACKET_SIZE);
+  assert(slaveHandler.frameCount == 1);
+
+  slaveHandler.OnReceiveConnectionReset();
+  display[3] = 3;
+  assert(exchange() < FULL_PACKET_SIZE);
+  assert(slaveHandler.frameCount == 1);
+
+  // The slave reports the rejection in its next response, while the
+  // master's delta in the same exchange is rejected too.
+  display[4] = 4;
+  assert(exchange() < FULL_PACKET_SIZE);
+  assert(slaveHandler.frameCount == 1);
+
+  assert(exchange() == FULL_PACKET_SIZE);
+  assert(slaveHandler.frameCount == 2);
+  assert(memcmp(slaveHandler.frame, display, sizeof(display)) == 0);
+
+  // The rejection of the second delta arrives after the full frame, and is
+  // ignored.
+  display[5] = 5;
+  assert(exchange() < FULL_PACKET_SIZE);
+  assert(slaveHandler.frameCount == 3);
+  assert(memcmp(slaveHandler.frame, display, sizeof(display)) == 0);
+
+  Split::RegisterRxHandler(SplitHandlerId::DISPLAY_DATA, nullptr);
+}
+TEST_END
+
+// Sends 12000 bytes through a gather handler, which needs two exchanges
+// since each TxBuffer holds 8192 bytes.
+TEST_BEGIN("SplitLinkSimulator: Gather handler sends data across exchanges") {
+  static uint8_t source[12000];
+  for (size_t i = 0; i < sizeof(source); ++i) {
+    source[i] = i * 7;
+  }
+
+  class TestGatherHandler final : public SplitTxGatherHandler {
+  public:
+    size_t offset = 0;
+
+    SplitHandlerId GetHandlerId() const final {
+      return SplitHandlerId::SERIAL;
+    }
+    size_t GetSpans(SplitTxSpan *spans) final {
+      if (offset == sizeof(source)) {
+        return 0;
+      }
+      // Split at the midpoint to exercise gathering.
+      constexpr size_t MIDPOINT = sizeof(source) / 2;
+      if (offset < MIDPOINT) {
+        spans[0] = {.data = source + offset, .length = MIDPOINT - offset};
+        spans[1] = {.data = source + MIDPOINT, .length = MIDPOINT};
+        return 2;
+      }
+      spans[0] = {.data = source + offset,
+                  .length = sizeof(source) - offset};
+      return 1;
+    }
+    void OnSpansSent(size_t byteCount) final { offset += byteCount; }
+  };
+
+  class TestRxHandler final : public SplitRxHandler {
+  public:
+    size_t receivedCount = 0;
+    void OnDataReceived(const void *data, size_t length) final {
+      assert(memcmp(data, source + receivedCount, length) == 0);
+      receivedCount += length;
+    }
+  };
+
+  TestGatherHandler gatherHandler;
+  TestRxHandler rxHandler;
+  Split::RegisterRxHandler(SplitHandlerId::SERIAL, &rxHandler);
+
+  SplitLinkSimulator link(SplitLinkSimulator::Config{});
+  slaveTx.Reset();
+  slaveTx.UpdateHash();
+
+  size_t exchangeCount = 0;
+  while (gatherHandler.offset != sizeof(source)) {
+    masterTx.Reset();
+    gatherHandler.UpdateBuffer(masterTx);
+    masterTx.UpdateHash();
+    assert(link.Exchange(masterTx, slaveRx, slaveTx, masterRx, true)
+               .isAcknowledged);
+    ++exchangeCount;
+  }
+
+  assert(exchangeCount == 2);
+  assert(rxHandler.receivedCount == sizeof(source));
+  Split::RegisterRxHandler(SplitHandlerId::SERIAL, nullptr);
+}
+TEST_END
+
+#endif // USE_SPLIT_LINK_SIMULATOR
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,87 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "split.h"
+
+//---------------------------------------------------------------------------
+
+// Host builds need JAVELIN_SPLIT, which the javelin-steno-split test target
+// defines.
+#if JAVELIN_SPLIT && !JAVELIN_PLATFORM_PICO_SDK && !JAVELIN_PLATFORM_NRF5_SDK
+#define USE_SPLIT_LINK_SIMULATOR 1
+#else
+#define USE_SPLIT_LINK_SIMULATOR 0
+#endif
+
+#if USE_SPLIT_LINK_SIMULATOR
+
+//---------------------------------------------------------------------------
+
+// Connects a master and slave TxBuffer/RxBuffer pair through a simulated
+// UART, so that the split protocol can be exercised and benchmarked on a
+// host.
+//
+// Each exchange sends the master buffer, then the slave buffer. A buffer
+// that fails validation is not answered, so the master times out and
+// retransmits. The slave counts retransmissions it has already processed
+// as REPEAT_DATA_COUNT.
+class SplitLinkSimulator {
+public:
+  struct Config {
+    uint32_t baudRate = 1'000'000;
+
+    // Maximum additional delay per transfer.
+    uint32_t jitterMicroseconds = 0;
+
+    // Probability that a transfer has a corrupted bit, in parts per million.
+    uint32_t corruptionPpm = 0;
+
+    // Time the master waits for a response before retransmitting.
+    uint32_t timeoutMicroseconds = 2000;
+
+    uint32_t maximumAttempts = 8;
+    uint32_t seed = 1;
+  };
+
+  struct ExchangeResult {
+    bool isAcknowledged;
+    uint32_t attemptCount;
+    uint32_t latencyMicroseconds;
+  };
+
+  explicit SplitLinkSimulator(const Config &config);
+
+  // Sends masterTx to slaveRx and the slave's reply slaveTx to masterRx.
+  // When processBuffers is set, received buffers are processed through the
+  // registered rx handlers, and the registered tx handlers are told whether
+  // the exchange was acknowledged or the connection reset.
+  ExchangeResult Exchange(TxBuffer &masterTx, RxBuffer &slaveRx,
+                          TxBuffer &slaveTx, RxBuffer &masterRx,
+                          bool processBuffers = false);
+
+  uint64_t GetTimeMicroseconds() const { return timeMicroseconds; }
+  uint64_t GetTransferredByteCount() const { return transferredByteCount; }
+
+  size_t masterMetrics[SplitMetricId::COUNT] = {};
+  size_t slaveMetrics[SplitMetricId::COUNT] = {};
+
+private:
+  const Config config;
+  uint32_t randomState;
+  uint16_t transferId = 0;
+  uint16_t lastSlaveTransferId = 0;
+  uint64_t timeMicroseconds = 0;
+  uint64_t transferredByteCount = 0;
+
+  uint32_t NextRandom();
+
+  // Copies the buffer over the simulated wire, advancing time.
+  // Returns the number of words received.
+  size_t Transfer(const TxBuffer &tx, RxBuffer &rx);
+};
+
+//---------------------------------------------------------------------------
+
+#endif // USE_SPLIT_LINK_SIMULATOR
+
+//---------------------------------------------------------------------------
@@ -1,6 +1,7 @@
 //---------------------------------------------------------------------------
 
 #include "split_serial_buffer.h"
+#include "../clock.h"
 #include <string.h>
 
 //---------------------------------------------------------------------------
@@ -13,10 +14,12 @@ SplitSerialBuffer::SplitSerialBufferData SplitSerialBuffer::instance;
 
 //---------------------------------------------------------------------------
 
+// Sleeps rather than spinning, so that on platforms where Clock::Sleep
+// yields, the split exchange that drains the queue can run.
 [[gnu::weak]]
 void SplitSerialBuffer::SplitSerialBufferData::WaitUntilQueueIsNotFull() {
   while (queue.IsFull()) {
-    // Do nothing.
+    Clock::Sleep(1);
   }
 }
 
@@ -30,10 +33,8 @@ void SplitSerialBuffer::SplitSerialBufferData::Add(const uint8_t *data,
     const size_t available = queue.GetAvailable();
     const size_t transferCount = available > length ? length : available;
 
-    for (size_t i = 0; i < transferCount; ++i) {
-      queue.Add(*data++);
-    }
-
+    queue.AddCount(data, transferCount);
+    data += transferCount;
     length -= transferCount;
   }
 }
@@ -42,20 +43,22 @@ void SplitSerialBuffer::SplitSerialBufferData::Add(const uint8_t *data,
 
 #if JAVELIN_SPLIT_IS_MASTER
 
-void SplitSerialBuffer::SplitSerialBufferData::UpdateBuffer(TxBuffer &buffer) {
-  if (queue.IsEmpty()) [[likely]] {
-    return;
-  }
-
+// The queue wraps at most once, so its contents are at most two spans, which
+// are copied directly into the TxBuffer.
+size_t SplitSerialBuffer::SplitSerialBufferData::GetSpans(SplitTxSpan *spans) {
   const size_t count = queue.GetCount();
-  uint8_t *target = buffer.Add(SplitHandlerId::SERIAL, count);
-  if (target == nullptr) {
-    return;
+  if (count == 0) [[likely]] {
+    return 0;
   }
-  for (const uint8_t c : queue) {
-    *target++ = c;
+
+  const size_t firstCount = queue.GetFrontContiguousCount();
+  spans[0] = SplitTxSpan{.data = &queue.Front(), .length = firstCount};
+  if (firstCount == count) {
+    return 1;
   }
-  queue.RemoveFront(count);
+  spans[1] = SplitTxSpan{.data = &queue[firstCount],
+                         .length = count - firstCount};
+  return 2;
 }
 
 #endif
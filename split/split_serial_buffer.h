@@ -8,6 +8,15 @@
 
 #if JAVELIN_SPLIT
 
+// Devices keep the previous queue size unless the board config raises it.
+#if !defined(JAVELIN_SPLIT_SERIAL_QUEUE_SIZE)
+#if JAVELIN_PLATFORM_PICO_SDK || JAVELIN_PLATFORM_NRF5_SDK
+#define JAVELIN_SPLIT_SERIAL_QUEUE_SIZE 128
+#else
+#define JAVELIN_SPLIT_SERIAL_QUEUE_SIZE 2048
+#endif
+#endif
+
 class SplitSerialBuffer {
 public:
   static void Add(const void *data, size_t length) {
@@ -29,7 +38,7 @@ public:
 private:
   struct SplitSerialBufferData :
 #if JAVELIN_SPLIT_IS_MASTER
-      public SplitTxHandler
+      public SplitTxGatherHandler
 #else
       public SplitRxHandler
 #endif
@@ -37,14 +46,17 @@ private:
     void Add(const uint8_t *data, size_t length);
 
 #if JAVELIN_SPLIT_IS_MASTER
-    void UpdateBuffer(TxBuffer &buffer) final;
+    SplitHandlerId GetHandlerId() const final { return SplitHandlerId::SERIAL; }
+    size_t GetSpans(SplitTxSpan *spans) final;
+    void OnSpansSent(size_t byteCount) final { queue.RemoveFront(byteCount); }
 #else
     void OnDataReceived(const void *data, size_t length) final;
 #endif
 
     void WaitUntilQueueIsNotFull();
 
-    static const size_t MAXIMUM_SERIAL_QUEUE_SIZE = 128;
+    static const size_t MAXIMUM_SERIAL_QUEUE_SIZE =
+        JAVELIN_SPLIT_SERIAL_QUEUE_SIZE;
     CyclicQueue<uint8_t, MAXIMUM_SERIAL_QUEUE_SIZE> queue;
   };
 
@@ -5,6 +5,7 @@
 #include "str.h"
 #include "utf8_pointer.h"
 #include <assert.h>
+#include <string.h>
 
 //---------------------------------------------------------------------------
 
@@ -79,6 +80,282 @@ constexpr StrokeKey EXTENDED_ENGLISH_STROKE_PARSER[] = {
 
 //---------------------------------------------------------------------------
 
+// Renders strokes a chunk of up to 8 keys at a time.
+//
+// Key bits are first gathered into display order using runs of consecutive
+// bits, then each chunk indexes a table of precomputed fragments, each
+// holding the ASCII characters for that combination of keys.
+//
+// Build() is constexpr so that the default table is placed in flash.
+class StrokeFormatTable {
+public:
+  constexpr StrokeFormatTable() = default;
+
+  template <size_t N>
+  constexpr StrokeFormatTable(const StrokeKey (&keys)[N]) {
+    Build(keys, keys + N);
+  }
+
+  constexpr bool IsValid() const { return isValid; }
+  constexpr void Build(const StrokeKey *begin, const StrokeKey *end);
+  char *Format(uint32_t keyState, char *buffer) const;
+
+private:
+  static constexpr size_t MAX_RUN_COUNT = 8;
+  static constexpr size_t MAX_CHUNK_COUNT = 8;
+  static constexpr size_t MAX_CHUNK_KEY_COUNT = 8;
+  static constexpr size_t MAX_FRAGMENT_COUNT = JAVELIN_STROKE_FRAGMENT_COUNT;
+
+  // display |= ((keyState >> sourceShift) & mask) << displayShift.
+  struct Run {
+    uint8_t sourceShift;
+    uint8_t displayShift;
+    uint32_t mask;
+  };
+
+  // Either a separator, or keys displayShift to displayShift + keyCount.
+  struct Chunk {
+    uint8_t separator;
+    uint8_t displayShift;
+    uint8_t keyCount;
+    uint16_t fragmentOffset;
+    uint32_t separatorMask;
+    uint32_t followMask;
+  };
+
+  bool isValid = false;
+  uint8_t runCount = 0;
+  uint8_t chunkCount = 0;
+  Run runs[MAX_RUN_COUNT] = {};
+  Chunk chunks[MAX_CHUNK_COUNT] = {};
+  uint64_t fragments[MAX_FRAGMENT_COUNT] = {};
+
+  constexpr bool AddChunk(const char *characters, size_t keyCount,
+                          size_t displayShift, size_t &fragmentCount);
+};
+
+constexpr void StrokeFormatTable::Build(const StrokeKey *begin,
+                                        const StrokeKey *end) {
+  isValid = false;
+  runCount = 0;
+  chunkCount = 0;
+
+  size_t displayIndex = 0;
+  size_t fragmentCount = 0;
+  size_t chunkKeyCount = 0;
+  char chunkCharacters[MAX_CHUNK_KEY_COUNT] = {};
+  for (const StrokeKey *p = begin; p != end; ++p) {
+    if (p->type == StrokeKeyType::SEPARATOR) {
+      if (p + 1 == end || p[1].type != StrokeKeyType::SEPARATOR_FOLLOW_MASK ||
+          p->c >= 0x80 || size_t(chunkCount) + 2 > MAX_CHUNK_COUNT) {
+        return;
+      }
+      if (!AddChunk(chunkCharacters, chunkKeyCount,
+                    displayIndex - chunkKeyCount, fragmentCount)) {
+        return;
+      }
+      chunkKeyCount = 0;
+      chunks[chunkCount++] = {
+          .separator = uint8_t(p->c),
+          .displayShift = 0,
+          .keyCount = 0,
+          .fragmentOffset = 0,
+          .separatorMask = p[0].mask,
+          .followMask = p[1].mask,
+      };
+      ++p;
+      continue;
+    }
+
+    if (p->type != StrokeKeyType::MASK || p->mask == 0 ||
+        !p->IsSingleBit() || p->c >= 0x80 || displayIndex >= 32) {
+      return;
+    }
+
+    // Builtins rather than Bit<4>, which is not usable in constant
+    // expressions.
+    const size_t sourceIndex = __builtin_ctz(p->mask);
+    Run *run = runCount ? &runs[runCount - 1] : nullptr;
+    const size_t runLength = run ? __builtin_popcount(run->mask) : 0;
+    if (run && run->sourceShift + runLength == sourceIndex &&
+        run->displayShift + runLength == displayIndex) {
+      run->mask = (run->mask << 1) | 1;
+    } else {
+      if (runCount == MAX_RUN_COUNT) {
+        return;
+      }
+      runs[runCount++] = {
+          .sourceShift = uint8_t(sourceIndex),
+          .displayShift = uint8_t(displayIndex),
+          .mask = 1,
+      };
+    }
+
+    chunkCharacters[chunkKeyCount++] = p->c;
+    ++displayIndex;
+    if (chunkKeyCount == MAX_CHUNK_KEY_COUNT) {
+      if (!AddChunk(chunkCharacters, chunkKeyCount,
+                    displayIndex - chunkKeyCount, fragmentCount)) {
+        return;
+      }
+      chunkKeyCount = 0;
+    }
+  }
+
+  isValid = AddChunk(chunkCharacters, chunkKeyCount,
+                     displayIndex - chunkKeyCount, fragmentCount);
+}
+
+constexpr bool StrokeFormatTable::AddChunk(const char *characters,
+                                           size_t keyCount,
+                                           size_t displayShift,
+                                           size_t &fragmentCount) {
+  if (keyCount == 0) {
+    return true;
+  }
+
+  const size_t chunkFragmentCount = size_t(1) << keyCount;
+  if (chunkCount == MAX_CHUNK_COUNT ||
+      fragmentCount + chunkFragmentCount > MAX_FRAGMENT_COUNT) {
+    return false;
+  }
+
+  chunks[chunkCount++] = {
+      .separator = 0,
+      .displayShift = uint8_t(displayShift),
+      .keyCount = uint8_t(keyCount),
+      .fragmentOffset = uint16_t(fragmentCount),
+      .separatorMask = 0,
+      .followMask = 0,
+  };
+
+  // Characters are packed in memory order, which Format() copies out.
+  for (size_t bits = 0; bits < chunkFragmentCount; ++bits) {
+    uint64_t fragment = 0;
+    size_t shift = 0;
+    for (size_t i = 0; i < keyCount; ++i) {
+      if (bits & (1 << i)) {
+        fragment |= uint64_t(uint8_t(characters[i])) << shift;
+        shift += 8;
+      }
+    }
+    fragments[fragmentCount + bits] = fragment;
+  }
+  fragmentCount += chunkFragmentCount;
+  return true;
+}
+
+char *StrokeFormatTable::Format(uint32_t keyState, char *buffer) const {
+  uint32_t display = 0;
+  for (size_t i = 0; i < runCount; ++i) {
+    const Run &run = runs[i];
+    display |= ((keyState >> run.sourceShift) & run.mask) << run.displayShift;
+  }
+
+  char *p = buffer;
+  for (size_t i = 0; i < chunkCount; ++i) {
+    const Chunk &chunk = chunks[i];
+    if (chunk.separator) [[unlikely]] {
+      if ((keyState & chunk.separatorMask) == 0 &&
+          (keyState & chunk.followMask) != 0) {
+        *p++ = chunk.separator;
+      }
+      continue;
+    }
+
+    const uint32_t bits =
+        (display >> chunk.displayShift) & ((1 << chunk.keyCount) - 1);
+    memcpy(p, &fragments[chunk.fragmentOffset + bits], sizeof(uint64_t));
+    p += Bit<4>::PopCount(bits);
+  }
+  *p = '\0';
+  return p;
+}
+
+// Each character has a bit set for every parser key that it matches, so
+// that the next matching key is found with a single count trailing zeros.
+class StrokeParseTable {
+public:
+  constexpr StrokeParseTable() = default;
+
+  template <size_t N>
+  constexpr StrokeParseTable(const StrokeKey (&keys)[N]) {
+    Build(keys, keys + N);
+  }
+
+  constexpr bool IsValid() const { return isValid; }
+  constexpr void Build(const StrokeKey *begin, const StrokeKey *end);
+  uint32_t Parse(const char *string) const;
+
+private:
+  static constexpr size_t MAX_KEY_COUNT = 64;
+
+  bool isValid = false;
+  uint64_t characterKeys[128] = {};
+  uint32_t keyMasks[MAX_KEY_COUNT] = {};
+};
+
+constexpr void StrokeParseTable::Build(const StrokeKey *begin,
+                                       const StrokeKey *end) {
+  for (uint64_t &keys : characterKeys) {
+    keys = 0;
+  }
+  isValid = false;
+  if (end - begin > (ptrdiff_t)MAX_KEY_COUNT) {
+    return;
+  }
+
+  for (const StrokeKey *p = begin; p != end; ++p) {
+    // Keys that can never match a char are skipped by the per-key parser.
+    if (p->c >= 0x100) {
+      continue;
+    }
+    if (p->c == 0 || p->c >= 0x80) {
+      return;
+    }
+    const size_t index = p - begin;
+    characterKeys[p->c] |= uint64_t(1) << index;
+    keyMasks[index] = p->mask;
+  }
+  isValid = true;
+}
+
+uint32_t StrokeParseTable::Parse(const char *string) const {
+  uint32_t value = 0;
+  uint64_t remainingKeys = ~uint64_t(0);
+  for (;;) {
+    const uint8_t c = *string++;
+    if (c >= 0x80) {
+      return value;
+    }
+    const uint64_t keys = characterKeys[c] & remainingKeys;
+    if (keys == 0) {
+      return value;
+    }
+    const size_t index = Bit<8>::CountTrailingZeros(keys);
+    value |= keyMasks[index];
+
+    // When index is 63, the shift gives 0 and remainingKeys becomes 0.
+    remainingKeys = ~((uint64_t(2) << index) - 1);
+  }
+}
+
+//---------------------------------------------------------------------------
+
+constexpr StrokeFormatTable DEFAULT_FORMAT_TABLE(
+    EXTENDED_ENGLISH_STROKE_FORMATTER);
+constexpr StrokeParseTable DEFAULT_PARSE_TABLE(EXTENDED_ENGLISH_STROKE_PARSER);
+static_assert(DEFAULT_FORMAT_TABLE.IsValid());
+static_assert(DEFAULT_PARSE_TABLE.IsValid());
+
+// Tables for other languages are only allocated by SetLanguage().
+static const StrokeFormatTable *formatTable = &DEFAULT_FORMAT_TABLE;
+static const StrokeParseTable *parseTable = &DEFAULT_PARSE_TABLE;
+static StrokeFormatTable *languageFormatTable = nullptr;
+static StrokeParseTable *languageParseTable = nullptr;
+
+//---------------------------------------------------------------------------
+
 FastIterable<const StrokeKey> StenoStroke::formatter =
     FastIterable<const StrokeKey>(EXTENDED_ENGLISH_STROKE_FORMATTER);
 FastIterable<const StrokeKey> StenoStroke::parser =
@@ -105,6 +382,11 @@ void StenoStroke::SetLanguage(const SizedList<StrokeKey> &keys) {
     }
   }
   parser = parsers;
+  if (languageParseTable == nullptr) {
+    languageParseTable = new StrokeParseTable;
+  }
+  languageParseTable->Build(begin(parser), end(parser));
+  parseTable = languageParseTable;
 
   formatters.Reset();
   for (const StrokeKey &key : keys) {
@@ -113,11 +395,24 @@ void StenoStroke::SetLanguage(const SizedList<StrokeKey> &keys) {
     }
   }
   formatter = formatters;
+  if (languageFormatTable == nullptr) {
+    languageFormatTable = new StrokeFormatTable;
+  }
+  languageFormatTable->Build(begin(formatter), end(formatter));
+  formatTable = languageFormatTable;
 }
 
 //---------------------------------------------------------------------------
 
 void StenoStroke::Set(const char *string) {
+  if (parseTable->IsValid()) [[likely]] {
+    keyState = parseTable->Parse(string);
+    return;
+  }
+  SetUsingKeys(string);
+}
+
+void StenoStroke::SetUsingKeys(const char *string) {
   uint32_t value = 0;
   for (const StrokeKey &display : parser) {
     if (display.c == *string) {
@@ -130,6 +425,13 @@ void StenoStroke::Set(const char *string) {
 }
 
 char *StenoStroke::ToString(char *buffer) const {
+  if (formatTable->IsValid()) [[likely]] {
+    return formatTable->Format(keyState, buffer);
+  }
+  return ToStringUsingKeys(buffer);
+}
+
+char *StenoStroke::ToStringUsingKeys(char *buffer) const {
   Utf8Pointer utf8(buffer);
   const StrokeKey *pEnd = end(formatter);
   const uint32_t localKeyState = keyState;
@@ -180,6 +482,13 @@ uint32_t StenoStroke::Hash(const StenoStroke *strokes, size_t length) {
 //---------------------------------------------------------------------------
 
 #include "unit_test.h"
+#include "random.h"
+
+//---------------------------------------------------------------------------
+
+#define DO_PROFILE_TEST 0
+
+//---------------------------------------------------------------------------
 
 bool VerifyParse(const char *text, const char *expected) {
   StenoStroke stroke;
@@ -204,4 +513,151 @@ TEST_BEGIN("Stroke tests") {
 }
 TEST_END
 
+static void VerifyTablesMatchKeys(uint32_t keyState) {
+  const StenoStroke stroke(keyState);
+  char tableBuffer[StenoStroke::MAX_STRING_LENGTH];
+  char keysBuffer[StenoStroke::MAX_STRING_LENGTH];
+  const char *tableEnd = stroke.ToString(tableBuffer);
+  const char *keysEnd = stroke.ToStringUsingKeys(keysBuffer);
+  assert(tableEnd - tableBuffer == keysEnd - keysBuffer);
+  assert(Str::Eq(tableBuffer, keysBuffer));
+
+  StenoStroke tableParse;
+  StenoStroke keysParse;
+  tableParse.Set(tableBuffer);
+  keysParse.SetUsingKeys(tableBuffer);
+  assert(tableParse == keysParse);
+  assert(tableParse == stroke);
+}
+
+TEST_BEGIN("Stroke: Tables match per-key formatter and parser") {
+  for (uint32_t i = 0; i < 0x10000; ++i) {
+    VerifyTablesMatchKeys(i);
+    VerifyTablesMatchKeys(i << 9);
+  }
+  for (size_t i = 0; i < 10000; ++i) {
+    VerifyTablesMatchKeys(Random::GenerateUint32() & 0x01ffffff);
+  }
+
+  const char *const INPUTS[] = {
+      "1234", "#S-T", "-Z", "*E", "TEFT/-G", "KAT WORD",
+      "STKPWHRAO*EUFRPBLGTSDZ", "SA-T", "EU", "Q", "", "1-9",
+  };
+  for (const char *input : INPUTS) {
+    StenoStroke tableParse;
+    StenoStroke keysParse;
+    tableParse.Set(input);
+    keysParse.SetUsingKeys(input);
+    assert(tableParse == keysParse);
+  }
+}
+TEST_END
+
+TEST_BEGIN("Stroke: Non-ASCII layouts use per-key formatter") {
+  const StrokeKey NON_ASCII_KEYS[] = {
+      {'S', StrokeKeyType::MASK, 0x00000002},
+      {0xe4, StrokeKeyType::MASK, 0x00000100},
+      {'-', StrokeKeyType::SEPARATOR, 0x00000100},
+      {'-', StrokeKeyType::SEPARATOR_FOLLOW_MASK, 0x00002000},
+      {'F', StrokeKeyType::MASK, 0x00002000},
+  };
+  StenoStroke::SetLanguage(SizedList<StrokeKey>{
+      .count = sizeof(NON_ASCII_KEYS) / sizeof(*NON_ASCII_KEYS),
+      .data = NON_ASCII_KEYS,
+  });
+
+  char buffer[StenoStroke::MAX_STRING_LENGTH];
+  StenoStroke(0x00000102).ToString(buffer);
+  assert(Str::Eq(buffer, "S\xc3\xa4"));
+  StenoStroke(0x00002002).ToString(buffer);
+  assert(Str::Eq(buffer, "S-F"));
+
+  // Restore the default layout, with the parser digits before each key.
+  StrokeKey defaultKeys[sizeof(EXTENDED_ENGLISH_STROKE_PARSER) /
+                            sizeof(*EXTENDED_ENGLISH_STROKE_PARSER) +
+                        1];
+  size_t count = 0;
+  for (const StrokeKey &key : EXTENDED_ENGLISH_STROKE_PARSER) {
+    if (key.type == StrokeKeyType::SEPARATOR) {
+      defaultKeys[count++] = EXTENDED_ENGLISH_STROKE_FORMATTER[13];
+      defaultKeys[count++] = EXTENDED_ENGLISH_STROKE_FORMATTER[14];
+    } else {
+      defaultKeys[count++] = key;
+    }
+  }
+  StenoStroke::SetLanguage(SizedList<StrokeKey>{
+      .count = count,
+      .data = defaultKeys,
+  });
+  assert(VerifyParse("19", "#S-T"));
+  assert(VerifyParse("STA*R", "STA*R"));
+}
+TEST_END
+
+TEST_BEGIN("Stroke: ToString and Set benchmark") {
+#if DO_PROFILE_TEST
+  constexpr size_t ITERATION_COUNT = 10'000'000;
+#else
+  constexpr size_t ITERATION_COUNT = 10;
+#endif
+  // Dictionary exports have little repetition between consecutive strokes,
+  // so use enough random strokes to defeat branch prediction.
+  constexpr size_t STROKE_COUNT = 4096;
+  StenoStroke *strokes = new StenoStroke[STROKE_COUNT];
+  char(*texts)[StenoStroke::MAX_STRING_LENGTH] =
+      new char[STROKE_COUNT][StenoStroke::MAX_STRING_LENGTH];
+  for (size_t i = 0; i < STROKE_COUNT; ++i) {
+    const uint32_t bits = Random::GenerateUint32() & Random::GenerateUint32();
+    strokes[i] = StenoStroke(bits & StrokeMask::ALL);
+    strokes[i].ToStringUsingKeys(texts[i]);
+  }
+  char buffer[StenoStroke::MAX_STRING_LENGTH];
+
+  size_t keysLength = 0;
+  const ProfileTimer keysTimer;
+  for (size_t i = 0; i < ITERATION_COUNT; ++i) {
+    keysLength += strokes[i % STROKE_COUNT].ToStringUsingKeys(buffer) - buffer;
+  }
+#if DO_PROFILE_TEST
+  keysTimer.PrintRate("ToStringUsingKeys", ITERATION_COUNT, "strokes");
+#endif
+
+  size_t tableLength = 0;
+  const ProfileTimer tableTimer;
+  for (size_t i = 0; i < ITERATION_COUNT; ++i) {
+    tableLength += strokes[i % STROKE_COUNT].ToString(buffer) - buffer;
+  }
+#if DO_PROFILE_TEST
+  tableTimer.PrintRate("ToString", ITERATION_COUNT, "strokes");
+#endif
+  assert(tableLength == keysLength);
+
+  uint32_t keysHash = 0;
+  const ProfileTimer setKeysTimer;
+  for (size_t i = 0; i < ITERATION_COUNT; ++i) {
+    StenoStroke stroke;
+    stroke.SetUsingKeys(texts[i % STROKE_COUNT]);
+    keysHash += stroke.GetKeyState();
+  }
+#if DO_PROFILE_TEST
+  setKeysTimer.PrintRate("SetUsingKeys", ITERATION_COUNT, "strokes");
+#endif
+
+  uint32_t tableHash = 0;
+  const ProfileTimer setTableTimer;
+  for (size_t i = 0; i < ITERATION_COUNT; ++i) {
+    StenoStroke stroke;
+    stroke.Set(texts[i % STROKE_COUNT]);
+    tableHash += stroke.GetKeyState();
+  }
+#if DO_PROFILE_TEST
+  setTableTimer.PrintRate("Set", ITERATION_COUNT, "strokes");
+#endif
+  assert(tableHash == keysHash);
+
+  delete[] strokes;
+  delete[] texts;
+}
+TEST_END
+
 //---------------------------------------------------------------------------
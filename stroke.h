@@ -9,6 +9,15 @@
 
 //---------------------------------------------------------------------------
 
+// Number of precomputed ToString() fragments, each 8 bytes. Each group of up
+// to 8 consecutive keys uses 2^keyCount fragments, with the default English
+// layout using 560. Layouts that do not fit use the per-key formatter.
+#if !defined(JAVELIN_STROKE_FRAGMENT_COUNT)
+#define JAVELIN_STROKE_FRAGMENT_COUNT 640
+#endif
+
+//---------------------------------------------------------------------------
+
 enum StrokeKeyType : uint8_t {
   MASK,
   SEPARATOR,
@@ -20,7 +29,7 @@ struct StrokeKey {
   StrokeKeyType type;
   uint32_t mask;
 
-  bool IsSingleBit() const { return (mask & (mask - 1)) == 0; }
+  constexpr bool IsSingleBit() const { return (mask & (mask - 1)) == 0; }
 };
 
 //---------------------------------------------------------------------------
@@ -100,7 +109,10 @@ public:
 
   constexpr StenoStroke(uint32_t keyState) : keyState(keyState) {}
 
+  // Parsing stops at the first character that does not match a key, so
+  // string does not need to be terminated after the stroke.
   void Set(const char *string);
+  void SetUsingKeys(const char *string);
   template <size_t N> StenoStroke(const char (&s)[N]) { Set(s); }
 
   bool IsEmpty() const { return keyState == 0; }
@@ -108,6 +120,7 @@ public:
 
   // Buffer must be at least MAX_STRING_LENGTH characters wide.
   char *ToString(char *buffer) const;
+  char *ToStringUsingKeys(char *buffer) const;
 
   bool operator==(const StenoStroke &o) const { return keyState == o.keyState; }
 
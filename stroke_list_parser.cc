@@ -1,7 +1,6 @@
 //---------------------------------------------------------------------------
 
 #include "stroke_list_parser.h"
-#include <stdlib.h>
 
 //---------------------------------------------------------------------------
 
@@ -17,10 +16,9 @@ bool StrokeListParser::Parse(const char *p) {
       ++p;
     }
 
-    char *text = Str::DupN(start, p - start);
+    // Set() stops at the delimiter, since it is not a steno key.
     StenoStroke &stroke = Add();
-    stroke.Set(text);
-    free(text);
+    stroke.Set(start);
 
     if (stroke.IsEmpty()) {
       failureOrEnd = start;
@@ -3,6 +3,7 @@
 #include "timer_manager.h"
 #include "bit.h"
 #include "console.h"
+#include "metrics.h"
 
 //---------------------------------------------------------------------------
 
@@ -22,14 +23,22 @@ void TimerManager::PrintInfo() const {
   }
 }
 
+void TimerManager::RegisterMetrics() const {
+  Metrics::Register("timers", "count", MetricType::GAUGE, &timerCount);
+  Metrics::Register("timers", "tickDelay", MetricType::GAUGE, &tickDelay);
+}
+
 //---------------------------------------------------------------------------
 
 void TimerManager::OnTimersUpdated(uint32_t currentTime) {
   int newTickDelay;
   if (!HasTimers()) {
     newTickDelay = 0;
-  } else if (HasOnlyRepeatingTimers()) {
-    newTickDelay = GetTimersGCD();
+  } else if (!isTickless && HasOnlyRepeatingTimers()) {
+    if (timersGCD == 0) {
+      timersGCD = GetTimersGCD();
+    }
+    newTickDelay = timersGCD;
     if (newTickDelay < 1) {
       newTickDelay = 1;
     }
@@ -40,7 +49,8 @@ void TimerManager::OnTimersUpdated(uint32_t currentTime) {
     }
   }
 
-  if (newTickDelay == tickDelay) {
+  // Tickless platforms rearm a one-shot timer on every update.
+  if (newTickDelay == tickDelay && !isTickless) {
     return;
   }
   tickDelay = newTickDelay;
@@ -49,13 +59,118 @@ void TimerManager::OnTimersUpdated(uint32_t currentTime) {
 
 [[gnu::weak]] void TimerManager::UpdateTickDelay(int ms) {}
 
+// Stein's algorithm.
+static int GCD(int a, int b) {
+  if (a == 0) {
+    return b;
+  }
+  if (b == 0) {
+    return a;
+  }
+
+  const int commonPowerOf2 = __builtin_ctz(a | b);
+
+  a >>= __builtin_ctz(a);
+
+  do {
+    b >>= __builtin_ctz(b);
+
+    if (a > b) {
+      const int temp = a;
+      a = b;
+      b = temp;
+    }
+
+    b -= a;
+  } while (b != 0);
+
+  return a << commonPowerOf2;
+}
+
 size_t TimerManager::GetTimerIndex(int32_t timerId) const {
-  for (size_t i = 0; i < timerCount; ++i) {
-    if (timers[i].id == timerId) {
-      return i;
+  for (size_t slot = GetIdSlot(timerId);; slot = (slot + 1) % ID_HASH_SIZE) {
+    const size_t value = idSlots[slot];
+    if (value == 0) {
+      return INVALID_TIMER_INDEX;
+    }
+    if (timers[value - 1].id == timerId) {
+      return value - 1;
     }
   }
-  return INVALID_TIMER_INDEX;
+}
+
+void TimerManager::AddIdSlot(size_t index) {
+  size_t slot = GetIdSlot(timers[index].id);
+  while (idSlots[slot] != 0) {
+    slot = (slot + 1) % ID_HASH_SIZE;
+  }
+  idSlots[slot] = index + 1;
+}
+
+void TimerManager::UpdateIdSlot(int32_t timerId, size_t index) {
+  size_t slot = GetIdSlot(timerId);
+  while (timers[idSlots[slot] - 1].id != timerId) {
+    slot = (slot + 1) % ID_HASH_SIZE;
+  }
+  idSlots[slot] = index + 1;
+}
+
+void TimerManager::RemoveIdSlot(int32_t timerId) {
+  size_t hole = GetIdSlot(timerId);
+  while (timers[idSlots[hole] - 1].id != timerId) {
+    hole = (hole + 1) % ID_HASH_SIZE;
+  }
+
+  // Backward shift deletion, so that lookups never need tombstones.
+  idSlots[hole] = 0;
+  for (size_t slot = (hole + 1) % ID_HASH_SIZE; idSlots[slot] != 0;
+       slot = (slot + 1) % ID_HASH_SIZE) {
+    const size_t home = GetIdSlot(timers[idSlots[slot] - 1].id);
+    if ((slot - home) % ID_HASH_SIZE >= (slot - hole) % ID_HASH_SIZE) {
+      idSlots[hole] = idSlots[slot];
+      idSlots[slot] = 0;
+      hole = slot;
+    }
+  }
+}
+
+void TimerManager::SiftUp(size_t heapIndex) {
+  const size_t index = heap[heapIndex];
+  while (heapIndex > 0) {
+    const size_t parentHeapIndex = (heapIndex - 1) / 2;
+    if (!timers[index].TriggersBefore(timers[heap[parentHeapIndex]])) {
+      break;
+    }
+    SetHeapIndex(heapIndex, heap[parentHeapIndex]);
+    heapIndex = parentHeapIndex;
+  }
+  SetHeapIndex(heapIndex, index);
+}
+
+void TimerManager::SiftDown(size_t heapIndex) {
+  const size_t index = heap[heapIndex];
+  for (;;) {
+    size_t childHeapIndex = 2 * heapIndex + 1;
+    if (childHeapIndex >= timerCount) {
+      break;
+    }
+    if (childHeapIndex + 1 < timerCount &&
+        timers[heap[childHeapIndex + 1]].TriggersBefore(
+            timers[heap[childHeapIndex]])) {
+      ++childHeapIndex;
+    }
+    if (!timers[heap[childHeapIndex]].TriggersBefore(timers[index])) {
+      break;
+    }
+    SetHeapIndex(heapIndex, heap[childHeapIndex]);
+    heapIndex = childHeapIndex;
+  }
+  SetHeapIndex(heapIndex, index);
+}
+
+void TimerManager::UpdateHeapPosition(size_t index) {
+  SiftUp(timers[index].heapIndex);
+  SiftDown(timers[index].heapIndex);
 }
 
 void TimerManager::StopTimer(int32_t timerId, uint32_t currentTime) {
@@ -68,19 +183,11 @@ void TimerManager::StopTimer(int32_t timerId, uint32_t currentTime) {
   RemoveTimerIndex(index, currentTime);
 }
 
+// Returns the free id closest to -1.
 int TimerManager::FindFreeTimerId() const {
-  for (int baseTimerId = -32;; baseTimerId -= 32) {
-    uint32_t bitmask = 0xffffffff;
-    for (size_t i = 0; i < timerCount; ++i) {
-      const uint32_t bitIndex = timers[i].id - baseTimerId;
-      if (bitIndex < 32) {
-        bitmask &= ~(1u << bitIndex);
-      }
-    }
-
-    if (bitmask != 0) {
-      const int topBit = Bit<sizeof(uint32_t)>::CountLeadingZeros(bitmask);
-      return baseTimerId + 31 - topBit;
+  for (int timerId = -1;; --timerId) {
+    if (!HasTimer(timerId)) {
+      return timerId;
     }
   }
 }
@@ -95,14 +202,32 @@ void TimerManager::StartTimer(int32_t timerId, uint32_t interval,
     }
     index = timerCount++;
     timers[index].id = timerId;
+    AddIdSlot(index);
+    SetHeapIndex(index, index);
   } else {
     timers[index].handler->OnTimerRemovedFromManager();
+    if (!timers[index].isRepeating) {
+      --nonRepeatingTimerCount;
+    }
+    timersGCD = 0;
   }
 
-  timers[index].isRepeating = isRepeating;
-  timers[index].lastUpdateTime = currentTime;
-  timers[index].interval = interval;
-  timers[index].handler = handler;
+  Timer &timer = timers[index];
+  timer.isRepeating = isRepeating;
+  timer.lastUpdateTime = currentTime;
+  timer.interval = interval;
+  timer.triggerTime = currentTime + interval;
+  timer.handler = handler;
+  UpdateHeapPosition(index);
+
+  if (!isRepeating) {
+    ++nonRepeatingTimerCount;
+  }
+  if (timerCount == 1) {
+    timersGCD = interval;
+  } else if (timersGCD != 0) {
+    timersGCD = GCD(timersGCD, interval);
+  }
 
   OnTimersUpdated(currentTime);
 }
@@ -110,29 +235,42 @@ void TimerManager::StartTimer(int32_t timerId, uint32_t interval,
 void TimerManager::ProcessTimers(uint32_t currentTime) {
   lastUpdateTime = currentTime;
 
-  for (size_t i = 0; i < timerCount; ++i) {
-    Timer &timer = timers[i];
-    if (timer.ShouldTrigger(currentTime)) {
-      timer.lastUpdateTime = currentTime;
+  bool hasRepeated = false;
+  while (timerCount != 0) {
+    const size_t index = heap[0];
+    Timer &timer = timers[index];
+    if (!timer.ShouldTrigger(currentTime)) {
+      break;
+    }
 
-      const intptr_t id = timer.id;
-      TimerHandler *const handler = timer.handler;
-      const bool isRepeating = timer.isRepeating;
+    const intptr_t id = timer.id;
+    TimerHandler *const handler = timer.handler;
+    const bool isRepeating = timer.isRepeating;
 
-      // For non-repeating timers, need to remove it immediately so that
-      // if the timer script adds it back, it triggers again.
-      if (!isRepeating) {
-        RemoveTimerIndex(i, currentTime);
-        --i;
-      }
+    // For non-repeating timers, need to remove it immediately so that
+    // if the timer script adds it back, it triggers again.
+    if (isRepeating) {
+      // A zero interval triggers once per call rather than continuously.
+      timer.lastUpdateTime = currentTime;
+      timer.triggerTime = currentTime + (timer.interval ? timer.interval : 1);
+      SiftDown(0);
+      hasRepeated = true;
+    } else {
+      RemoveTimerIndex(index, currentTime);
+    }
 
-      handler->Run(id);
+    handler->Run(id);
 
-      if (!isRepeating) {
-        handler->OnTimerRemovedFromManager();
-      }
+    if (!isRepeating) {
+      handler->OnTimerRemovedFromManager();
     }
   }
+
+  // Repeating timers move the next trigger without otherwise updating the
+  // timers.
+  if (hasRepeated) {
+    OnTimersUpdated(currentTime);
+  }
 }
 
 void TimerManager::IterateTimers(void *context,
@@ -145,71 +283,179 @@ void TimerManager::IterateTimers(void *context,
 }
 
 void TimerManager::RemoveTimerIndex(size_t index, uint32_t currentTime) {
+  const Timer &timer = timers[index];
+  RemoveIdSlot(timer.id);
+  if (!timer.isRepeating) {
+    --nonRepeatingTimerCount;
+  }
+  timersGCD = 0;
+
+  const size_t heapIndex = timer.heapIndex;
   --timerCount;
+  if (heapIndex != timerCount) {
+    SetHeapIndex(heapIndex, heap[timerCount]);
+    UpdateHeapPosition(heap[heapIndex]);
+  }
+
+  // Move the last timer into the gap to keep timers densely packed.
   if (index != timerCount) {
+    UpdateIdSlot(timers[timerCount].id, index);
     timers[index] = timers[timerCount];
+    heap[timers[index].heapIndex] = index;
   }
   OnTimersUpdated(currentTime);
 }
 
 int TimerManager::GetNextTimerTriggerDelay(uint32_t currentTime) const {
-  int result = INT32_MAX;
-  for (size_t i = 0; i < timerCount; ++i) {
-    const int delay = timers[i].GetTriggerDelay(currentTime);
-    if (delay < result) {
-      result = delay;
-    }
+  if (timerCount == 0) {
+    return INT32_MAX;
   }
-  return result;
+  return timers[heap[0]].GetTriggerDelay(currentTime);
 }
 
-bool TimerManager::HasOnlyRepeatingTimers() const {
-  for (size_t i = 0; i < timerCount; ++i) {
-    if (!timers[i].isRepeating) {
-      return false;
-    }
+int TimerManager::GetTimersGCD() const {
+  if (timerCount == 0) {
+    return -1;
   }
-  return true;
-}
-
-// Stein's algorithm.
-static int GCD(int a, int b) {
-  if (a == 0) {
-    return b;
+  if (timersGCD != 0) {
+    return timersGCD;
   }
-  if (b == 0) {
-    return a;
+
+  int result = timers[0].interval;
+  for (size_t i = 1; i < timerCount; ++i) {
+    result = GCD(result, timers[i].interval);
   }
+  return result;
+}
 
-  const int commonPowerOf2 = __builtin_ctz(a | b);
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
 
-  a >>= __builtin_ctz(a);
+#include "unit_test.h"
+#include <stdio.h>
 
-  do {
-    b >>= __builtin_ctz(b);
+#define DO_PROFILE_TEST 0
 
-    if (a > b) {
-      const int temp = a;
-      a = b;
-      b = temp;
-    }
+//---------------------------------------------------------------------------
 
-    b -= a;
-  } while (b != 0);
+class TimerManagerTestHandler final : public TimerHandler {
+public:
+  size_t runCount[256];
+  size_t removedCount = 0;
+  int lastRunId;
 
-  return a << commonPowerOf2;
+  void Run(intptr_t id) final {
+    ++runCount[id & 0xff];
+    lastRunId = id;
+  }
+  void OnTimerRemovedFromManager() final { ++removedCount; }
+};
+
+TEST_BEGIN("TimerManager: Triggers timers in deadline order") {
+  TimerManager &manager = TimerManager::instance;
+  TimerManagerTestHandler handler = {};
+
+  // More timers than the previous fixed limit of 32.
+  constexpr size_t TIMER_COUNT = 100;
+  for (size_t i = 0; i < TIMER_COUNT; ++i) {
+    manager.StartTimer(i, 1000 + (i * 37) % TIMER_COUNT, false, &handler, 0);
+  }
+  assert(manager.GetTimerCount() == TIMER_COUNT);
+  assert(manager.HasTimer(99));
+  assert(!manager.HasTimer(100));
+  assert(manager.GetNextTimerTriggerDelay(0) == 1000);
+
+  manager.StopTimer(37, 0);
+  assert(!manager.HasTimer(37));
+  assert(handler.removedCount == 1);
+
+  // Each millisecond triggers exactly the timer due at that time.
+  for (uint32_t time = 1000; time < 1000 + TIMER_COUNT; ++time) {
+    const size_t timerId = ((time - 1000) * 73) % TIMER_COUNT;
+    manager.ProcessTimers(time);
+    if (timerId == 37) {
+      continue;
+    }
+    assert(handler.lastRunId == (int)timerId);
+    assert(handler.runCount[timerId] == 1);
+    assert(!manager.HasTimer(timerId));
+  }
+  assert(!manager.HasTimers());
+  assert(handler.removedCount == TIMER_COUNT);
 }
+TEST_END
 
-int TimerManager::GetTimersGCD() const {
-  if (timerCount == 0) {
-    return -1;
+TEST_BEGIN("TimerManager: Repeating timers and free ids") {
+  TimerManager &manager = TimerManager::instance;
+  TimerManagerTestHandler handler = {};
+
+  manager.StartTimer(-1, 30, true, &handler, 0);
+  manager.StartTimer(-2, 20, true, &handler, 0);
+  manager.StartTimer(-4, 50, false, &handler, 0);
+  assert(manager.FindFreeTimerId() == -3);
+  assert(!manager.HasOnlyRepeatingTimers());
+
+  manager.StopTimer(-4, 0);
+  assert(manager.HasOnlyRepeatingTimers());
+  assert(manager.GetTimersGCD() == 10);
+  assert(manager.FindFreeTimerId() == -3);
+
+  for (uint32_t time = 1; time <= 60; ++time) {
+    manager.ProcessTimers(time);
   }
+  assert(manager.GetTimerCount() == 2);
+  assert(handler.runCount[-1 & 0xff] == 2);
+  assert(handler.runCount[-2 & 0xff] == 3);
 
-  int result = timers[0].interval;
-  for (size_t i = 1; i < timerCount; ++i) {
-    result = GCD(result, timers[i].interval);
+  manager.StopTimer(-1, 60);
+  manager.StopTimer(-2, 60);
+  assert(!manager.HasTimers());
+}
+TEST_END
+
+// Simulates a main loop that sleeps for the tick delay between updates,
+// with an RGB animation at 30 fps and a display refresh every 50 ms.
+static size_t SimulateWakeups(bool isTickless, uint32_t duration) {
+  TimerManager &manager = TimerManager::instance;
+  TimerManagerTestHandler handler = {};
+
+  manager.SetTickless(isTickless, 0);
+  manager.StartTimer(1, 33, true, &handler, 0);
+  manager.StartTimer(2, 50, true, &handler, 0);
+
+  size_t wakeupCount = 0;
+  for (uint32_t time = 0; time < duration;) {
+    manager.ProcessTimers(time);
+    ++wakeupCount;
+    time += manager.GetTickDelay();
   }
-  return result;
+
+  // Every deadline is still met.
+  assert(handler.runCount[1] == (duration - 1) / 33);
+  assert(handler.runCount[2] == (duration - 1) / 50);
+
+  manager.StopTimer(1, duration);
+  manager.StopTimer(2, duration);
+  manager.SetTickless(JAVELIN_TICKLESS_TIMERS, duration);
+  return wakeupCount;
+}
+
+TEST_BEGIN("TimerManager: Tickless mode wakes only at deadlines") {
+  constexpr uint32_t DURATION = 10'000;
+  const size_t periodicWakeups = SimulateWakeups(false, DURATION);
+  const size_t ticklessWakeups = SimulateWakeups(true, DURATION);
+
+#if DO_PROFILE_TEST
+  printf("[PROFILE] Periodic ticks: %zu wakeups/s\n",
+         periodicWakeups * 1000 / DURATION);
+  printf("[PROFILE] Tickless: %zu wakeups/s\n",
+         ticklessWakeups * 1000 / DURATION);
+#endif
+
+  // The GCD of 33 and 50 is 1 ms.
+  assert(periodicWakeups == DURATION);
+  assert(ticklessWakeups < DURATION / 10);
 }
+TEST_END
 
 //---------------------------------------------------------------------------
@@ -16,20 +16,51 @@ public:
   virtual uint32_t GetTypeId() const { return 0; }
 };
 
+// Timers are kept in a binary min-heap ordered by trigger time, with an
+// open addressed hash from timer id to timer, so that the next trigger delay
+// is available in constant time, and starting or stopping a timer is
+// O(log n).
+//
+// Each timer uses about 30 bytes of RAM, so devices keep the previous limit
+// unless the board config raises it.
+#if !defined(JAVELIN_TIMER_COUNT)
+#if JAVELIN_PLATFORM_PICO_SDK || JAVELIN_PLATFORM_NRF5_SDK
+#define JAVELIN_TIMER_COUNT 32
+#else
+#define JAVELIN_TIMER_COUNT 128
+#endif
+#endif
+
+// When tickless, the tick delay is always the exact delay to the next
+// trigger, rather than the GCD of repeating timers, so that the main loop
+// can sleep until then.
+#if !defined(JAVELIN_TICKLESS_TIMERS)
+#define JAVELIN_TICKLESS_TIMERS 0
+#endif
+
 class TimerManager {
 public:
   void PrintInfo() const;
+  void RegisterMetrics() const;
 
   bool HasTimers() const { return timerCount != 0; }
   size_t GetTimerCount() const { return timerCount; }
   int GetNextTimerTriggerDelay(uint32_t currentTime) const;
-  bool HasOnlyRepeatingTimers() const;
+  bool HasOnlyRepeatingTimers() const { return nonRepeatingTimerCount == 0; }
   int GetTimersGCD() const;
   bool HasTimer(int32_t timerId) const {
     return GetTimerIndex(timerId) != INVALID_TIMER_INDEX;
   }
   uint32_t GetLastUpdateTime() const { return lastUpdateTime; }
 
+  // The delay passed to UpdateTickDelay(), relative to the last update.
+  int GetTickDelay() const { return tickDelay; }
+  bool IsTickless() const { return isTickless; }
+  void SetTickless(bool value, uint32_t currentTime) {
+    isTickless = value;
+    OnTimersUpdated(currentTime);
+  }
+
   int FindFreeTimerId() const;
 
   // A previously matched timerId will have its destructor called.
@@ -55,32 +86,69 @@ private:
 
   struct Timer {
     bool isRepeating;
+    uint16_t heapIndex;
     int32_t id;
     uint32_t lastUpdateTime;
     uint32_t interval;
+    uint32_t triggerTime;
     TimerHandler *handler;
 
     int GetTriggerDelay(uint32_t currentTime) const {
       // Since time steps can be backwards in case of receiving delayed input
       // from a split pair, it's important that this returns a signed value.
-      return lastUpdateTime + interval - currentTime;
+      return triggerTime - currentTime;
     }
     bool ShouldTrigger(uint32_t currentTime) const {
       return GetTriggerDelay(currentTime) <= 0;
     }
+    bool TriggersBefore(const Timer &other) const {
+      return int32_t(triggerTime - other.triggerTime) < 0;
+    }
   };
 
-  static constexpr size_t MAXIMUM_TIMER_COUNT = 32;
+  static constexpr size_t MAXIMUM_TIMER_COUNT = JAVELIN_TIMER_COUNT;
   static constexpr size_t INVALID_TIMER_INDEX = (size_t)-1;
 
-  uint8_t timerCount;
+  // At most half full, so that probe sequences stay short.
+  static constexpr size_t ID_HASH_BITS =
+      MAXIMUM_TIMER_COUNT <= 32 ? 6 : (MAXIMUM_TIMER_COUNT <= 128 ? 8 : 10);
+  static constexpr size_t ID_HASH_SIZE = 1 << ID_HASH_BITS;
+  static_assert(MAXIMUM_TIMER_COUNT * 2 <= ID_HASH_SIZE);
+
+  uint16_t timerCount;
+  uint16_t nonRepeatingTimerCount;
   int tickDelay = 1;
+  bool isTickless = JAVELIN_TICKLESS_TIMERS;
   uint32_t lastUpdateTime;
+
+  // The greatest common divisor of all intervals, or 0 if it needs to be
+  // recalculated after a timer is removed.
+  int timersGCD;
+
+  // Timers are densely packed, and referenced by index from the heap and the
+  // id hash. Id slots hold the timer index + 1, with 0 for an empty slot.
   Timer timers[MAXIMUM_TIMER_COUNT];
+  uint16_t heap[MAXIMUM_TIMER_COUNT];
+  uint16_t idSlots[ID_HASH_SIZE];
 
   size_t GetTimerIndex(int32_t timerId) const;
   void RemoveTimerIndex(size_t index, uint32_t currentTime);
 
+  static size_t GetIdSlot(int32_t timerId) {
+    return uint32_t(timerId * 2654435761u) >> (32 - ID_HASH_BITS);
+  }
+  void AddIdSlot(size_t index);
+  void RemoveIdSlot(int32_t timerId);
+  void UpdateIdSlot(int32_t timerId, size_t index);
+
+  void SetHeapIndex(size_t heapIndex, size_t index) {
+    heap[heapIndex] = index;
+    timers[index].heapIndex = heapIndex;
+  }
+  void SiftUp(size_t heapIndex);
+  void SiftDown(size_t heapIndex);
+  void UpdateHeapPosition(size_t index);
+
   void OnTimersUpdated(uint32_t currentTime);
 
   // Interception point for controlling update frequency.
@@ -20,8 +20,8 @@ UnicodeScript UnicodeScript::instance;
 
 UnicodeScript::UnicodeScript()
     : super(EMPTY_SCRIPT,
-            (void (*const *)(Script &, const ScriptByteCode *))FUNCTION_TABLE) {
-}
+            (void (*const *)(Script &, const ScriptByteCode *))FUNCTION_TABLE,
+            FUNCTION_COUNT) {}
 
 void UnicodeScript::SetScript(const ScriptByteCode *byteCode) {
   super::SetScript(byteCode);
@@ -95,4 +95,7 @@ constexpr void (*UnicodeScript::FUNCTION_TABLE[])(UnicodeScript &,
     &Function::Sleep,            //
 };
 
+const size_t UnicodeScript::FUNCTION_COUNT =
+    sizeof(FUNCTION_TABLE) / sizeof(*FUNCTION_TABLE);
+
 //---------------------------------------------------------------------------
@@ -44,6 +44,7 @@ private:
 
   static void (*const FUNCTION_TABLE[])(UnicodeScript &,
                                         const ScriptByteCode *);
+  static const size_t FUNCTION_COUNT;
 };
 
 //---------------------------------------------------------------------------
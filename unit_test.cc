@@ -7,6 +7,7 @@
 #include "unit_test.h"
 #include "console.h"
 #include "key.h"
+#include <chrono>
 #include <stdio.h>
 
 //---------------------------------------------------------------------------
@@ -43,6 +44,25 @@ void UnitTest::main() {
          passedCount + failedCount, passedCount, failedCount);
 }
 
+static int64_t GetWallClockNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+ProfileTimer::ProfileTimer() : startNanoseconds(GetWallClockNanoseconds()) {}
+
+double ProfileTimer::GetElapsedSeconds() const {
+  return (GetWallClockNanoseconds() - startNanoseconds) * 1e-9;
+}
+
+void ProfileTimer::PrintRate(const char *name, size_t count,
+                             const char *unit) const {
+  const double elapsed = GetElapsedSeconds();
+  printf("[PROFILE] %s: %zu %s in %.3f s, %.0f %s/s\n", name, count, unit,
+         elapsed, count / elapsed, unit);
+}
+
 [[gnu::weak]] int main(int argc, const char **argv) {
   UnitTest::main();
   return 0;
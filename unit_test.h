@@ -4,6 +4,8 @@
 #include <assert.h>
 
 #ifdef RUN_TESTS
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
 #include <vector>
 #endif
@@ -27,6 +29,19 @@ private:
   static std::vector<const UnitTest *> &GetTests();
 };
 
+// Measures wall clock time for profile tests, since Clock is simulated while
+// running tests.
+class ProfileTimer {
+public:
+  ProfileTimer();
+
+  double GetElapsedSeconds() const;
+  void PrintRate(const char *name, size_t count, const char *unit) const;
+
+private:
+  int64_t startNanoseconds;
+};
+
 struct TestFailure {
   TestFailure(const std::string &message) : message(message) {}
 
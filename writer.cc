@@ -31,9 +31,6 @@
 
 //---------------------------------------------------------------------------
 
-constexpr int FLAG_FILL_ZERO = 1;
-constexpr int FLAG_LENGTH_64_BIT = 2;
-
 constexpr char BASE64_ALPHABET[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
@@ -404,9 +401,6 @@ void IWriter::AddStroke(StenoStroke stroke) {
 
 void IWriter::Vprintf(const char *p, va_list args) {
   const char *spanStart = p;
-  char scratch[128];
-
-  static_assert(sizeof(scratch) >= StenoStroke::MAX_STRING_LENGTH + 1);
 
   for (;;) {
     for (;;) {
@@ -430,7 +424,7 @@ void IWriter::Vprintf(const char *p, va_list args) {
     int width = 0;
     ++p;
     if (*p == '0') {
-      flags |= FLAG_FILL_ZERO;
+      flags |= PrintfOp::FLAG_FILL_ZERO;
       ++p;
     } else if (*p == ' ') {
       ++p;
@@ -441,102 +435,53 @@ void IWriter::Vprintf(const char *p, va_list args) {
     if (*p == 'l') {
       ++p;
       if (*p == 'l') {
-        flags |= FLAG_LENGTH_64_BIT;
+        flags |= PrintfOp::FLAG_LENGTH_64_BIT;
         ++p;
       }
     } else if (*p == 'h' || *p == 'z') {
       ++p;
-    } else if (*p == 'z') {
-      if (sizeof(size_t) == sizeof(uint64_t)) {
-        flags |= FLAG_LENGTH_64_BIT;
-      }
-      ++p;
     }
 
-    char *start = scratch;
-    char *end;
+    PrintfArgument arguments[2];
     switch (*p) {
     case 'd':
-    case 'i': {
-      char *t = start;
-      if (flags & FLAG_LENGTH_64_BIT) {
-        int64_t v = va_arg(args, int64_t);
-        if (v < 0) {
-          *t++ = '-';
-          v = -v;
-        }
-        end = WriteReversed<uint64_t>(t, v);
-      } else {
-        int32_t v = va_arg(args, int32_t);
-        if (v < 0) {
-          *t++ = '-';
-          v = -v;
-        }
-        end = WriteReversed<uint32_t>(t, v);
-      }
-      Reverse(t, end);
+    case 'i':
+      arguments[0] = PrintfArgument::Create(
+          (flags & PrintfOp::FLAG_LENGTH_64_BIT) ? va_arg(args, int64_t)
+                                                 : va_arg(args, int32_t));
       break;
-    }
 
     case 'u':
-      if (flags & FLAG_LENGTH_64_BIT) {
-        const uint64_t v = va_arg(args, uint64_t);
-        end = WriteReversed<uint64_t>(start, v);
-      } else {
-        const uint32_t v = va_arg(args, uint32_t);
-        end = WriteReversed<uint32_t>(start, v);
-      }
-      Reverse(start, end);
-      break;
-
     case 'x':
-      if (flags & FLAG_LENGTH_64_BIT) {
-        const uint64_t v = va_arg(args, uint64_t);
-        end = WriteReversedHex<uint64_t>(start, v, "0123456789abcdef");
-      } else {
-        const uint32_t v = va_arg(args, uint32_t);
-        end = WriteReversedHex<uint32_t>(start, v, "0123456789abcdef");
-      }
-      Reverse(start, end);
+    case 'X':
+      arguments[0] = PrintfArgument::Create(
+          (flags & PrintfOp::FLAG_LENGTH_64_BIT) ? va_arg(args, uint64_t)
+                                                 : va_arg(args, uint32_t));
       break;
 
-    case 'X':
-      if (flags & FLAG_LENGTH_64_BIT) {
-        const uint64_t v = va_arg(args, uint64_t);
-        end = WriteReversedHex<uint64_t>(start, v, "0123456789ABCDEF");
-      } else {
-        const uint32_t v = va_arg(args, uint32_t);
-        end = WriteReversedHex<uint32_t>(start, v, "0123456789ABCDEF");
-      }
-      Reverse(start, end);
+    case 'c':
+    case 'C':
+    case 'B':
+      arguments[0] = PrintfArgument::Create(va_arg(args, int));
       break;
 
     case 'p':
-      if constexpr (sizeof(void *) == sizeof(uint64_t)) {
-        const uint64_t v = va_arg(args, uint64_t);
-        end = WriteReversedHex<uint64_t>(start, v, "0123456789abcdef");
-      } else {
-        const uint32_t v = va_arg(args, uint32_t);
-        end = WriteReversedHex<uint32_t>(start, v, "0123456789abcdef");
-      }
-      Reverse(start, end);
+    case 's':
+    case 't':
+    case 'Y':
+    case 'J':
+      arguments[0] = PrintfArgument::Create(va_arg(args, const void *));
       break;
 
-    case 'c':
-      *start = va_arg(args, int);
-      end = start + 1;
+    case 'T':
+    case 'O':
+    case 'b':
+    case 'D':
+      arguments[0] = PrintfArgument::Create(va_arg(args, const void *));
+      arguments[1] = PrintfArgument::Create(va_arg(args, size_t));
       break;
 
-    case 'C': {
-      const uint32_t c = va_arg(args, int);
-      Utf8Pointer p(start);
-      p.SetAndAdvance(c);
-      end = p.GetRawPointer();
-    } break;
-
-    case 's':
-      start = va_arg(args, char *) + printfPointerOffset;
-      end = start + Str::Length(start);
+    case 'Z':
       break;
 
     case '%':
@@ -544,149 +489,245 @@ void IWriter::Vprintf(const char *p, va_list args) {
       ++p;
       continue;
 
-    case 'B': {
-      // Write the string true or false based on a bool.
-      const int value = va_arg(args, int);
-      if (value) {
-        Write("true", 4);
-      } else {
-        Write("false", 5);
-      }
-      goto NextSegment;
-    }
-
-    case 't': {
-      // Write single stroke.
-      const StenoStroke *stroke = va_arg(args, const StenoStroke *);
-      stroke = (const StenoStroke *)(intptr_t(stroke) + printfPointerOffset);
-      char *p = stroke->ToString(scratch + 1);
-      *p = '\0';
-      if (IsYamlSafe(scratch + 1)) {
-        Write(scratch + 1, p - (scratch + 1));
-      } else {
-        scratch[0] = '\"';
-        *p++ = '\"';
-        Write(scratch, p - scratch);
-      }
-      goto NextSegment;
+    case '\0': // Shouldn't happen
+    default:
+      // Just use span start.
+      continue;
     }
 
-    case 'O': {
-      // Write multiple strokes.
-      const StenoStroke *strokes = va_arg(args, const StenoStroke *);
-      strokes = (const StenoStroke *)(intptr_t(strokes) + printfPointerOffset);
-      const size_t strokeCount = va_arg(args, size_t);
+    WriteConversion(*p, flags, width, arguments);
+    ++p;
+    spanStart = p;
+  }
+}
 
-      BufferWriter buffer(scratch, sizeof(scratch));
-      buffer.WriteByte('\"');
-      for (size_t j = 0; j < strokeCount; ++j) {
-        if (j != 0) {
-          buffer.WriteByte('/');
-        }
-        buffer.AddStroke(strokes[j]);
+void IWriter::WriteFormat(const char *text, const PrintfOp *ops,
+                          size_t opCount, const PrintfArgument *arguments) {
+  for (const PrintfOp *op = ops; op < ops + opCount; ++op) {
+    if (op->conversion == '\0') {
+      Write(text + op->offset, op->length);
+    } else {
+      arguments +=
+          WriteConversion(op->conversion, op->flags, op->width, arguments);
+    }
+  }
+}
+
+size_t IWriter::WriteConversion(char conversion, int flags, int width,
+                                const PrintfArgument *arguments) {
+  char scratch[128];
+  static_assert(sizeof(scratch) >= StenoStroke::MAX_STRING_LENGTH + 1);
+
+  char *start = scratch;
+  char *end;
+  switch (conversion) {
+  case 'd':
+  case 'i': {
+    char *t = start;
+    if (flags & PrintfOp::FLAGS_64_BIT) {
+      int64_t v = arguments[0].GetInt64();
+      if (v < 0) {
+        *t++ = '-';
+        v = -v;
       }
-      buffer.WriteByte('\0');
-      const size_t length = buffer.GetCount();
-      char *outline = buffer.GetBuffer();
-
-      if (IsYamlSafe(outline + 1)) {
-        Write(outline + 1, length - 2);
-      } else {
-        outline[length - 1] = '\"';
-        Write(outline, length);
+      end = WriteReversed<uint64_t>(t, v);
+    } else {
+      int32_t v = arguments[0].GetInt32();
+      if (v < 0) {
+        *t++ = '-';
+        v = -v;
       }
-      goto NextSegment;
-    }
-
-    case 'T': {
-      // Write multiple strokes.
-      const StenoStroke *strokes = va_arg(args, const StenoStroke *);
-      strokes = (const StenoStroke *)(intptr_t(strokes) + printfPointerOffset);
-      const size_t strokeCount = va_arg(args, size_t);
-      for (size_t j = 0; j < strokeCount; ++j) {
-        char *p = scratch;
-        if (j != 0) {
-          *p++ = '/';
-        }
-        p = strokes[j].ToString(p);
-        Write(scratch, p - scratch);
+      end = WriteReversed<uint32_t>(t, v);
+    }
+    Reverse(t, end);
+    break;
+  }
+
+  case 'u':
+    if (flags & PrintfOp::FLAGS_64_BIT) {
+      end = WriteReversed<uint64_t>(start, arguments[0].GetUint64());
+    } else {
+      end = WriteReversed<uint32_t>(start, arguments[0].GetUint32());
+    }
+    Reverse(start, end);
+    break;
+
+  case 'x':
+  case 'X': {
+    const char *alphabet =
+        conversion == 'x' ? "0123456789abcdef" : "0123456789ABCDEF";
+    if (flags & PrintfOp::FLAGS_64_BIT) {
+      end = WriteReversedHex<uint64_t>(start, arguments[0].GetUint64(),
+                                       alphabet);
+    } else {
+      end = WriteReversedHex<uint32_t>(start, arguments[0].GetUint32(),
+                                       alphabet);
+    }
+    Reverse(start, end);
+    break;
+  }
+
+  case 'p':
+    end = WriteReversedHex<uintptr_t>(
+        start, uintptr_t(arguments[0].GetPointer<void>()), "0123456789abcdef");
+    Reverse(start, end);
+    break;
+
+  case 'c':
+    *start = arguments[0].GetInt32();
+    end = start + 1;
+    break;
+
+  case 'C': {
+    Utf8Pointer p(start);
+    p.SetAndAdvance(arguments[0].GetUint32());
+    end = p.GetRawPointer();
+  } break;
+
+  case 's':
+    start = arguments[0].GetPointer<char>() + printfPointerOffset;
+    end = start + Str::Length(start);
+    break;
+
+  case 'B':
+    // Write the string true or false based on a bool.
+    if (arguments[0].GetInt32()) {
+      Write("true", 4);
+    } else {
+      Write("false", 5);
+    }
+    return 1;
+
+  case 't': {
+    // Write single stroke.
+    const StenoStroke *stroke = arguments[0].GetPointer<const StenoStroke>();
+    stroke = (const StenoStroke *)(intptr_t(stroke) + printfPointerOffset);
+    char *p = stroke->ToString(scratch + 1);
+    *p = '\0';
+    if (IsYamlSafe(scratch + 1)) {
+      Write(scratch + 1, p - (scratch + 1));
+    } else {
+      scratch[0] = '\"';
+      *p++ = '\"';
+      Write(scratch, p - scratch);
+    }
+    return 1;
+  }
+
+  case 'O': {
+    // Write multiple strokes.
+    const StenoStroke *strokes = arguments[0].GetPointer<const StenoStroke>();
+    strokes = (const StenoStroke *)(intptr_t(strokes) + printfPointerOffset);
+    const size_t strokeCount = arguments[1].GetSize();
+
+    BufferWriter buffer(scratch, sizeof(scratch));
+    buffer.WriteByte('\"');
+    for (size_t j = 0; j < strokeCount; ++j) {
+      if (j != 0) {
+        buffer.WriteByte('/');
       }
-      goto NextSegment;
-    }
-    case 'b': {
-      // Write Data (void*, length) as Base64
-      const uint8_t *data = va_arg(args, const uint8_t *);
-      data += printfPointerOffset;
-      const size_t length = va_arg(args, size_t);
-      if (IsYamlSafeData(data, length)) {
-        WriteBase64(data, length);
-      } else {
-        WriteByte('\"');
-        WriteBase64(data, length);
-        WriteByte('\"');
+      buffer.AddStroke(strokes[j]);
+    }
+    buffer.WriteByte('\0');
+    const size_t length = buffer.GetCount();
+    char *outline = buffer.GetBuffer();
+
+    if (IsYamlSafe(outline + 1)) {
+      Write(outline + 1, length - 2);
+    } else {
+      outline[length - 1] = '\"';
+      Write(outline, length);
+    }
+    return 2;
+  }
+
+  case 'T': {
+    // Write multiple strokes.
+    const StenoStroke *strokes = arguments[0].GetPointer<const StenoStroke>();
+    strokes = (const StenoStroke *)(intptr_t(strokes) + printfPointerOffset);
+    const size_t strokeCount = arguments[1].GetSize();
+    for (size_t j = 0; j < strokeCount; ++j) {
+      char *p = scratch;
+      if (j != 0) {
+        *p++ = '/';
       }
-      goto NextSegment;
+      p = strokes[j].ToString(p);
+      Write(scratch, p - scratch);
     }
-    case 'D': {
-      // Write Data (void*, length) as Base64
-      const uint8_t *data = va_arg(args, const uint8_t *);
-      data += printfPointerOffset;
-      const size_t length = va_arg(args, size_t);
+    return 2;
+  }
+
+  case 'b': {
+    // Write Data (void*, length) as Base64
+    const uint8_t *data =
+        arguments[0].GetPointer<const uint8_t>() + printfPointerOffset;
+    const size_t length = arguments[1].GetSize();
+    if (IsYamlSafeData(data, length)) {
       WriteBase64(data, length);
-      goto NextSegment;
-    }
-    case 'Y': {
-      // Write as YAML
-      char *p = va_arg(args, char *) + printfPointerOffset;
-      const size_t length = Str::Length(p);
-      if (IsYamlSafe(p)) {
-        start = p;
-        end = p + length;
-        break;
-      }
+    } else {
+      WriteByte('\"');
+      WriteBase64(data, length);
+      WriteByte('\"');
+    }
+    return 2;
+  }
 
-      size_t maxBufferSizeRequired = 2 * length + 2;
-      char *jsonBuffer = sizeof(scratch) >= maxBufferSizeRequired
-                             ? scratch
-                             : (char *)malloc(maxBufferSizeRequired);
-      jsonBuffer[0] = '\"';
-      char *end = Str::WriteJson(jsonBuffer + 1, p);
-      *end++ = '\"';
-      WriteSegment(flags, jsonBuffer, end, width);
-      if (jsonBuffer != scratch) {
-        free(jsonBuffer);
-      }
-      goto NextSegment;
-    }
-    case 'J': {
-      // Write as JSON
-      const char *p = va_arg(args, char *) + printfPointerOffset;
-      const size_t length = Str::Length(p);
-      char *jsonBuffer =
-          length <= sizeof(scratch) / 2 ? scratch : (char *)malloc(2 * length);
-      char *end = Str::WriteJson(jsonBuffer, p);
-      WriteSegment(flags, jsonBuffer, end, width);
-      if (jsonBuffer != scratch) {
-        free(jsonBuffer);
-      }
-      goto NextSegment;
+  case 'D': {
+    // Write Data (void*, length) as Base64
+    const uint8_t *data =
+        arguments[0].GetPointer<const uint8_t>() + printfPointerOffset;
+    WriteBase64(data, arguments[1].GetSize());
+    return 2;
+  }
+
+  case 'Y': {
+    // Write as YAML
+    char *p = arguments[0].GetPointer<char>() + printfPointerOffset;
+    const size_t length = Str::Length(p);
+    if (IsYamlSafe(p)) {
+      start = p;
+      end = p + length;
+      break;
     }
 
-    case 'Z':
-      WriteByte('\0');
-      goto NextSegment;
+    size_t maxBufferSizeRequired = 2 * length + 2;
+    char *jsonBuffer = sizeof(scratch) >= maxBufferSizeRequired
+                           ? scratch
+                           : (char *)malloc(maxBufferSizeRequired);
+    jsonBuffer[0] = '\"';
+    char *end = Str::WriteJson(jsonBuffer + 1, p);
+    *end++ = '\"';
+    WriteSegment(flags, jsonBuffer, end, width);
+    if (jsonBuffer != scratch) {
+      free(jsonBuffer);
+    }
+    return 1;
+  }
 
-    case '\0': // Shouldn't happen
-    default:
-      // Just use span start.
-      continue;
+  case 'J': {
+    // Write as JSON
+    const char *p = arguments[0].GetPointer<char>() + printfPointerOffset;
+    const size_t length = Str::Length(p);
+    char *jsonBuffer =
+        length <= sizeof(scratch) / 2 ? scratch : (char *)malloc(2 * length);
+    char *end = Str::WriteJson(jsonBuffer, p);
+    WriteSegment(flags, jsonBuffer, end, width);
+    if (jsonBuffer != scratch) {
+      free(jsonBuffer);
     }
-    WriteSegment(flags, start, end, width);
+    return 1;
+  }
 
-  NextSegment:
-    ++p;
-    spanStart = p;
+  case 'Z':
+    WriteByte('\0');
+    return 0;
+
+  default:
+    return 0;
   }
+
+  WriteSegment(flags, start, end, width);
+  return 1;
 }
 
 static constexpr char SPACES[] = "                ";
@@ -696,7 +737,7 @@ void IWriter::WriteSegment(int flags, const char *start, const char *end,
                            int width) {
   const size_t length = end - start;
   if (length < width) [[unlikely]] {
-    const char *fill = (flags & FLAG_FILL_ZERO) ? ZEROS : SPACES;
+    const char *fill = (flags & PrintfOp::FLAG_FILL_ZERO) ? ZEROS : SPACES;
 
     size_t fillCount = width - length;
     while (fillCount) {
@@ -832,6 +873,12 @@ void LimitedBufferWriter::AddTrailingNull() {
 
 #include "unit_test.h"
 
+//---------------------------------------------------------------------------
+
+#define DO_PROFILE_TEST 0
+
+//---------------------------------------------------------------------------
+
 TEST_BEGIN("IWriter::IsNumber returns expected results") {
   assert(IWriter::IsNumber("1"));
   assert(IWriter::IsNumber("+1"));
@@ -866,4 +913,85 @@ TEST_BEGIN("IWriter::IsYamlSafe returns expected results") {
 }
 TEST_END
 
+static_assert(PrintfFormat("%d %s").IsValid<int, const char *>());
+static_assert(PrintfFormat("%zu %llx").IsValid<size_t, uint64_t>());
+static_assert(PrintfFormat("%T 100%%").IsValid<const StenoStroke *, int>());
+static_assert(PrintfFormat("%D").IsValid<const uint8_t *, size_t>());
+static_assert(!PrintfFormat("%d").IsValid<const char *>());
+static_assert(!PrintfFormat("%s").IsValid<int>());
+static_assert(!PrintfFormat("%d %d").IsValid<int>());
+static_assert(!PrintfFormat("%d").IsValid<int, int>());
+static_assert(!PrintfFormat("%llu").IsValid<int>());
+static_assert(!PrintfFormat("%T").IsValid<const StenoStroke *>());
+static_assert(!PrintfFormat("%q").IsValid<int>());
+
+TEST_BEGIN("IWriter: Parsed formats match runtime formats") {
+  const StenoStroke strokes[] = {StenoStroke("ST"), StenoStroke("-T")};
+  const uint8_t data[] = {1, 2, 3, 4};
+
+  BufferWriter expected;
+  expected.Printf("a%dz %5u|%04x|%X %c%C %B %s %J %Y %t %T %O %D%% %lld\n",
+                  -12, 34u, 0xabu, 0xCDu, 'x', 0x20ac, true, "s", "\"j\"",
+                  "true", &strokes[0], strokes, (size_t)2, strokes,
+                  (size_t)2, data, (size_t)4, (int64_t)-1234567890123);
+
+  BufferWriter actual;
+  actual.Printf<"a%dz %5u|%04x|%X %c%C %B %s %J %Y %t %T %O %D%% %lld\n">(
+      -12, 34u, 0xabu, 0xCDu, 'x', 0x20ac, true, "s", "\"j\"", "true",
+      &strokes[0], strokes, (size_t)2, strokes, (size_t)2, data, (size_t)4,
+      (int64_t)-1234567890123);
+
+  assert(expected.GetCount() == actual.GetCount());
+  assert(memcmp(expected.GetBuffer(), actual.GetBuffer(),
+                expected.GetCount()) == 0);
+
+  BufferWriter empty;
+  empty.Printf<"">();
+  assert(empty.GetCount() == 0);
+}
+TEST_END
+
+TEST_BEGIN("IWriter: Parsed formats print wide arguments") {
+  BufferWriter writer;
+  writer.Printf<"%zu %ld %lu %zx">(size_t(123), -45, 67u, size_t(0xabc));
+  writer.WriteByte('\0');
+  assert(Str::Eq(writer.GetBuffer(), "123 -45 67 abc"));
+
+  if constexpr (sizeof(size_t) == 8) {
+    BufferWriter wide;
+    wide.Printf<"%zu %zx">(size_t(0x123456789), size_t(0x123456789));
+    wide.WriteByte('\0');
+    assert(Str::Eq(wide.GetBuffer(), "4886718345 123456789"));
+  }
+}
+TEST_END
+
+TEST_BEGIN("IWriter: Paper tape format benchmark") {
+#if DO_PROFILE_TEST
+  constexpr size_t ITERATION_COUNT = 5'000'000;
+#else
+  constexpr size_t ITERATION_COUNT = 10;
+#endif
+  const StenoStroke stroke("STKPW");
+
+  const ProfileTimer runtimeTimer;
+  for (size_t i = 0; i < ITERATION_COUNT; ++i) {
+    NullWriter::instance.Printf("EV e: p\no: %t\nu: %zu\nt: %Y\n\n", &stroke,
+                                i, "example");
+  }
+#if DO_PROFILE_TEST
+  runtimeTimer.PrintRate("Runtime format", ITERATION_COUNT, "lines");
+#endif
+
+  const ProfileTimer parsedTimer;
+  for (size_t i = 0; i < ITERATION_COUNT; ++i) {
+    NullWriter::instance.Printf<"EV e: p\no: %t\nu: %zu\nt: %Y\n\n">(
+        &stroke, i, "example");
+  }
+#if DO_PROFILE_TEST
+  parsedTimer.PrintRate("Parsed format", ITERATION_COUNT, "lines");
+#endif
+}
+TEST_END
+
 //---------------------------------------------------------------------------
@@ -1,6 +1,7 @@
 //---------------------------------------------------------------------------
 
 #pragma once
+#include "printf_format.h"
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -31,6 +32,20 @@ public:
   void Printf(const char *p, ...);
   void Vprintf(const char *p, va_list args);
 
+  // Printf with a format string parsed at compile time.
+  template <PrintfFormat F, typename... T> void Printf(T... args) {
+    static_assert(F.template IsValid<T...>(),
+                  "Printf arguments do not match the format string");
+    using Program = PrintfProgram<F>;
+    const PrintfArgument arguments[] = {PrintfArgument::Create(args)...,
+                                        PrintfArgument{}};
+    WriteFormat(Program::TEXT, Program::OPS.ops, Program::OP_COUNT,
+                arguments);
+  }
+
+  void WriteFormat(const char *text, const PrintfOp *ops, size_t opCount,
+                   const PrintfArgument *arguments);
+
   void SetPrintfPointerOffset(const void *p) {
     printfPointerOffset = intptr_t(p);
   }
@@ -44,6 +59,10 @@ private:
 
   void WriteSegment(int flags, const char *start, const char *end, int width);
 
+  // Writes a single conversion, returning the number of arguments used.
+  size_t WriteConversion(char conversion, int flags, int width,
+                         const PrintfArgument *arguments);
+
   static uint32_t ZigZagEncode(int32_t value) {
     return (value << 1) ^ (value >> 31);
   }
@@ -118,6 +137,7 @@ public:
 
   char *GetBuffer() const { return buffer; }
   size_t GetCount() const { return bufferUsedCount; }
+  void Truncate(size_t count) { bufferUsedCount = count; }
   bool IsEmpty() const { return bufferUsedCount == 0; }
   bool IsNotEmpty() const { return bufferUsedCount != 0; }
 